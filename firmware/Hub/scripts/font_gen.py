@@ -0,0 +1,168 @@
+# font_gen.py - Шрифт дисплея хаба: fonts/hub_6x8.txt -> src/hub_font.h
+#
+# Знаки обрезаются по рамке закрашенных точек и пакуются в формат GFXfont
+# (как шрифты Adafruit GFX). Поиск знака по коду Unicode - O(1): коды
+# делятся на страницы по 128, для каждой непустой страницы - таблица
+# "код -> номер знака" (HUB_FONT_MISSING - нет знака). Латиница 0x20..0x7E
+# идёт первой и подряд, поэтому шрифт годится и для обычного setFont().
+#
+# Перед сборкой прошивки запускается из platformio.ini и пересобирает
+# заголовок, только если исходник новее. Ручной запуск: python scripts/font_gen.py
+
+import os
+import sys
+
+try:
+    Import("env")
+    PROJECT_DIR = env.subst("$PROJECT_DIR")
+except NameError:
+    env = None
+    PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+SRC = os.path.join(PROJECT_DIR, "fonts", "hub_6x8.txt")
+DST = os.path.join(PROJECT_DIR, "src", "hub_font.h")
+
+CELL_W = 5          # Точек в строке исходника
+CELL_H = 8
+ADVANCE = 6         # Шаг знака с промежутком
+BASELINE = 7        # Строк над базовой линией
+PAGE_BITS = 7
+MISSING = 0xFF
+
+
+def parse(path):
+    glyphs = {}
+    cp = None
+    rows = []
+    with open(path, encoding="utf-8") as f:
+        for n, line in enumerate(f, 1):
+            line = line.rstrip("\n")
+            if cp is None and line.startswith("#"):
+                continue                    # Комментарий - только между знаками
+            if line.startswith("U+"):
+                cp = int(line[2:].split()[0], 16)
+                rows = []
+                continue
+            if not line.strip():
+                continue
+            if cp is None or len(line) != CELL_W or set(line) - set("#."):
+                sys.exit("font_gen: %s:%d: ожидается строка из %d знаков '#'/'.'" % (path, n, CELL_W))
+            rows.append(line)
+            if len(rows) == CELL_H:
+                if cp in glyphs:
+                    sys.exit("font_gen: %s:%d: U+%04X уже есть" % (path, n, cp))
+                glyphs[cp] = rows
+                cp = None
+    return glyphs
+
+
+# Рамка закрашенных точек и биты по строкам, старший бит первым
+def pack(rows):
+    points = [(x, y) for y, r in enumerate(rows) for x, c in enumerate(r) if c == "#"]
+    if not points:
+        return [], 0, 0, 0, 0
+    x0 = min(p[0] for p in points)
+    x1 = max(p[0] for p in points)
+    y0 = min(p[1] for p in points)
+    y1 = max(p[1] for p in points)
+    bits = [rows[y][x] == "#" for y in range(y0, y1 + 1) for x in range(x0, x1 + 1)]
+    data = []
+    for i in range(0, len(bits), 8):
+        byte = 0
+        for k, b in enumerate(bits[i:i + 8]):
+            byte |= b << (7 - k)
+        data.append(byte)
+    return data, x1 - x0 + 1, y1 - y0 + 1, x0, y0 - BASELINE
+
+
+def label(cp):
+    c = chr(cp)
+    return "' '" if c == " " else "'\\\\'" if c == "\\" else "'%s'" % c
+
+
+def generate(glyphs):
+    ascii_range = range(0x20, 0x7F)
+    missing = [cp for cp in ascii_range if cp not in glyphs]
+    if missing:
+        sys.exit("font_gen: нет знаков %s" % ", ".join("U+%04X" % cp for cp in missing))
+    order = list(ascii_range) + sorted(cp for cp in glyphs if cp not in ascii_range)
+    if len(order) >= MISSING:
+        sys.exit("font_gen: больше %d знаков" % (MISSING - 1))
+
+    bitmap = []
+    table = []
+    for cp in order:
+        data, w, h, xo, yo = pack(glyphs[cp])
+        table.append("    {%4d, %d, %d, %d, %d, %2d},   // U+%04X %s" % (len(bitmap), w, h, ADVANCE, xo, yo, cp, label(cp)))
+        bitmap += data
+
+    pages = {}
+    for i, cp in enumerate(order):
+        pages.setdefault(cp >> PAGE_BITS, [MISSING] * (1 << PAGE_BITS))[cp & ((1 << PAGE_BITS) - 1)] = i
+    page_count = max(pages) + 1
+
+    out = []
+    out.append("// hub_font.h - Шрифт дисплея хаба 6x8 в формате GFXfont")
+    out.append("// Создан scripts/font_gen.py из fonts/hub_6x8.txt - не править вручную.")
+    out.append("#ifndef HUB_FONT_H")
+    out.append("#define HUB_FONT_H")
+    out.append("")
+    out.append("#include <Adafruit_GFX.h>")
+    out.append("")
+    out.append("#define HUB_FONT_GLYPHS     %d" % len(order))
+    out.append("#define HUB_FONT_ADVANCE    %d" % ADVANCE)
+    out.append("#define HUB_FONT_HEIGHT     %d" % CELL_H)
+    out.append("#define HUB_FONT_BASELINE   %d       // Строк над базовой линией" % BASELINE)
+    out.append("#define HUB_FONT_PAGE_BITS  %d       // Страница поиска - 128 кодов" % PAGE_BITS)
+    out.append("#define HUB_FONT_PAGE_COUNT %d" % page_count)
+    out.append("#define HUB_FONT_MISSING    0x%02X" % MISSING)
+    out.append("")
+    out.append("const uint8_t HubFont6x8Bitmaps[] PROGMEM = {")
+    for i in range(0, len(bitmap), 16):
+        out.append("    " + ", ".join("0x%02X" % b for b in bitmap[i:i + 16]) + ",")
+    out.append("};")
+    out.append("")
+    out.append("const GFXglyph HubFont6x8Glyphs[] PROGMEM = {")
+    out += table
+    out.append("};")
+    out.append("")
+    out.append("// first..last - латиница: с setFont() шрифт рисует ASCII как обычный GFXfont")
+    out.append("const GFXfont HubFont6x8 PROGMEM = {(uint8_t *)HubFont6x8Bitmaps, (GFXglyph *)HubFont6x8Glyphs, 0x20, 0x7E, %d};" % CELL_H)
+    out.append("")
+    out.append("// Код Unicode -> номер знака: HubFontPages[cp >> 7][cp & 127]")
+    for p in sorted(pages):
+        out.append("const uint8_t HubFontPage%d[%d] PROGMEM = {" % (p, 1 << PAGE_BITS))
+        row = pages[p]
+        for i in range(0, len(row), 16):
+            out.append("    " + ", ".join("0x%02X" % b for b in row[i:i + 16]) + ",")
+        out.append("};")
+    refs = ", ".join("HubFontPage%d" % p if p in pages else "nullptr" for p in range(page_count))
+    out.append("const uint8_t *const HubFontPages[HUB_FONT_PAGE_COUNT] PROGMEM = {%s};" % refs)
+    out.append("")
+    out.append("#endif")
+    return "\n".join(out) + "\n", len(order), len(bitmap)
+
+
+def build_font(*args, **kwargs):
+    if not os.path.isfile(SRC):
+        print("font_gen: %s не найден" % SRC)
+        return
+    if os.path.isfile(DST) and os.path.getmtime(DST) >= os.path.getmtime(SRC) and env is not None:
+        return
+    text, count, size = generate(parse(SRC))
+    with open(DST, "w", encoding="utf-8", newline="\n") as f:
+        f.write(text)
+    print("font_gen: %s -> %s (%d знаков, %d байт точек)" % (
+        os.path.basename(SRC), os.path.relpath(DST, PROJECT_DIR), count, size))
+
+
+build_font()
+
+if env is not None:
+    env.AddCustomTarget(
+        name="font",
+        dependencies=None,
+        actions=[build_font],
+        title="Hub font",
+        description="Пересобрать шрифт дисплея (src/hub_font.h)",
+    )
@@ -0,0 +1,52 @@
+# web_assets.py - Подготовка веб-интерфейса хаба для SD карты
+#
+# Перед сборкой сжимает HTML из custom_web_source (platformio.ini) в
+# sdcard/index.html.gz. Содержимое папки sdcard/ копируется в корень SD.
+# Хаб отдаёт .gz с Content-Encoding: gzip и ETag, а несжатый /index.html
+# использует только если .gz на карте нет.
+#
+# Ручной запуск: pio run -t webassets
+
+import gzip
+import os
+
+Import("env")
+
+PROJECT_DIR = env.subst("$PROJECT_DIR")
+OUT_DIR = os.path.join(PROJECT_DIR, "sdcard")
+
+
+def build_web_assets(*args, **kwargs):
+    source = env.GetProjectOption("custom_web_source", "")
+    if not source:
+        return
+    src = os.path.normpath(os.path.join(PROJECT_DIR, source))
+    if not os.path.isfile(src):
+        print("web_assets: %s не найден" % src)
+        return
+
+    dst = os.path.join(OUT_DIR, "index.html.gz")
+    if os.path.isfile(dst) and os.path.getmtime(dst) >= os.path.getmtime(src):
+        return
+
+    os.makedirs(OUT_DIR, exist_ok=True)
+    with open(src, "rb") as f:
+        data = f.read()
+    # mtime=0 - одинаковый вход даёт одинаковый .gz (и одинаковый ETag на хабе)
+    with open(dst, "wb") as f:
+        with gzip.GzipFile(filename="", mode="wb", compresslevel=9, fileobj=f, mtime=0) as gz:
+            gz.write(data)
+
+    print("web_assets: %s -> %s (%d -> %d байт)" % (
+        os.path.basename(src), os.path.relpath(dst, PROJECT_DIR), len(data), os.path.getsize(dst)))
+
+
+build_web_assets()
+
+env.AddCustomTarget(
+    name="webassets",
+    dependencies=None,
+    actions=[build_web_assets],
+    title="Web assets",
+    description="Сжать веб-интерфейс для SD карты (sdcard/index.html.gz)",
+)
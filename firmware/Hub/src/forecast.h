@@ -0,0 +1,156 @@
+// forecast.h - Прогноз по Zambretti без String и без кучи
+// Давление (гПа, приведённое к уровню моря), его изменение за 3 ч и месяц
+// дают букву Zambretti A..Z (A - устойчиво ясно, Z - шторм). Значок,
+// подпись для веба и для TFT берутся из таблиц по индексу.
+//
+// Таблицы - по классической схеме Negretti & Zambra: диапазон 950..1050 гПа
+// делится на 22 ступени, у падающего, ровного и растущего давления свои
+// строки; летом растущее давление сдвигается вверх, зимой падающее - вниз.
+#ifndef FORECAST_H
+#define FORECAST_H
+
+#include <Arduino.h>
+
+#define FC_MMHG_TO_HPA      1.33322f
+#define FC_BARO_BOTTOM      950.0f
+#define FC_BARO_RANGE       100.0f
+#define FC_STEPS            22
+#define FC_TREND_HPA        1.6f        // Порог изменения за 3 ч: меньше - давление ровное
+#define FC_SEASON_SHIFT     0.07f       // Сезонный сдвиг, доля диапазона
+
+enum Forecast : uint8_t {
+    FC_A = 0, FC_B, FC_C, FC_D, FC_E, FC_F, FC_G, FC_H, FC_I, FC_J, FC_K, FC_L, FC_M,
+    FC_N, FC_O, FC_P, FC_Q, FC_R, FC_S, FC_T, FC_U, FC_V, FC_W, FC_X, FC_Y, FC_Z,
+    FC_COUNT,
+    FC_NONE = FC_COUNT      // Ещё нет данных
+};
+
+enum WeatherIcon : uint8_t {
+    ICON_SUN = 0,
+    ICON_FEW_CLOUDS,
+    ICON_PARTLY,
+    ICON_CLOUDY,
+    ICON_OVERCAST,
+    ICON_SHOWERS,
+    ICON_RAIN,
+    ICON_STORM,
+    ICON_SNOW,
+    ICON_COUNT,
+    ICON_NONE = ICON_COUNT
+};
+
+enum FrostRisk : uint8_t {
+    FROST_0 = 0,
+    FROST_30,
+    FROST_70,
+    FROST_80,
+    FROST_100,
+    FROST_COUNT
+};
+
+// Строка - ступень давления снизу вверх, значение - буква
+constexpr uint8_t FC_FALLING[FC_STEPS] = {25, 25, 25, 25, 25, 25, 25, 25, 23, 23, 21, 20, 17, 14, 7, 3, 1, 1, 1, 0, 0, 0};
+constexpr uint8_t FC_STEADY[FC_STEPS]  = {25, 25, 25, 25, 25, 25, 23, 23, 22, 18, 15, 13, 10, 4, 1, 1, 0, 0, 0, 0, 0, 0};
+constexpr uint8_t FC_RISING[FC_STEPS]  = {25, 25, 25, 24, 24, 19, 16, 12, 11, 9, 8, 6, 5, 2, 1, 1, 0, 0, 0, 0, 0, 0};
+
+// Подпись для веба (латиница, как и прочие подписи хаба) и значок по букве
+struct ForecastInfo {
+    const char *text;
+    WeatherIcon icon;
+};
+
+constexpr ForecastInfo FC_INFO[FC_COUNT] = {
+    {"USTOYCHIVO YASNO", ICON_SUN},             // A
+    {"YASNO", ICON_SUN},                        // B
+    {"PROYASNENIE", ICON_FEW_CLOUDS},           // C
+    {"YASNO, UKHUDSHENIE", ICON_FEW_CLOUDS},    // D
+    {"YASNO, VOZM. LIVNI", ICON_PARTLY},        // E
+    {"MALO OBL, ULUCHSHENIE", ICON_FEW_CLOUDS}, // F
+    {"MALO OBL, LIVNI UTROM", ICON_PARTLY},     // G
+    {"MALO OBL, LIVNI POZZHE", ICON_PARTLY},    // H
+    {"LIVNI, ULUCHSHENIE", ICON_SHOWERS},       // I
+    {"PEREMENNO, ULUCHSHENIE", ICON_PARTLY},    // J
+    {"MALO OBL, VEROYATNY LIVNI", ICON_SHOWERS},// K
+    {"NEUSTOYCH., PROYASNENIE", ICON_CLOUDY},   // L
+    {"NEUSTOYCH., ULUCHSHENIE", ICON_CLOUDY},   // M
+    {"LIVNI S PROYASNENIYAMI", ICON_SHOWERS},   // N
+    {"LIVNI, UKHUDSHENIE", ICON_SHOWERS},       // O
+    {"PEREMENNO, DOZHD", ICON_RAIN},            // P
+    {"NEUSTOYCH., PROYASNENIYA", ICON_OVERCAST},// Q
+    {"NEUSTOYCH., DOZHD POZZHE", ICON_OVERCAST},// R
+    {"NEUSTOYCH., DOZHD", ICON_RAIN},           // S
+    {"OCHEN NEUSTOYCHIVO", ICON_RAIN},          // T
+    {"DOZHD, UKHUDSHENIE", ICON_RAIN},          // U
+    {"DOZHD, OCHEN NEUSTOYCH.", ICON_RAIN},     // V
+    {"CHASTY DOZHD", ICON_RAIN},                // W
+    {"OCHEN NEUSTOYCH., DOZHD", ICON_RAIN},     // X
+    {"SHTORM, VOZM. ULUCHSH.", ICON_STORM},     // Y
+    {"SHTORM, SILNY DOZHD", ICON_STORM}         // Z
+};
+
+// Значок для веба и короткая подпись для TFT (до 9 знаков, UTF-8)
+constexpr const char *ICON_EMOJI[ICON_COUNT + 1] = {
+    "☀️", "🌤️", "⛅", "🌥️", "☁️", "🌦️", "🌧️", "⛈️", "❄️", "---"
+};
+constexpr const char *ICON_TFT[ICON_COUNT + 1] = {
+    "ЯСНО", "МАЛООБЛ.", "ПЕРЕМ.ОБЛ", "ОБЛАЧНО", "ПАСМУРНО", "ЛИВНИ", "ДОЖДЬ", "ГРОЗА", "СНЕГ", "---"
+};
+// Класс плашки прогноза в web4.html
+constexpr const char *ICON_CLASS[ICON_COUNT + 1] = {
+    "forecast-sun", "forecast-sun", "forecast-cloud", "forecast-cloud", "forecast-cloud",
+    "forecast-rain", "forecast-rain", "forecast-rain", "forecast-rain", ""
+};
+constexpr const char *FROST_TEXT[FROST_COUNT] = {"0%", "30%", "70%", "80%", "100%"};
+
+// Давление станции -> уровень моря (барометрическая формула)
+inline float forecastSeaLevel(float stationHpa, float altitudeM, float tempC) {
+    if (altitudeM == 0) return stationHpa;
+    return stationHpa * powf(1.0f - 0.0065f * altitudeM / (tempC + 0.0065f * altitudeM + 273.15f), -5.257f);
+}
+
+// month 1..12, 0 - неизвестен (без сезонной поправки). Северное полушарие
+inline Forecast forecastZambretti(float seaHpa, float trend3hHpa, uint8_t month) {
+    bool summer = month >= 4 && month <= 9;
+    const uint8_t *table = FC_STEADY;
+    if (trend3hHpa >= FC_TREND_HPA) {
+        table = FC_RISING;
+        if (month != 0 && summer) seaHpa += FC_SEASON_SHIFT * FC_BARO_RANGE;
+    } else if (trend3hHpa <= -FC_TREND_HPA) {
+        table = FC_FALLING;
+        if (month != 0 && !summer) seaHpa -= FC_SEASON_SHIFT * FC_BARO_RANGE;
+    }
+    int step = (int)floorf((seaHpa - FC_BARO_BOTTOM) / (FC_BARO_RANGE / FC_STEPS));
+    if (step < 0) step = 0;
+    if (step >= FC_STEPS) step = FC_STEPS - 1;
+    return (Forecast)table[step];
+}
+
+// Осадки при морозе - снег
+inline WeatherIcon forecastIcon(Forecast f, float tempC) {
+    if (f >= FC_COUNT) return ICON_NONE;
+    WeatherIcon icon = FC_INFO[f].icon;
+    if (tempC <= 0 && (icon == ICON_SHOWERS || icon == ICON_RAIN)) return ICON_SNOW;
+    return icon;
+}
+
+inline bool forecastWet(WeatherIcon icon) { return icon >= ICON_SHOWERS && icon <= ICON_SNOW; }
+
+inline const char *forecastText(Forecast f) { return f < FC_COUNT ? FC_INFO[f].text : "---"; }
+inline char forecastLetter(Forecast f) { return f < FC_COUNT ? 'A' + f : '-'; }
+
+// Вечером и ночью в тёплый сезон; month 0 - риск неизвестен
+inline FrostRisk forecastFrost(float tempC, uint8_t hour, uint8_t month) {
+    if (month < 4 || month > 9) return FROST_0;
+    if (hour >= 20 && hour <= 22) {
+        if (tempC < 3.0f) return FROST_100;
+        if (tempC < 6.0f) return FROST_70;
+        if (tempC < 10.0f) return FROST_30;
+    }
+    if (hour <= 6) {
+        if (tempC < 2.0f) return FROST_100;
+        if (tempC < 5.0f) return FROST_80;
+    }
+    return FROST_0;
+}
+
+#endif
@@ -0,0 +1,263 @@
+// hub_font.h - Шрифт дисплея хаба 6x8 в формате GFXfont
+// Создан scripts/font_gen.py из fonts/hub_6x8.txt - не править вручную.
+#ifndef HUB_FONT_H
+#define HUB_FONT_H
+
+#include <Adafruit_GFX.h>
+
+#define HUB_FONT_GLYPHS     162
+#define HUB_FONT_ADVANCE    6
+#define HUB_FONT_HEIGHT     8
+#define HUB_FONT_BASELINE   7       // Строк над базовой линией
+#define HUB_FONT_PAGE_BITS  7       // Страница поиска - 128 кодов
+#define HUB_FONT_PAGE_COUNT 9
+#define HUB_FONT_MISSING    0xFF
+
+const uint8_t HubFont6x8Bitmaps[] PROGMEM = {
+    0xFA, 0xB6, 0x80, 0x52, 0xBE, 0xAF, 0xA9, 0x40, 0x23, 0xE8, 0xE2, 0xF8, 0x80, 0xC6, 0x44, 0x44,
+    0x4C, 0x60, 0x64, 0xA8, 0x8A, 0xC9, 0xA0, 0x58, 0x2A, 0x48, 0x88, 0x88, 0x92, 0xA0, 0x25, 0x5D,
+    0x52, 0x00, 0x21, 0x3E, 0x42, 0x00, 0xD8, 0xF8, 0xF0, 0x08, 0x88, 0x88, 0x00, 0x74, 0x67, 0x5C,
+    0xC5, 0xC0, 0x59, 0x24, 0xB8, 0x74, 0x42, 0x22, 0x23, 0xE0, 0xF8, 0x88, 0x20, 0xC5, 0xC0, 0x11,
+    0x95, 0x2F, 0x88, 0x40, 0xFC, 0x3C, 0x10, 0xC5, 0xC0, 0x32, 0x21, 0xE8, 0xC5, 0xC0, 0xF8, 0x44,
+    0x44, 0x21, 0x00, 0x74, 0x62, 0xE8, 0xC5, 0xC0, 0x74, 0x62, 0xF0, 0x89, 0x80, 0xF3, 0xC0, 0xF3,
+    0x60, 0x12, 0x48, 0x42, 0x10, 0xF8, 0x3E, 0x84, 0x21, 0x24, 0x80, 0x74, 0x42, 0x22, 0x00, 0x80,
+    0x74, 0x42, 0xDA, 0xD5, 0xC0, 0x74, 0x63, 0xF8, 0xC6, 0x20, 0xF4, 0x63, 0xE8, 0xC7, 0xC0, 0x74,
+    0x61, 0x08, 0x45, 0xC0, 0xE4, 0xA3, 0x18, 0xCB, 0x80, 0xFC, 0x21, 0xE8, 0x43, 0xE0, 0xFC, 0x21,
+    0xE8, 0x42, 0x00, 0x74, 0x61, 0x78, 0xC5, 0xE0, 0x8C, 0x63, 0xF8, 0xC6, 0x20, 0xE9, 0x24, 0xB8,
+    0x38, 0x84, 0x21, 0x49, 0x80, 0x8C, 0xA9, 0x8A, 0x4A, 0x20, 0x84, 0x21, 0x08, 0x43, 0xE0, 0x8E,
+    0xEB, 0x58, 0xC6, 0x20, 0x8C, 0x73, 0x59, 0xC6, 0x20, 0x74, 0x63, 0x18, 0xC5, 0xC0, 0xF4, 0x63,
+    0xE8, 0x42, 0x00, 0x74, 0x63, 0x1A, 0xC9, 0xA0, 0xF4, 0x63, 0xEA, 0x4A, 0x20, 0x7C, 0x20, 0xE0,
+    0x87, 0xC0, 0xF9, 0x08, 0x42, 0x10, 0x80, 0x8C, 0x63, 0x18, 0xC5, 0xC0, 0x8C, 0x63, 0x18, 0xA8,
+    0x80, 0x8C, 0x63, 0x5A, 0xD5, 0x40, 0x8C, 0x54, 0x45, 0x46, 0x20, 0x8C, 0x54, 0x42, 0x10, 0x80,
+    0xF8, 0x44, 0x44, 0x43, 0xE0, 0xF2, 0x49, 0x38, 0x82, 0x08, 0x20, 0x80, 0xE4, 0x92, 0x78, 0x22,
+    0xA2, 0xF8, 0x88, 0x80, 0x70, 0x5F, 0x17, 0x80, 0x84, 0x2D, 0x98, 0xC7, 0xC0, 0x74, 0x21, 0x17,
+    0x00, 0x08, 0x5B, 0x38, 0xC5, 0xE0, 0x74, 0x7F, 0x07, 0x00, 0x32, 0x51, 0xC4, 0x21, 0x00, 0x7C,
+    0x62, 0xF0, 0xB8, 0x84, 0x2D, 0x98, 0xC6, 0x20, 0x43, 0x24, 0xB8, 0x10, 0x31, 0x11, 0x96, 0x88,
+    0x9A, 0xCA, 0x90, 0xC9, 0x24, 0xB8, 0xD5, 0x6B, 0x18, 0x80, 0xB6, 0x63, 0x18, 0x80, 0x74, 0x63,
+    0x17, 0x00, 0xF4, 0x63, 0xE8, 0x40, 0x7C, 0x62, 0xF0, 0x84, 0xB6, 0x61, 0x08, 0x00, 0x74, 0x1C,
+    0x1F, 0x00, 0x42, 0x38, 0x84, 0x24, 0xC0, 0x8C, 0x63, 0x36, 0x80, 0x8C, 0x62, 0xA2, 0x00, 0x8C,
+    0x6B, 0x55, 0x00, 0x8A, 0x88, 0xA8, 0x80, 0x8C, 0x62, 0xF0, 0xB8, 0xF8, 0x88, 0x8F, 0x80, 0x29,
+    0x44, 0x88, 0xFE, 0x89, 0x14, 0xA0, 0x45, 0x44, 0x69, 0x96, 0x50, 0x3F, 0x0F, 0x43, 0xE0, 0x74,
+    0x63, 0xF8, 0xC6, 0x20, 0xFC, 0x21, 0xE8, 0xC7, 0xC0, 0xF4, 0x63, 0xE8, 0xC7, 0xC0, 0xFC, 0x21,
+    0x08, 0x42, 0x00, 0x32, 0x94, 0xA5, 0x7E, 0x20, 0xFC, 0x21, 0xE8, 0x43, 0xE0, 0xAD, 0x6A, 0xEA,
+    0xD6, 0xA0, 0x74, 0x42, 0x60, 0xC5, 0xC0, 0x8C, 0x67, 0x5C, 0xC6, 0x20, 0x51, 0x23, 0x3A, 0xE6,
+    0x20, 0x8C, 0xA9, 0x8A, 0x4A, 0x20, 0x3A, 0x52, 0x94, 0xA6, 0x20, 0x8E, 0xEB, 0x58, 0xC6, 0x20,
+    0x8C, 0x63, 0xF8, 0xC6, 0x20, 0x74, 0x63, 0x18, 0xC5, 0xC0, 0xFC, 0x63, 0x18, 0xC6, 0x20, 0xF4,
+    0x63, 0xE8, 0x42, 0x00, 0x74, 0x61, 0x08, 0x45, 0xC0, 0xF9, 0x08, 0x42, 0x10, 0x80, 0x8C, 0x62,
+    0xF0, 0xC5, 0xC0, 0x23, 0xAB, 0x5A, 0xB8, 0x80, 0x8C, 0x54, 0x45, 0x46, 0x20, 0x94, 0xA5, 0x29,
+    0x4B, 0xE1, 0x8C, 0x62, 0xF0, 0x84, 0x20, 0xAD, 0x6B, 0x5A, 0xD7, 0xE0, 0xAD, 0x6B, 0x5A, 0xD7,
+    0xE1, 0xC2, 0x10, 0xE4, 0xA5, 0xC0, 0x8C, 0x63, 0x9A, 0xD7, 0x20, 0x84, 0x21, 0xE8, 0xC7, 0xC0,
+    0x74, 0x42, 0xF0, 0xC5, 0xC0, 0x95, 0x6B, 0xDA, 0xD6, 0x40, 0x7C, 0x62, 0xF2, 0xA6, 0x20, 0x70,
+    0x5F, 0x17, 0x80, 0x3A, 0x21, 0xE8, 0xC5, 0xC0, 0xF4, 0x7D, 0x1F, 0x00, 0xFC, 0x21, 0x08, 0x00,
+    0x32, 0x95, 0xF8, 0x80, 0x74, 0x7F, 0x07, 0x00, 0xAD, 0x5D, 0x5A, 0x80, 0x74, 0x4D, 0x17, 0x00,
+    0x8C, 0xEB, 0x98, 0x80, 0x51, 0x23, 0x3A, 0xE6, 0x20, 0x9A, 0xCA, 0x90, 0x3A, 0x52, 0x98, 0x80,
+    0x8E, 0xEB, 0x18, 0x80, 0x8C, 0x7F, 0x18, 0x80, 0x74, 0x63, 0x17, 0x00, 0xFC, 0x63, 0x18, 0x80,
+    0xF4, 0x63, 0xE8, 0x40, 0x74, 0x21, 0x17, 0x00, 0xF9, 0x08, 0x42, 0x00, 0x8C, 0x62, 0xF0, 0xB8,
+    0x23, 0xAB, 0x57, 0x10, 0x8A, 0x88, 0xA8, 0x80, 0x94, 0xA5, 0x2F, 0x84, 0x8C, 0x5E, 0x10, 0x80,
+    0xAD, 0x6B, 0x5F, 0x80, 0xAD, 0x6B, 0x5F, 0x84, 0xC2, 0x1C, 0x97, 0x00, 0x8C, 0x73, 0x5C, 0x80,
+    0x84, 0x3D, 0x1F, 0x00, 0x74, 0x4F, 0x17, 0x00, 0x95, 0x7B, 0x59, 0x00, 0x7C, 0x5E, 0x98, 0x80,
+    0x50, 0x1D, 0x1F, 0xC1, 0xC0,
+};
+
+const GFXglyph HubFont6x8Glyphs[] PROGMEM = {
+    {   0, 0, 0, 6, 0,  0},   // U+0020 ' '
+    {   0, 1, 7, 6, 2, -7},   // U+0021 '!'
+    {   1, 3, 3, 6, 1, -7},   // U+0022 '"'
+    {   3, 5, 7, 6, 0, -7},   // U+0023 '#'
+    {   8, 5, 7, 6, 0, -7},   // U+0024 '$'
+    {  13, 5, 7, 6, 0, -7},   // U+0025 '%'
+    {  18, 5, 7, 6, 0, -7},   // U+0026 '&'
+    {  23, 2, 3, 6, 1, -7},   // U+0027 '''
+    {  24, 3, 7, 6, 1, -7},   // U+0028 '('
+    {  27, 3, 7, 6, 1, -7},   // U+0029 ')'
+    {  30, 5, 5, 6, 0, -6},   // U+002A '*'
+    {  34, 5, 5, 6, 0, -6},   // U+002B '+'
+    {  38, 2, 3, 6, 1, -2},   // U+002C ','
+    {  39, 5, 1, 6, 0, -4},   // U+002D '-'
+    {  40, 2, 2, 6, 1, -2},   // U+002E '.'
+    {  41, 5, 5, 6, 0, -6},   // U+002F '/'
+    {  45, 5, 7, 6, 0, -7},   // U+0030 '0'
+    {  50, 3, 7, 6, 1, -7},   // U+0031 '1'
+    {  53, 5, 7, 6, 0, -7},   // U+0032 '2'
+    {  58, 5, 7, 6, 0, -7},   // U+0033 '3'
+    {  63, 5, 7, 6, 0, -7},   // U+0034 '4'
+    {  68, 5, 7, 6, 0, -7},   // U+0035 '5'
+    {  73, 5, 7, 6, 0, -7},   // U+0036 '6'
+    {  78, 5, 7, 6, 0, -7},   // U+0037 '7'
+    {  83, 5, 7, 6, 0, -7},   // U+0038 '8'
+    {  88, 5, 7, 6, 0, -7},   // U+0039 '9'
+    {  93, 2, 5, 6, 1, -6},   // U+003A ':'
+    {  95, 2, 6, 6, 1, -6},   // U+003B ';'
+    {  97, 4, 7, 6, 0, -7},   // U+003C '<'
+    { 101, 5, 3, 6, 0, -5},   // U+003D '='
+    { 103, 4, 7, 6, 1, -7},   // U+003E '>'
+    { 107, 5, 7, 6, 0, -7},   // U+003F '?'
+    { 112, 5, 7, 6, 0, -7},   // U+0040 '@'
+    { 117, 5, 7, 6, 0, -7},   // U+0041 'A'
+    { 122, 5, 7, 6, 0, -7},   // U+0042 'B'
+    { 127, 5, 7, 6, 0, -7},   // U+0043 'C'
+    { 132, 5, 7, 6, 0, -7},   // U+0044 'D'
+    { 137, 5, 7, 6, 0, -7},   // U+0045 'E'
+    { 142, 5, 7, 6, 0, -7},   // U+0046 'F'
+    { 147, 5, 7, 6, 0, -7},   // U+0047 'G'
+    { 152, 5, 7, 6, 0, -7},   // U+0048 'H'
+    { 157, 3, 7, 6, 1, -7},   // U+0049 'I'
+    { 160, 5, 7, 6, 0, -7},   // U+004A 'J'
+    { 165, 5, 7, 6, 0, -7},   // U+004B 'K'
+    { 170, 5, 7, 6, 0, -7},   // U+004C 'L'
+    { 175, 5, 7, 6, 0, -7},   // U+004D 'M'
+    { 180, 5, 7, 6, 0, -7},   // U+004E 'N'
+    { 185, 5, 7, 6, 0, -7},   // U+004F 'O'
+    { 190, 5, 7, 6, 0, -7},   // U+0050 'P'
+    { 195, 5, 7, 6, 0, -7},   // U+0051 'Q'
+    { 200, 5, 7, 6, 0, -7},   // U+0052 'R'
+    { 205, 5, 7, 6, 0, -7},   // U+0053 'S'
+    { 210, 5, 7, 6, 0, -7},   // U+0054 'T'
+    { 215, 5, 7, 6, 0, -7},   // U+0055 'U'
+    { 220, 5, 7, 6, 0, -7},   // U+0056 'V'
+    { 225, 5, 7, 6, 0, -7},   // U+0057 'W'
+    { 230, 5, 7, 6, 0, -7},   // U+0058 'X'
+    { 235, 5, 7, 6, 0, -7},   // U+0059 'Y'
+    { 240, 5, 7, 6, 0, -7},   // U+005A 'Z'
+    { 245, 3, 7, 6, 1, -7},   // U+005B '['
+    { 248, 5, 5, 6, 0, -6},   // U+005C '\\'
+    { 252, 3, 7, 6, 1, -7},   // U+005D ']'
+    { 255, 5, 3, 6, 0, -7},   // U+005E '^'
+    { 257, 5, 1, 6, 0,  0},   // U+005F '_'
+    { 258, 3, 3, 6, 1, -7},   // U+0060 '`'
+    { 260, 5, 5, 6, 0, -5},   // U+0061 'a'
+    { 264, 5, 7, 6, 0, -7},   // U+0062 'b'
+    { 269, 5, 5, 6, 0, -5},   // U+0063 'c'
+    { 273, 5, 7, 6, 0, -7},   // U+0064 'd'
+    { 278, 5, 5, 6, 0, -5},   // U+0065 'e'
+    { 282, 5, 7, 6, 0, -7},   // U+0066 'f'
+    { 287, 5, 6, 6, 0, -5},   // U+0067 'g'
+    { 291, 5, 7, 6, 0, -7},   // U+0068 'h'
+    { 296, 3, 7, 6, 1, -7},   // U+0069 'i'
+    { 299, 4, 8, 6, 0, -7},   // U+006A 'j'
+    { 303, 4, 7, 6, 0, -7},   // U+006B 'k'
+    { 307, 3, 7, 6, 1, -7},   // U+006C 'l'
+    { 310, 5, 5, 6, 0, -5},   // U+006D 'm'
+    { 314, 5, 5, 6, 0, -5},   // U+006E 'n'
+    { 318, 5, 5, 6, 0, -5},   // U+006F 'o'
+    { 322, 5, 6, 6, 0, -5},   // U+0070 'p'
+    { 326, 5, 6, 6, 0, -5},   // U+0071 'q'
+    { 330, 5, 5, 6, 0, -5},   // U+0072 'r'
+    { 334, 5, 5, 6, 0, -5},   // U+0073 's'
+    { 338, 5, 7, 6, 0, -7},   // U+0074 't'
+    { 343, 5, 5, 6, 0, -5},   // U+0075 'u'
+    { 347, 5, 5, 6, 0, -5},   // U+0076 'v'
+    { 351, 5, 5, 6, 0, -5},   // U+0077 'w'
+    { 355, 5, 5, 6, 0, -5},   // U+0078 'x'
+    { 359, 5, 6, 6, 0, -5},   // U+0079 'y'
+    { 363, 5, 5, 6, 0, -5},   // U+007A 'z'
+    { 367, 3, 7, 6, 1, -7},   // U+007B '{'
+    { 370, 1, 7, 6, 2, -7},   // U+007C '|'
+    { 371, 3, 7, 6, 1, -7},   // U+007D '}'
+    { 374, 5, 3, 6, 0, -5},   // U+007E '~'
+    { 376, 4, 4, 6, 0, -7},   // U+00B0 '°'
+    { 378, 5, 7, 6, 0, -7},   // U+0401 'Ё'
+    { 383, 5, 7, 6, 0, -7},   // U+0410 'А'
+    { 388, 5, 7, 6, 0, -7},   // U+0411 'Б'
+    { 393, 5, 7, 6, 0, -7},   // U+0412 'В'
+    { 398, 5, 7, 6, 0, -7},   // U+0413 'Г'
+    { 403, 5, 7, 6, 0, -7},   // U+0414 'Д'
+    { 408, 5, 7, 6, 0, -7},   // U+0415 'Е'
+    { 413, 5, 7, 6, 0, -7},   // U+0416 'Ж'
+    { 418, 5, 7, 6, 0, -7},   // U+0417 'З'
+    { 423, 5, 7, 6, 0, -7},   // U+0418 'И'
+    { 428, 5, 7, 6, 0, -7},   // U+0419 'Й'
+    { 433, 5, 7, 6, 0, -7},   // U+041A 'К'
+    { 438, 5, 7, 6, 0, -7},   // U+041B 'Л'
+    { 443, 5, 7, 6, 0, -7},   // U+041C 'М'
+    { 448, 5, 7, 6, 0, -7},   // U+041D 'Н'
+    { 453, 5, 7, 6, 0, -7},   // U+041E 'О'
+    { 458, 5, 7, 6, 0, -7},   // U+041F 'П'
+    { 463, 5, 7, 6, 0, -7},   // U+0420 'Р'
+    { 468, 5, 7, 6, 0, -7},   // U+0421 'С'
+    { 473, 5, 7, 6, 0, -7},   // U+0422 'Т'
+    { 478, 5, 7, 6, 0, -7},   // U+0423 'У'
+    { 483, 5, 7, 6, 0, -7},   // U+0424 'Ф'
+    { 488, 5, 7, 6, 0, -7},   // U+0425 'Х'
+    { 493, 5, 8, 6, 0, -7},   // U+0426 'Ц'
+    { 498, 5, 7, 6, 0, -7},   // U+0427 'Ч'
+    { 503, 5, 7, 6, 0, -7},   // U+0428 'Ш'
+    { 508, 5, 8, 6, 0, -7},   // U+0429 'Щ'
+    { 513, 5, 7, 6, 0, -7},   // U+042A 'Ъ'
+    { 518, 5, 7, 6, 0, -7},   // U+042B 'Ы'
+    { 523, 5, 7, 6, 0, -7},   // U+042C 'Ь'
+    { 528, 5, 7, 6, 0, -7},   // U+042D 'Э'
+    { 533, 5, 7, 6, 0, -7},   // U+042E 'Ю'
+    { 538, 5, 7, 6, 0, -7},   // U+042F 'Я'
+    { 543, 5, 5, 6, 0, -5},   // U+0430 'а'
+    { 547, 5, 7, 6, 0, -7},   // U+0431 'б'
+    { 552, 5, 5, 6, 0, -5},   // U+0432 'в'
+    { 556, 5, 5, 6, 0, -5},   // U+0433 'г'
+    { 560, 5, 5, 6, 0, -5},   // U+0434 'д'
+    { 564, 5, 5, 6, 0, -5},   // U+0435 'е'
+    { 568, 5, 5, 6, 0, -5},   // U+0436 'ж'
+    { 572, 5, 5, 6, 0, -5},   // U+0437 'з'
+    { 576, 5, 5, 6, 0, -5},   // U+0438 'и'
+    { 580, 5, 7, 6, 0, -7},   // U+0439 'й'
+    { 585, 4, 5, 6, 0, -5},   // U+043A 'к'
+    { 588, 5, 5, 6, 0, -5},   // U+043B 'л'
+    { 592, 5, 5, 6, 0, -5},   // U+043C 'м'
+    { 596, 5, 5, 6, 0, -5},   // U+043D 'н'
+    { 600, 5, 5, 6, 0, -5},   // U+043E 'о'
+    { 604, 5, 5, 6, 0, -5},   // U+043F 'п'
+    { 608, 5, 6, 6, 0, -5},   // U+0440 'р'
+    { 612, 5, 5, 6, 0, -5},   // U+0441 'с'
+    { 616, 5, 5, 6, 0, -5},   // U+0442 'т'
+    { 620, 5, 6, 6, 0, -5},   // U+0443 'у'
+    { 624, 5, 6, 6, 0, -6},   // U+0444 'ф'
+    { 628, 5, 5, 6, 0, -5},   // U+0445 'х'
+    { 632, 5, 6, 6, 0, -5},   // U+0446 'ц'
+    { 636, 5, 5, 6, 0, -5},   // U+0447 'ч'
+    { 640, 5, 5, 6, 0, -5},   // U+0448 'ш'
+    { 644, 5, 6, 6, 0, -5},   // U+0449 'щ'
+    { 648, 5, 5, 6, 0, -5},   // U+044A 'ъ'
+    { 652, 5, 5, 6, 0, -5},   // U+044B 'ы'
+    { 656, 5, 5, 6, 0, -5},   // U+044C 'ь'
+    { 660, 5, 5, 6, 0, -5},   // U+044D 'э'
+    { 664, 5, 5, 6, 0, -5},   // U+044E 'ю'
+    { 668, 5, 5, 6, 0, -5},   // U+044F 'я'
+    { 672, 5, 7, 6, 0, -7},   // U+0451 'ё'
+};
+
+// first..last - латиница: с setFont() шрифт рисует ASCII как обычный GFXfont
+const GFXfont HubFont6x8 PROGMEM = {(uint8_t *)HubFont6x8Bitmaps, (GFXglyph *)HubFont6x8Glyphs, 0x20, 0x7E, 8};
+
+// Код Unicode -> номер знака: HubFontPages[cp >> 7][cp & 127]
+const uint8_t HubFontPage0[128] PROGMEM = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F,
+    0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F,
+    0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0x3E, 0x3F,
+    0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x4B, 0x4C, 0x4D, 0x4E, 0x4F,
+    0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x5B, 0x5C, 0x5D, 0x5E, 0xFF,
+};
+const uint8_t HubFontPage1[128] PROGMEM = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0x5F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+const uint8_t HubFontPage8[128] PROGMEM = {
+    0xFF, 0x60, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x6B, 0x6C, 0x6D, 0x6E, 0x6F, 0x70,
+    0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x7B, 0x7C, 0x7D, 0x7E, 0x7F, 0x80,
+    0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8A, 0x8B, 0x8C, 0x8D, 0x8E, 0x8F, 0x90,
+    0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0x9B, 0x9C, 0x9D, 0x9E, 0x9F, 0xA0,
+    0xFF, 0xA1, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+const uint8_t *const HubFontPages[HUB_FONT_PAGE_COUNT] PROGMEM = {HubFontPage0, HubFontPage1, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, HubFontPage8};
+
+#endif
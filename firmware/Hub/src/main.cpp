@@ -16,6 +16,9 @@
 #include <esp_now.h>
 #include <ArduinoJson.h>
 #include <math.h>
+#include <memory>
+#include <rom/crc.h>
+#include <unistd.h>
 
 // ========== БИБЛИОТЕКИ ДЛЯ ПЕРИФЕРИИ ==========
 #include <SPI.h>
@@ -26,10 +29,33 @@
 #include <Adafruit_ST7735.h>
 #include <RTClib.h>
 #include <Fonts/FreeMonoBold9pt7b.h>  // Жирный шрифт для часов
-#include <Fonts/FreeSansBold9pt7b.h>  // Жирный Sans-serif
 
-// ========== РУССКИЙ ТРАНСЛИТ ==========
-#include "rus_font.h"
+// ========== ПРОТОКОЛ WEBSOCKET (JSON / MessagePack) ==========
+#include "ws_proto.h"
+
+// ========== ХРАНИЛИЩЕ ВРЕМЕННЫХ РЯДОВ ==========
+#include "ts_store.h"
+
+// ========== ИСТОРИЯ ДАВЛЕНИЯ И ТРЕНДЫ ==========
+#include "pressure_history.h"
+
+// ========== СУТОЧНАЯ СТАТИСТИКА УЗЛОВ ==========
+#include "node_stats.h"
+
+// ========== СУТОЧНЫЕ ГРАФИКИ ==========
+#include "spark_history.h"
+
+// ========== ПРОГНОЗ ПОГОДЫ ==========
+#include "forecast.h"
+
+// ========== ПРАВИЛА ТРЕВОГ ==========
+#include "rules.h"
+
+// ========== СООБЩЕНИЯ WEBSOCKET ==========
+#include "ws_messages.h"
+
+// ========== СТРАНИЦЫ ДИСПЛЕЯ ==========
+#include "tft_pages.h"
 
 // ========== ПИНЫ ДИСПЛЕЯ (VSPI) ==========
 #define TFT_CS    5
@@ -86,34 +112,15 @@ unsigned long connectionLostTime[NODE_COUNT] = {0, 0, 0, 0};
 bool nodeAlarmState[NODE_COUNT] = {false, false, false, false};
 
 // ========== ДАННЫЕ УЗЛОВ ДЛЯ ДИСПЛЕЯ ==========
-struct NodeDisplayData {
-    int id;
-    float temp;
-    float hum;
-    float press;
-    bool alarm;
-    bool led_state;
-    bool connected;
-    float wind_angle;
-    float wind_sector;
-    bool magnet;
-    bool contact1;
-    bool contact2;
-} nodeDisplayData[4] = {
-    {102, 0, 0, 0, false, false, false, 0, 0, false, false, false},
-    {103, 0, 0, 0, false, false, false, 0, 0, false, false, false},
-    {104, 0, 0, 0, false, false, false, 0, 0, false, false, false},
-    {105, 0, 0, 0, false, false, false, 0, 0, false, false, false}
+NodeDisplayData nodeDisplayData[4] = {
+    {102, 0, 0, 0, false, false, false, 0, 0, false, false, false, 0},
+    {103, 0, 0, 0, false, false, false, 0, 0, false, false, false, 0},
+    {104, 0, 0, 0, false, false, false, 0, 0, false, false, false, 0},
+    {105, 0, 0, 0, false, false, false, 0, 0, false, false, false, 0}
 };
 
 // ========== ДАННЫЕ ТЕПЛИЦЫ ДЛЯ ДИСПЛЕЯ ==========
-struct GreenhouseDisplayData {
-    float temp_in;
-    float temp_out;
-    int hum_in;
-    bool relay1;
-    bool relay2;
-} greenhouseDisplay = {0, 0, 0, false, false};
+GreenhouseDisplayData greenhouseDisplay = {0, 0, 0, false, false};
 
 // ========== ESP-NOW СТРУКТУРЫ ==========
 typedef struct esp_now_message {
@@ -141,6 +148,76 @@ AsyncWebSocket ws("/ws");
 esp_now_message outgoingMessage;
 esp_now_message incomingMessage;
 
+// ========== КЛИЕНТЫ WEBSOCKET ==========
+// Формат выбирается при подключении (/ws?proto=msgpack) или первым
+// сообщением {"proto":"msgpack"}; по умолчанию - JSON как раньше.
+#define WS_MAX_CLIENTS 8
+
+// Бюджет исходящих сообщений на клиента (token bucket).
+// Медленный клиент теряет только периодические обновления и получает
+// снимок состояния, когда догонит; зависший клиент отключается.
+#define WS_BUDGET_MSGS            20      // Запас сообщений (всплеск)
+#define WS_BUDGET_MSGS_PER_SEC    5       // Пополнение сообщений в секунду
+#define WS_BUDGET_BYTES           6144    // Запас байт (всплеск)
+#define WS_BUDGET_BYTES_PER_SEC   3072    // Пополнение байт в секунду
+#define WS_SNAPSHOT_MIN_MSGS      10      // Сколько сообщений нужно накопить для снимка
+#define WS_STALL_TIMEOUT_MS       15000   // Очередь полна дольше - отключаем
+#define WS_SERVICE_INTERVAL_MS    250
+#define WS_MIN_FREE_HEAP          40000   // Ниже - рассылаем только события
+
+enum WsPriority : uint8_t {
+    WS_PRIO_STATE,   // Периодическое состояние: можно пропустить, придёт в снимке
+    WS_PRIO_EVENT    // Тревоги, подтверждения, связь: отправляются всегда
+};
+
+struct WsClientSlot {
+    bool used;
+    uint32_t id;
+    WsFormat format;
+    int32_t msgCredit;         // В тысячных долях сообщения
+    int32_t byteCredit;
+    unsigned long lastRefill;
+    unsigned long stalledSince; // 0 - очередь клиента не переполнена
+    bool needsResync;
+    uint32_t dropped;
+};
+WsClientSlot wsClients[WS_MAX_CLIENTS];
+portMUX_TYPE wsClientsMux = portMUX_INITIALIZER_UNLOCKED;
+unsigned long lastWsServiceTime = 0;
+
+// ========== КОМАНДЫ УЗЛАМ ==========
+// Каждая команда из браузера получает ID хаба и ждёт подтверждения узла.
+// Ответ (успех/ошибка и время в пути) уходит только клиенту-отправителю.
+#define CMD_MAX_PENDING      16
+#define CMD_MAX_LEN          16
+#define CMD_TIMEOUT_MS       3000
+#define CMD_LATENCY_SAMPLES  32
+
+struct PendingCommand {
+    bool used;
+    bool delivered;           // ESP-NOW подтвердил доставку на MAC-уровне
+    uint16_t id;
+    uint32_t clientId;
+    int32_t clientReq;        // "req" из сообщения клиента, -1 если не было
+    int nodeId;
+    int nodeIndex;
+    char command[CMD_MAX_LEN];
+    unsigned long sentAt;
+};
+PendingCommand pendingCommands[CMD_MAX_PENDING];
+uint16_t nextCommandId = 1;
+
+struct CommandStats {
+    uint16_t latencyMs[CMD_LATENCY_SAMPLES];   // Кольцо последних времён в пути
+    uint8_t latencyIndex;
+    uint8_t latencyCount;
+    uint32_t ok;
+    uint32_t failed;
+};
+CommandStats commandStats[NODE_COUNT];
+bool nodeAcksWithId[NODE_COUNT] = {false, false, false, false};  // Узел прислал ack с id - прошивка новая
+portMUX_TYPE commandsMux = portMUX_INITIALIZER_UNLOCKED;
+
 unsigned long lastGreenhouseUpdate = 0;
 const unsigned long GREENHOUSE_UPDATE_INTERVAL = 30000;
 bool securityAlarmActive = false;
@@ -148,41 +225,30 @@ unsigned long alarmStartTime = 0;
 const unsigned long ALARM_DURATION_MS = 10000;
 
 // ========== ДАННЫЕ ЭНКОДЕРА ==========
-#define ENCODER_HISTORY_SIZE 60
+#include "wind_engine.h"
+
 #define ENCODER_BROADCAST_INTERVAL 5000
-#define HISTORY_PERIOD_MS 60000
 
-float prevEncoderAngle = -1.0;
-float currentEncoderAngle = -1.0;
+// Показания идут из задачи WiFi, корзины закрывает loop(), окна читает
+// async_tcp - windEngine трогается только под windMux. Под ним же пишутся
+// производные ниже, чтобы async_tcp снимал их одним набором
+WindEngine windEngine;
+portMUX_TYPE windMux = portMUX_INITIALIZER_UNLOCKED;
+// Производные от windEngine за минутное окно - для дисплея и снимка состояния
 float windDirection = 0.0;
-float windCurrentSector = 0.0;
+float windCurrentSector = 0.0;      // 2σ кругового разброса
 bool windMagnet = false;
-float encoderHistory[ENCODER_HISTORY_SIZE];
-unsigned long historyTimestamps[ENCODER_HISTORY_SIZE];
-int historyIndex = 0;
-int historyCount = 0;
-float maxSectorStart = 0.0;
+float maxSectorStart = 0.0;         // Самый широкий порыв (корзина 5 с) за минуту
 float maxSectorEnd = 0.0;
 float maxSectorWidth = 0.0;
-unsigned long maxSectorTimestamp = 0;
-float currentSectorStart = 0.0;
-float currentSectorEnd = 0.0;
 unsigned long lastEncoderBroadcastTime = 0;
 
 // ========== ДАННЫЕ МЕТЕОСТАНЦИИ ==========
-#define PRESSURE_HISTORY_SIZE 48
 #define FROST_CHECK_HOUR 21
+#define STATION_ALTITUDE_M 0        // Высота узла 102 над уровнем моря для Zambretti
 
-struct WeatherData {
-    float pressure;
-    float temperature;
-    float humidity;
-    unsigned long timestamp;
-};
-
-WeatherData weatherHistory[PRESSURE_HISTORY_SIZE];
-int weatherIndex = 0;
-int weatherCount = 0;
+// Давление узла 102: 5-минутные корзины за 12 ч и 30-минутные за 24 ч
+PressureHistory pressureHistory;
 
 float currentPressure = 0;
 float currentTemp = 0;
@@ -192,21 +258,45 @@ float pressureTrend6h = 0;
 float pressureTrend12h = 0;
 float tempTrend3h = 0;
 
-String shortForecast = "---";
-String frostRisk = "0%";
-String weatherIcon = "---";
+Forecast weatherForecast = FC_NONE;
+WeatherIcon weatherIcon = ICON_NONE;
+FrostRisk frostRisk = FROST_0;
 unsigned long lastForecastUpdate = 0;
 const unsigned long FORECAST_UPDATE_INTERVAL = 1800000;
 
 // ========== ПЕРЕМЕННЫЕ ДЛЯ ДИСПЛЕЯ ==========
 int displayNodeIndex = 0;
 const int NODE_COUNT_DISP = 4;
+
+// Страницы и статистика отрисовки
+HubDisplay hubDisplay(tft);
+
+struct DisplayTaskStats {
+    uint32_t invalidations; // Пометок от обработчиков
+    uint32_t frames;        // Кадров задачи дисплея
+    uint32_t frameUs;       // Последний кадр: снимок + отрисовка
+    uint32_t maxFrameUs;
+    uint32_t ingestMaxUs;   // Самая долгая обработка пакета ESP-NOW
+} displayTaskStats;
+
+// Статистика за сутки по узлу и метрике (TS_TEMP, TS_HUM, TS_PRESS)
+#define NODE_STATS_METRICS 3
+RunningStats nodeStats[NODE_COUNT_DISP][NODE_STATS_METRICS];
+portMUX_TYPE nodeStatsMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Суточные графики (под nodeStatsMux): узлы - температура и давление,
+// метеостанция - уличная температура теплицы и 30-минутное кольцо pressureHistory
+SparkHistory nodeSparkTemp[NODE_COUNT_DISP];
+SparkHistory nodeSparkPress[NODE_COUNT_DISP];
+SparkHistory weatherSparkTemp;
+SparkSeries weatherSparkPress;
 bool alarmBlinkState = false;
 unsigned long lastBlinkTime = 0;
 
 // ========== ПЕРЕМЕННЫЕ ДЛЯ RTC ==========
 bool rtcOK = false;
 DateTime lastRTCRead;
+volatile uint32_t lastRTCUnix = 0;  // lastRTCRead.unixtime() для обработчиков других задач
 uint32_t lastRTCReadTime = 0;
 const uint32_t RTC_READ_INTERVAL = 500;
 char timeStr[20];
@@ -218,11 +308,389 @@ bool sdInitialized = false;
 uint32_t sdWriteCount = 0;
 uint32_t lastSDWrite = 0;
 const uint32_t SD_WRITE_INTERVAL = 60000;
-uint64_t sdTotalBytes = 0;
-uint64_t sdUsedBytes = 0;
+uint64_t sdTotalBytes = 0;    // Байты
+uint64_t sdUsedBytes = 0;     // Байты; после старта учитываются инкрементально
 uint8_t sdCardType = 0;
 char sdErrorMsg[32] = "";
 
+// ========== ЛОГГЕР SD ==========
+// loop() копит записи в активной половине двойного буфера; заполненная половина
+// передаётся задаче SD, которая пишет на карту целыми блоками по 512 байт.
+// Файл - один на сутки: /log/YYYYMMDD.csv, заголовок пишется при создании.
+// Последнее поле строки - CRC32 всего, что до него: при старте по ней
+// находится последняя целая строка (см. sdLogValidEnd).
+#define SD_MAX_OPEN_FILES   8         // Лог и журнал открыты постоянно, плюс ряды и HTTP
+#define SD_LOG_DIR          "/log"
+#define SD_LOG_HEADER       "DateTime,Pressure,Temp,Hum,CRC32\n"
+#define SD_LOG_HEADER_V1    "DateTime,Pressure,Temp,Hum\n"    // Файлы прошлой прошивки, без CRC32
+#define SD_LOG_BUFFER_SIZE  2048
+#define SD_LOG_BLOCK_SIZE   512
+#define SD_LOG_MAX_AGE_MS   600000    // Неполный блок всё равно сбрасывается раз в 10 минут
+#define SD_LOG_RECOVER_SCAN 32768     // Хвост для восстановления: не меньше кластера FAT32 с нулями
+
+struct SdLogBuffer {
+    char data[SD_LOG_BUFFER_SIZE];
+    uint16_t len;
+    uint32_t day;           // Сутки записей (unixtime / 86400)
+    volatile bool busy;     // Передан задаче SD и ещё не записан
+};
+SdLogBuffer sdLogBufs[2];
+uint8_t sdLogActive = 0;
+uint32_t sdLogOldestMs = 0;         // millis() первой записи в активной половине
+uint32_t sdLogDropped = 0;          // Записи, потерянные из-за отставания карты
+volatile bool sdWriteFailed = false;
+
+// Открытый файл суток - им владеет задача SD
+struct SdLogFile {
+    File file;
+    char path[24];
+    uint32_t day;
+    uint32_t fileSize;
+    char carry[SD_LOG_BLOCK_SIZE];  // Начало неполного блока, ждёт следующих данных
+    uint16_t carryLen;
+} sdLogFile;
+
+// ========== ЗАДАЧА SD ==========
+// С картой работает только эта задача: запись лога и чтения для HTTP проходят
+// через одну очередь и не перебивают друг друга. Чтения ставятся в начало очереди.
+#define SD_TASK_CORE        0
+#define SD_TASK_STACK       8192    // Сжатие суток держит на стеке ~2 КБ блоков
+#define SD_TASK_PRIORITY    2
+#define SD_QUEUE_LEN        8
+#define SD_HIST_BUCKETS     10
+
+typedef void (*SdCallFn)(void *ctx);
+
+enum SdJobType : uint8_t {
+    SD_JOB_WRITE,           // Записать половину буфера лога
+    SD_JOB_CALL             // Выполнить fn(ctx) и разбудить ожидающую задачу, если она есть
+};
+
+struct SdJob {
+    SdJobType type;
+    uint8_t buffer;         // SD_JOB_WRITE: индекс в sdLogBufs
+    bool sync;              // SD_JOB_WRITE: дописать и неполный блок
+    SdCallFn fn;
+    void *ctx;
+    TaskHandle_t waiter;
+    uint32_t queuedUs;
+};
+
+// Верхние границы корзин гистограммы, мс; последняя корзина - всё, что дольше
+const uint16_t SD_HIST_LIMITS_MS[SD_HIST_BUCKETS - 1] = {1, 2, 5, 10, 20, 50, 100, 200, 500};
+
+struct SdLatencyStats {
+    uint32_t count;
+    uint32_t maxUs;
+    uint32_t buckets[SD_HIST_BUCKETS];
+};
+
+TaskHandle_t sdTaskHandle = nullptr;
+QueueHandle_t sdQueue = nullptr;
+SdLatencyStats sdWriteStats = {};   // Фоновые записи: лог, временные ряды
+SdLatencyStats sdReadStats = {};    // Запрос HTTP: ожидание в очереди + работа с картой
+portMUX_TYPE sdStatsMux = portMUX_INITIALIZER_UNLOCKED;
+
+// ========== ВЕБ-ИНТЕРФЕЙС ==========
+// index.html(.gz) читается с SD один раз при старте; если помещается -
+// хранится в RAM. Браузер перепроверяет страницу по ETag и получает 304.
+#define WEB_CACHE_MAX_BYTES      32768
+#define WEB_INDEX_CACHE_CONTROL  "no-cache"
+#define WEB_ASSETS_CACHE_CONTROL "public, max-age=31536000, immutable"
+
+struct WebAsset {
+    bool found;
+    bool gzip;
+    char path[20];
+    size_t size;
+    uint8_t *ram;       // nullptr - отдаём с SD
+    char etag[12];      // "%08x" от CRC32 содержимого, в кавычках
+} indexPage = {false, false, "", 0, nullptr, ""};
+
+// ========== ВРЕМЕННЫЕ РЯДЫ ==========
+// Показания всех узлов и теплицы усредняются за минуту и раз в минуту одним
+// пакетом уходят задаче SD: /ts/<узел>_<величина>/YYYYMMDD.bin (см. ts_store.h)
+// Параллельно ведутся агрегаты минута -> час -> сутки; закрытые час и сутки
+// (и каждые TS_ROLLUP_CHECKPOINT_MIN минут - открытые) уходят тем же пакетом.
+#define TS_DIR                  "/ts"
+#define TS_SAMPLE_INTERVAL_MS   60000
+#define TS_NODE_GREENHOUSE      0       // Теплица: в API node=gh, в именах рядов "gh"
+#define TS_SERIES_COUNT         (NODE_COUNT * 3 + 3)
+#define TS_ROLLUP_CHECKPOINT_MIN 10     // Потеря открытого часа при сбое питания - не больше
+#define TS_BATCH_ROLLUPS        (TS_SERIES_COUNT * TS_ROLLUP_LEVELS)
+
+const char* TS_METRIC_NAMES[TS_METRIC_COUNT] = {"temp", "hum", "pressure", "temp_out"};
+const uint32_t TS_ROLLUP_SECONDS[TS_ROLLUP_LEVELS] = {3600, 86400};
+
+struct TsSeries {
+    uint16_t node;
+    TsMetric metric;
+    TsRollup minute;        // Текущая минута (под tsMux)
+    TsRollup rollups[TS_ROLLUP_LEVELS];     // Текущие час и сутки - только loop()
+    TsCursor cursor;        // Файл текущих суток - только задача SD
+} tsSeries[TS_SERIES_COUNT];
+
+struct TsBatchRollup {
+    uint8_t series;
+    uint8_t level;
+    TsRollup rollup;
+};
+
+// Пакет средних за минуту; пока задача SD его пишет, новый не собирается
+struct TsBatch {
+    uint32_t t;
+    uint8_t count;
+    uint8_t series[TS_SERIES_COUNT];
+    float values[TS_SERIES_COUNT];
+    uint8_t rollupCount;
+    TsBatchRollup rollups[TS_BATCH_ROLLUPS];
+    volatile bool busy;
+} tsBatch;
+
+portMUX_TYPE tsMux = portMUX_INITIALIZER_UNLOCKED;
+uint32_t lastTsSample = 0;
+uint32_t tsDropped = 0;
+uint32_t tsCheckpointSlot = 0;
+
+// Сжатие закрытых суток в .tsc: после смены суток (и после загрузки) задача SD
+// проходит последние TS_COMPACT_DAYS суток всех рядов, по одному файлу за шаг
+#define TS_COMPACT_DAYS         7
+#define TS_COMPACT_PERIOD_MS    1000
+
+struct TsCompactState {
+    uint32_t today;         // Сутки прохода (unixtime / 86400)
+    uint32_t done;          // Сутки, для которых проход завершён
+    uint8_t series;
+    uint8_t back;           // Сколько суток назад проверяем, 1..TS_COMPACT_DAYS
+    uint32_t lastRun;
+    volatile bool busy;
+    uint32_t files;         // Статистика: сжато файлов, байт до и после
+    uint32_t bytesIn;
+    uint32_t bytesOut;
+} tsCompact;
+
+// ========== ЖУРНАЛ СОБЫТИЙ ==========
+// События узлов копятся в кольце RAM и группой уходят задаче SD - раз в
+// JOURNAL_COMMIT_MS или по набору JOURNAL_COMMIT_MAX записей. Файл суток:
+// /journal/YYYYMMDD.bin, записи по 12 байт. Одинаковые события подряд сворачиваются.
+//
+// Каждый групповой коммит - кадр: заголовок с длиной и CRC32 данных. В каждом
+// интервале JOURNAL_SYNC_INTERVAL байт первым пишется маркер синхронизации
+// со своим смещением - от него восстановление при старте проходит кадры до
+// первого повреждённого и обрезает хвост.
+#define JOURNAL_DIR            "/journal"
+#define JOURNAL_RING_SIZE      128
+#define JOURNAL_COMMIT_MS      2000
+#define JOURNAL_COMMIT_MAX     64
+#define JOURNAL_COALESCE_S     10      // Окно свёртки одинаковых событий
+#define JOURNAL_FRAME_MAGIC    0x4D52464A  // "JFRM"
+#define JOURNAL_SYNC_MAGIC     0x4E59534A  // "JSYN"
+#define JOURNAL_SYNC_INTERVAL  4096
+#define JOURNAL_NO_SYNC        0xFFFFFFFF
+
+enum JournalEvent : uint8_t {
+    EV_BOOT = 1,
+    EV_SECURITY,        // value: бит 0 - тревога, бит 1 - контакт 1, бит 2 - контакт 2
+    EV_MAGNET,          // value: 1 - магнит на месте, 0 - потерян
+    EV_CONNECTION,      // value: 1 - связь восстановлена, 0 - потеряна
+    EV_COMMAND_ACK,     // value: id команды << 8 | код (1 - LED_ON, 2 - LED_OFF, 3 - GET_STATUS)
+    EV_RELAY,           // value: номер реле << 1 | состояние
+    EV_WEATHER_ALARM    // value: индекс правила << 1 | 1 - тревога, 0 - снята; -1 - прогноз осадков
+};
+
+#pragma pack(push, 1)
+struct JournalRecord {
+    uint32_t t;
+    uint16_t node;      // 0 - сам хаб или теплица
+    uint8_t type;
+    uint8_t repeat;     // Сколько раз событие повторилось сразу после этой записи
+    int32_t value;
+};
+
+struct JournalFrame {
+    uint32_t magic;
+    uint16_t length;    // Байт записей после заголовка
+    uint16_t count;
+    uint32_t crc;       // CRC32 записей
+};
+
+struct JournalSync {
+    uint32_t magic;
+    uint32_t offset;    // Собственное смещение в файле
+    uint32_t t;         // Время первой записи следующего кадра
+    uint32_t crc;       // CRC32 первых 12 байт
+};
+#pragma pack(pop)
+
+#define JOURNAL_FRAME_MAX  (sizeof(JournalFrame) + JOURNAL_COMMIT_MAX * sizeof(JournalRecord))
+
+struct JournalStats {
+    uint32_t events;        // Принято событий
+    uint32_t coalesced;     // Из них свёрнуто в предыдущую запись
+    uint32_t dropped;       // Потеряно: кольцо или очередь SD переполнены
+    uint32_t commits;
+    uint32_t records;       // Записано на карту
+    uint32_t writeUs;       // Суммарное время записи коммитов
+    uint16_t ringPeak;
+    uint16_t ratePeak;      // Максимум событий за секунду
+};
+
+JournalRecord journalRing[JOURNAL_RING_SIZE];
+uint16_t journalHead = 0;           // Следующая свободная позиция
+uint16_t journalCount = 0;          // Ещё не переданы задаче SD
+uint32_t journalOldestMs = 0;
+uint32_t journalRateSecond = 0;
+uint16_t journalRateCount = 0;
+JournalStats journalStats = {};
+portMUX_TYPE journalMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Групповой коммит, который сейчас пишет задача SD
+struct JournalCommit {
+    JournalRecord records[JOURNAL_COMMIT_MAX];
+    uint8_t count;
+    volatile bool busy;
+} journalCommit;
+
+File journalFile;                   // Только задача SD
+uint32_t journalFileDay = 0;
+uint32_t journalFileSize = 0;
+uint32_t journalSyncBlock = JOURNAL_NO_SYNC;    // Интервал, в котором уже есть маркер
+
+// Итог восстановления хвостов при старте
+uint32_t sdRecoveryUs = 0;
+uint32_t sdRecoveryScanned = 0;     // Прочитано байт
+uint32_t sdRecoveryCut = 0;         // Отрезано байт
+
+// ========== HTTP API ИСТОРИИ ==========
+// GET /api/history?metric=pressure|temp|hum|temp_out&node=102..105|gh&from=&to=&step=
+// from/to - unix-время RTC в секундах, step - шаг усреднения в секундах (0 - без).
+// Точки: [t,значение] без шага, [t,среднее,мин,макс] с шагом. Шаг от часа и от
+// суток читается из агрегатов, а не из минутных записей.
+// Ответ собирается по кусочкам из хранилища рядов, память на запрос постоянна.
+// Каждые сутки (файл агрегатов) без данных стоят задаче SD проверок SD.exists(),
+// а обработчик всё это время ждёт её: to обрезается текущим временем, диапазон
+// длиннее HISTORY_MAX_SPAN_DAYS - ошибка 400, после HISTORY_MAX_MISSING пустых
+// файлов подряд данные считаются закончившимися.
+#define HISTORY_DEFAULT_RANGE_S  86400
+#define HISTORY_MIN_STEP_S       60
+#define HISTORY_RAW              TS_ROLLUP_LEVELS
+#define HISTORY_MAX_MISSING      31
+
+// По источнику: час, сутки, сырые записи
+const uint16_t HISTORY_MAX_SPAN_DAYS[TS_ROLLUP_LEVELS + 1] = {1100, 7300, 400};
+
+const char* HISTORY_SOURCE_NAMES[TS_ROLLUP_LEVELS + 1] = {"hour", "day", "raw"};
+
+struct HistoryQuery {
+    uint8_t series;
+    uint8_t level;              // TS_ROLLUP_HOUR, TS_ROLLUP_DAY или HISTORY_RAW
+    uint32_t from;
+    uint32_t to;
+    uint32_t step;
+    uint8_t stage;              // 0 - заголовок, 1 - точки, 2 - хвост, 3 - готово
+    bool firstPoint;
+    TsRollup bucket;            // Текущая корзина усреднения
+    char pending[48];           // Точка, не поместившаяся в предыдущий кусок
+    uint8_t pendingLen;
+    
+    // Чтение - на задаче SD, блоками по 512 байт
+    File file;
+    uint32_t nextDay;           // Сутки следующего файла (unixtime / 86400)
+    uint16_t missing;           // Подряд не найденных файлов
+    uint16_t pos;               // Следующая запись (слот) файла
+    uint16_t count;             // Записей (конец слотов) в файле
+    union {
+        TsRecord recs[TS_RECORDS_PER_BLOCK];
+        TsRollup rollups[TS_ROLLUPS_PER_READ];
+    };
+    uint8_t recPos;
+    uint8_t recLen;
+    
+    // Сжатые сутки: задача SD читает блок, декодирует вызывающая задача
+    bool compressed;
+    uint8_t block;              // Следующий блок файла
+    uint8_t blocks;
+    uint8_t packed[TS_BLOCK_SIZE];
+    TsDecoder decoder;
+    
+    ~HistoryQuery();
+};
+
+// ========== СНИМОК СОСТОЯНИЯ ==========
+// Раз в минуту таблица узлов, теплица, тренды и сектор ветра пишутся в
+// /state.bin - попеременно в один из двух слотов по 512 байт, с номером и CRC32.
+// Сбой посреди записи портит только один слот, при старте берётся целый новейший.
+// Кольцо давления восстанавливается из хвоста хранилища рядов (см. warmRestore).
+#define STATE_PATH          "/state.bin"
+#define STATE_MAGIC         0x31545353  // "SST1"
+#define STATE_SLOT_SIZE     512
+#define STATE_INTERVAL_MS   60000
+#define STATE_MAX_AGE_S     86400       // Более старый снимок не восстанавливаем
+
+struct StateSnapshot {
+    uint32_t magic;
+    uint16_t size;          // sizeof(StateSnapshot): снимок другой версии не читается
+    uint16_t reserved;
+    uint32_t seq;
+    uint32_t t;             // unixtime RTC
+    NodeDisplayData nodes[NODE_COUNT_DISP];
+    GreenhouseDisplayData greenhouse;
+    float currentPressure;
+    float currentTemp;
+    float currentHumidity;
+    float pressureTrend3h;
+    float pressureTrend6h;
+    float pressureTrend12h;
+    float windDirection;
+    float windCurrentSector;
+    uint32_t crc;           // CRC32 всего, что выше
+};
+
+static_assert(sizeof(StateSnapshot) <= STATE_SLOT_SIZE, "StateSnapshot must fit one slot");
+
+struct StateWriteJob {
+    StateSnapshot snap;
+    volatile bool busy;
+} stateJob;
+
+// ========== ПРАВИЛА ТРЕВОГ ==========
+// Файл: заголовок и массив RuleConfig; пишется во временный и переименовывается
+#define RULES_PATH          "/rules.bin"
+#define RULES_TMP_PATH      "/rules.tmp"
+#define RULES_MAGIC         0x314C5552  // "RUL1"
+#define RULES_EVENTS_MAX    4
+
+struct RulesFileHeader {
+    uint32_t magic;
+    uint16_t size;          // sizeof(RuleConfig)
+    uint16_t count;
+    uint32_t crc;           // CRC32 массива правил
+};
+
+struct RulesJob {
+    RuleConfig configs[RULES_MAX];
+    uint8_t count;
+    volatile bool busy;
+} rulesJob;
+
+RuleEngine ruleEngine;
+portMUX_TYPE rulesMux = portMUX_INITIALIZER_UNLOCKED;
+volatile bool rulesDirty = false;
+
+const char *RULE_METRIC_NAMES[RM_COUNT] = {"temp", "hum", "press", "wind"};
+const char *RULE_KIND_NAMES[RULE_KIND_COUNT] = {"below", "above", "fall", "rise", "shift"};
+const float RULE_DEFAULT_HYSTERESIS[RM_COUNT] = {0.5, 2.0, 0.5, 10.0};
+
+uint32_t stateSeq = 0;
+uint32_t lastStateWrite = 0;
+
+// Итог тёплого старта
+struct WarmRestoreStats {
+    uint32_t us;
+    uint16_t points;        // Точек давления из хранилища рядов
+    int32_t snapshotAge;    // Возраст снимка в секундах, -1 - не восстановлен
+} warmRestoreStats = {0, 0, -1};
+
 // ========== ПЕРЕМЕННЫЕ ДЛЯ ЗУМЕРА ==========
 unsigned long lastBuzzerToggle = 0;
 bool buzzerState = false;
@@ -230,20 +698,35 @@ bool buzzerState = false;
 // ========== ПЕРЕМЕННЫЕ ДЛЯ СИСТЕМЫ ТРЕВОГ ==========
 struct SystemAlert {
     bool active;
-    char message[32];
+    char message[DISPLAY_ALERT_MAX];
     unsigned long startTime;
 } systemAlert = {false, "", 0};
 
 // ========== УПРАВЛЕНИЕ СТРАНИЦАМИ ==========
-enum DisplayPage {
-    PAGE_WEATHER,
-    PAGE_NODE_INFO,
-    PAGE_GREENHOUSE,
-    PAGE_SD_MONITOR,
-    PAGE_COUNT
-};
 DisplayPage currentPage = PAGE_WEATHER;
 
+// ========== ЗАДАЧА ДИСПЛЕЯ ==========
+// Рисует только эта задача. Обработчики данных меняют состояние и помечают
+// страницы грязными; задача не чаще раза в DISPLAY_FRAME_MS снимает копию
+// состояния под displayMux и рисует по ней. Пометки между кадрами сливаются
+// в одну перерисовку, SPI не попадает в путь приёма данных.
+#define DISPLAY_TASK_CORE       1
+#define DISPLAY_TASK_STACK      4096
+#define DISPLAY_TASK_PRIORITY   1
+#define DISPLAY_FRAME_MS        50      // Не больше 20 кадров в секунду
+
+#define DISPLAY_DIRTY_WEATHER       (1u << PAGE_WEATHER)
+#define DISPLAY_DIRTY_NODE          (1u << PAGE_NODE_INFO)
+#define DISPLAY_DIRTY_GREENHOUSE    (1u << PAGE_GREENHOUSE)
+#define DISPLAY_DIRTY_SD            (1u << PAGE_SD_MONITOR)
+#define DISPLAY_DIRTY_HEADER        (1u << PAGE_COUNT)
+#define DISPLAY_DIRTY_ALL           0xFFFFFFFFu
+
+TaskHandle_t displayTaskHandle = nullptr;
+portMUX_TYPE displayMux = portMUX_INITIALIZER_UNLOCKED;
+uint32_t displayDirty = 0;          // Под displayMux
+DisplayState displayState;          // Заполняется целиком под displayMux; принадлежит задаче дисплея
+
 // ========== СОСТОЯНИЯ КНОПОК ==========
 bool lastBtnCycle = HIGH;
 bool lastBtnEnter = HIGH;
@@ -256,46 +739,174 @@ const unsigned long LONG_PRESS_MS = 1000;
 
 // ========== ПРОТОТИПЫ ==========
 void onWebSocketEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len);
+bool wsClientAdd(uint32_t id, WsFormat format);
+void wsClientRemove(uint32_t id);
+void wsClientSetFormat(uint32_t id, WsFormat format);
+int wsCollectClients(WsClientSlot *out);
+bool wsAdmit(uint32_t id, WsPriority prio, size_t len, bool queueFull, bool heapLow);
+void wsSendFrame(uint32_t id, const WsWriter &w, WsPriority prio);
+void wsServiceClients();
+void wsSendSnapshot(uint32_t id, WsFormat format);
+void handleClientCommand(AsyncWebSocketClient *client, JsonDocument &doc);
+bool wsClientFormat(uint32_t id, WsFormat *format);
+void buildWeatherUpdate(WsWriter &w);
+void buildSensorData(WsWriter &w, int displayIndex);
+void buildNodeStats(WsWriter &w, int displayIndex);
+uint32_t nodeStatsTime();
+void nodeStatsAdd(int displayIndex, TsMetric metric, float value);
+void weatherSparkSync();
+RunningStats nodeStatsGet(int displayIndex, TsMetric metric);
+void buildGreenhouseData(WsWriter &w);
+void buildWindData(WsWriter &w);
 void onEspNowDataSent(const uint8_t *mac_addr, esp_now_send_status_t status);
 void onEspNowDataRecv(const uint8_t *mac_addr, const uint8_t *incomingData, int len);
-void sendToNode(uint8_t* mac, String cmd);
+esp_err_t sendToNode(uint8_t* mac, const char* cmd, uint16_t cmdId);
+void completeCommand(int nodeIndex, uint16_t cmdId, const char* cmd, const char* error);
+void checkCommandTimeouts();
+void replyCommandResult(const PendingCommand &pc, const char* error, uint32_t rttMs);
+void commandLatencyPercentiles(int nodeIndex, uint16_t *p50, uint16_t *p99);
+void buildCommandStats(WsWriter &w);
 void processGreenhouseData(const uint8_t *data);
 void processNodeData(const uint8_t *data, int len, int nodeIndex);
 void checkNodeConnection();
 void updateAlarmState();
 void sendConnectionStatusToWeb(int nodeIndex, bool connected);
 void processEncoderData(float angle, bool magnet);
-void updateHistory(float angle);
-void updateMaxMin();
+void windUpdate(unsigned long now);
 void broadcastEncoderData();
 void sendEncoderAlarmStatus(int nodeIndex, bool alarm, const char* message);
-void updateWeatherHistory(float pressure, float temp, float humidity);
+void updateWeatherHistory(float pressure, float temp);
 void calculatePressureTrends();
-String generateForecast(float pressure, float trend, float humidity, int month);
-String checkFrostRisk(float temp, int hour, int month);
-String getWeatherIcon(String forecast);
-String getWeatherText(String icon);
+void updateForecast(float pressure, float temp);
+WsWeather wsWeather();
 void broadcastWeatherData();
 void initDisplay();
 void initRTC();
 void initSD();
 void updateSDInfo();
-void displayWeatherPage();
-void displayNodePage();
-void displayGreenhousePage();
-void displaySDPage();
-void drawTopBar(const char* pageName);
-void drawSeparatorLine();
+void sdLogPath(char *out, size_t size, uint32_t day);
+bool sdLogOpen(uint32_t day);
+bool sdLogWrite(uint32_t day, const char *data, uint16_t len, bool sync);
+bool sdLogAppend(const char *data, uint16_t len);
+bool sdLogWriteRaw(const char *data, uint16_t len);
+bool sdLogFlushCarry();
+bool sdLogSubmit(bool sync);
+void sdLogRecord();
+void sdLogService(uint32_t now);
+void sdStartWorker();
+void sdWorkerTask(void *param);
+void sdRecordLatency(SdLatencyStats &stats, uint32_t us);
+void sdRun(SdCallFn fn, void *ctx);
+bool sdPost(SdCallFn fn, void *ctx);
+File sdOpen(const char *path, const char *mode);
+bool sdExists(const char *path);
+size_t sdRead(File &file, uint8_t *buf, size_t len);
+void sdClose(File &file);
+void serveSdStats(AsyncWebServerRequest *request);
+void displayUpdateClock();
+void displayInvalidate(uint32_t flags);
+void displayStartTask();
+void displayTask(void *param);
+void displaySnapshot(DisplayState &s);
+void displayFrame(uint32_t flags);
 void checkSystemAlerts();
 void showAlert(const char* message);
 void clearAlert();
 void handleButtons();
 void buzzerBeep(int durationMs);
 void updateAlarmSound();
-void draw_compass(int cx, int cy, int r, float angle, bool magnet);
 String formatTime(int value);
-void testSDWrite();
-void checkHTMLFile();
+void loadWebAssets();
+void serveIndexPage(AsyncWebServerRequest *request);
+void serveAsset(AsyncWebServerRequest *request);
+AsyncWebServerResponse *beginSdFileResponse(AsyncWebServerRequest *request, const char *path, const char *contentType);
+const char *webContentType(const char *path);
+void serveHistory(AsyncWebServerRequest *request);
+size_t historyFill(HistoryQuery &q, uint8_t *buffer, size_t maxLen);
+bool historyNextRecord(HistoryQuery &q, TsRollup &item);
+void historyLoadBlock(void *ctx);
+void tsInitSeries();
+int tsFindSeries(uint16_t node, uint8_t metric);
+void tsAddSample(uint16_t node, TsMetric metric, float value);
+void tsService(uint32_t now);
+void tsSeriesPath(char *out, size_t size, const TsSeries &series, uint32_t dayStart, const char *ext = "bin");
+bool tsOpenDay(TsSeries &series, uint32_t dayStart, File &file);
+void tsWriteBatch(void *ctx);
+bool tsEnsureDir(const char *path);
+uint32_t tsRollupPeriod(uint8_t level, uint32_t t, uint16_t *slots, uint32_t *next);
+void tsRollupPath(char *out, size_t size, const TsSeries &series, uint8_t level, uint32_t periodStart);
+bool tsRollupStore(const TsSeries &series, uint8_t level, const TsRollup &rollup);
+void tsRestoreRollups();
+void historyLoadRollups(HistoryQuery &q);
+void tsCompactService(uint32_t now);
+void tsCompactStep(void *ctx);
+bool tsCompactDay(const TsSeries &series, uint32_t dayStart);
+void journalAdd(uint16_t node, JournalEvent type, int32_t value);
+void journalService(uint32_t now);
+void journalWrite(void *ctx);
+bool sdNewestFile(const char *dir, char *out, size_t size);
+bool sdTruncate(const char *path, uint32_t length);
+void sdRecoverTails();
+uint32_t journalValidEnd(File &file, uint32_t size);
+bool journalFindSync(File &file, uint32_t from, uint32_t size, uint32_t *pos);
+uint32_t sdLogValidEnd(File &file, uint32_t size);
+bool sdLogLineValid(const char *line, uint16_t len, bool crc);
+bool sdReadAt(File &file, uint32_t pos, void *buf, uint32_t len);
+void stateService(uint32_t now);
+void stateWrite(void *ctx);
+void stateLoad(void *ctx);
+void warmRestore();
+uint16_t warmRestorePressure(uint32_t nowUnix);
+void rulesLoad();
+void rulesDefaults();
+void rulesRead(void *ctx);
+void rulesWrite(void *ctx);
+void rulesService();
+void rulesCheck(uint16_t node, uint8_t metric, float value);
+int ruleMetricByName(const char *name);
+int ruleKindByName(const char *name);
+bool ruleNodeKnown(int node);
+const char *ruleAlarmType(const RuleConfig &cfg);
+void buildLimitsUpdate(WsWriter &w, uint16_t node, uint8_t metric);
+void buildWeatherForecast(WsWriter &w);
+void handleSetLimits(JsonDocument &doc);
+void handleSetRule(AsyncWebSocketClient *client, JsonDocument &doc);
+
+// Общий сериализатор: построитель вызывается один раз на каждый формат,
+// который реально используется подключенными клиентами.
+template <typename Builder>
+void wsBroadcast(WsPriority prio, Builder build) {
+    WsClientSlot clients[WS_MAX_CLIENTS];
+    int count = wsCollectClients(clients);
+    if (count == 0) return;
+
+    uint8_t buf[WS_MSG_MAX_LEN];
+    for (uint8_t f = WS_FORMAT_JSON; f <= WS_FORMAT_MSGPACK; f++) {
+        bool needed = false;
+        for (int i = 0; i < count; i++) {
+            if (clients[i].format == f) { needed = true; break; }
+        }
+        if (!needed) continue;
+
+        WsWriter w(buf, sizeof(buf), (WsFormat)f);
+        build(w);
+        if (!w.ok()) {
+            Serial.println("WS: сообщение не помещается в буфер");
+            return;
+        }
+        for (int i = 0; i < count; i++) {
+            if (clients[i].format == f) wsSendFrame(clients[i].id, w, prio);
+        }
+    }
+}
+
+template <typename Builder>
+void wsSendTo(uint32_t clientId, WsFormat format, Builder build) {
+    uint8_t buf[WS_MSG_MAX_LEN];
+    WsWriter w(buf, sizeof(buf), format);
+    build(w);
+    if (w.ok()) wsSendFrame(clientId, w, WS_PRIO_EVENT);
+}
 
 // ===================== SETUP =====================
 void setup() {
@@ -318,20 +929,33 @@ void setup() {
     initDisplay();
     initRTC();
     initSD();
-    checkHTMLFile();
+    loadWebAssets();
+    tsInitSeries();
+    if (sdInitialized) {
+        sdRecoverTails();
+        tsRestoreRollups();
+        sdStartWorker();
+    }
+    journalAdd(0, EV_BOOT, 0);
     
     buzzerBeep(100);
     delay(100);
     buzzerBeep(100);
 
     // Инициализация WiFi и ESP-NOW
-    historyCount = 0;
-    historyIndex = 0;
+    windEngine.begin();
     lastEncoderBroadcastTime = 0;
     maxSectorWidth = 0.0;
-    weatherCount = 0;
-    weatherIndex = 0;
+    pressureHistory.begin();
+    sparkFromCoarse(pressureHistory, weatherSparkPress);   // Пустой ряд
+    weatherSparkTemp.begin();
+    for (uint8_t i = 0; i < NODE_COUNT_DISP; i++) {
+        nodeSparkTemp[i].begin();
+        nodeSparkPress[i].begin();
+    }
     lastForecastUpdate = 0;
+    warmRestore();
+    rulesLoad();
 
     WiFi.mode(WIFI_AP);
     WiFi.softAP(AP_SSID, AP_PASSWORD);
@@ -339,15 +963,11 @@ void setup() {
     Serial.println(WiFi.softAPIP());
 
     // ========== ВЕБ-СЕРВЕР ==========
-    server.on("/", HTTP_GET, [](AsyncWebServerRequest *request) {
-        if (sdInitialized && SD.exists("/index.html")) {
-            request->send(SD, "/index.html", "text/html");
-            Serial.println("📄 HTML загружен с SD карты");
-        } else {
-            request->send(200, "text/html", "<h1>SD Card Error</h1><p>HTML file not found</p>");
-            Serial.println("❌ HTML файл не найден на SD");
-        }
-    });
+    server.on("/", HTTP_GET, serveIndexPage);
+    // Версионированные файлы (имя меняется при изменении) - кэшируются браузером навсегда
+    server.on("/assets/*", HTTP_GET, serveAsset);
+    server.on("/api/history", HTTP_GET, serveHistory);
+    server.on("/api/sdstats", HTTP_GET, serveSdStats);
 
     ws.onEvent(onWebSocketEvent);
     server.addHandler(&ws);
@@ -373,8 +993,7 @@ void setup() {
     esp_now_add_peer(&greenhousePeerInfo);
 
     Serial.println("\n=== ХАБ ГОТОВ К РАБОТЕ ===");
-    drawSeparatorLine();
-    displayWeatherPage();
+    displayStartTask();
 }
 
 // ===================== LOOP =====================
@@ -383,12 +1002,17 @@ void loop() {
     
     // Основные функции хаба
     ws.cleanupClients();
+    if (now - lastWsServiceTime >= WS_SERVICE_INTERVAL_MS) {
+        lastWsServiceTime = now;
+        wsServiceClients();
+    }
     checkNodeConnection();
+    checkCommandTimeouts();
     updateAlarmState();
     checkSystemAlerts();
     
     if (now - lastEncoderBroadcastTime >= ENCODER_BROADCAST_INTERVAL) {
-        updateMaxMin();
+        windUpdate(now);
         broadcastEncoderData();
         lastEncoderBroadcastTime = now;
     }
@@ -400,28 +1024,28 @@ void loop() {
     // Обновление часов только при смене минуты
     if (rtcOK && (now - lastRTCReadTime >= RTC_READ_INTERVAL)) {
         lastRTCRead = rtc.now();
+        lastRTCUnix = lastRTCRead.unixtime();
         lastRTCReadTime = now;
         
         int currentMinute = lastRTCRead.minute();
         if (currentMinute != lastDisplayedMinute) {
             lastDisplayedMinute = currentMinute;
             
-            // Обновляем верхний бар текущей страницы
-            if (currentPage == PAGE_WEATHER) drawTopBar("METEOSTANCIYA");
-            else if (currentPage == PAGE_NODE_INFO) {
-                char title[20];
-                sprintf(title, "UZEL #%d", nodeDisplayData[displayNodeIndex].id);
-                drawTopBar(title);
-            }
-            else if (currentPage == PAGE_GREENHOUSE) drawTopBar("TEPLITSA");
-            else if (currentPage == PAGE_SD_MONITOR) drawTopBar("SD KARTA");
+            // Часы верхнего бара; заголовок и страница не трогаются
+            displayUpdateClock();
         }
     }
     
     if (sdInitialized && (now - lastSDWrite >= SD_WRITE_INTERVAL)) {
         lastSDWrite = now;
-        testSDWrite();
+        sdLogRecord();
     }
+    sdLogService(now);
+    tsService(now);
+    tsCompactService(now);
+    journalService(now);
+    stateService(now);
+    rulesService();
     
     delay(10);
 }
@@ -430,50 +1054,483 @@ void loop() {
 
 void onWebSocketEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len) {
     if (type == WS_EVT_CONNECT) {
-        Serial.printf("Новый клиент: %u\n", client->id());
-        broadcastWeatherData();
+        // arg - HTTP-запрос апгрейда, в нём можно передать ?proto=msgpack
+        AsyncWebServerRequest *request = (AsyncWebServerRequest *)arg;
+        WsFormat format = WS_FORMAT_JSON;
+        if (request && request->hasParam("proto") &&
+            request->getParam("proto")->value() == "msgpack") {
+            format = WS_FORMAT_MSGPACK;
+        }
+        if (!wsClientAdd(client->id(), format)) {
+            Serial.printf("Клиент %u отклонён: нет свободных слотов\n", client->id());
+            client->close();
+            return;
+        }
+        Serial.printf("Новый клиент: %u (%s)\n", client->id(),
+                      format == WS_FORMAT_MSGPACK ? "msgpack" : "json");
+        wsSendSnapshot(client->id(), format);
     }
     else if (type == WS_EVT_DISCONNECT) {
+        wsClientRemove(client->id());
         Serial.printf("Клиент отключен: %u\n", client->id());
     }
     else if (type == WS_EVT_DATA) {
-        StaticJsonDocument<200> doc;
-        if (!deserializeJson(doc, data, len) && doc.containsKey("command")) {
-            String cmd = doc["command"].as<String>();
-            int targetNode = doc["node"] | 102;
-            
-            uint8_t* targetMac = nullptr;
-            switch(targetNode) {
-                case 102: targetMac = node102MacAddress; break;
-                case 103: targetMac = node103MacAddress; break;
-                case 104: targetMac = node104MacAddress; break;
-                case 105: targetMac = node105MacAddress; break;
-                default: targetMac = node102MacAddress;
+        // Обрабатываем только целые (нефрагментированные) кадры
+        AwsFrameInfo *info = (AwsFrameInfo *)arg;
+        if (!info->final || info->index != 0 || info->len != len) return;
+
+        StaticJsonDocument<256> doc;
+        DeserializationError error;
+        if (info->opcode == WS_BINARY) {
+            error = deserializeMsgPack(doc, data, len);
+        } else {
+            error = deserializeJson(doc, data, len);
+        }
+        if (error) return;
+
+        // Согласование формата первым сообщением: {"proto":"msgpack"} / {"proto":"json"}
+        if (doc.containsKey("proto")) {
+            const char* proto = doc["proto"] | "json";
+            WsFormat format = strcmp(proto, "msgpack") == 0 ? WS_FORMAT_MSGPACK : WS_FORMAT_JSON;
+            wsClientSetFormat(client->id(), format);
+            wsSendTo(client->id(), format, [&](WsWriter &w) {
+                w.beginObject();
+                w.field("type", "proto");
+                w.field("format", format == WS_FORMAT_MSGPACK ? "msgpack" : "json");
+                w.endObject();
+            });
+            wsSendSnapshot(client->id(), format);
+            return;
+        }
+
+        const char* msgType = doc["type"] | "";
+        if (strcmp(msgType, "set_limits") == 0) {
+            handleSetLimits(doc);
+        } else if (strcmp(msgType, "set_rule") == 0) {
+            handleSetRule(client, doc);
+        } else if (doc.containsKey("command")) {
+            handleClientCommand(client, doc);
+        }
+    }
+}
+
+void handleClientCommand(AsyncWebSocketClient *client, JsonDocument &doc) {
+    const char* cmd = doc["command"] | "";
+    int targetNode = doc["node"] | 102;   // Без "node" - как раньше, узел 102
+    
+    PendingCommand pc = {};
+    pc.clientId = client->id();
+    pc.clientReq = doc["req"] | -1;
+    pc.nodeId = targetNode;
+    pc.nodeIndex = -1;
+    strncpy(pc.command, cmd, CMD_MAX_LEN - 1);
+    
+    // Статистика команд считается на хабе, на узел не уходит
+    if (strcmp(cmd, "GET_COMMAND_STATS") == 0) {
+        WsFormat format;
+        if (wsClientFormat(client->id(), &format)) wsSendTo(client->id(), format, buildCommandStats);
+        return;
+    }
+    
+    if (cmd[0] == '\0' || strlen(cmd) >= CMD_MAX_LEN) {
+        replyCommandResult(pc, "bad_command", 0);
+        return;
+    }
+    
+    for (int i = 0; i < NODE_COUNT; i++) {
+        if (nodeNumbers[i] == targetNode) pc.nodeIndex = i;
+    }
+    if (pc.nodeIndex < 0) {
+        Serial.printf("Команда %s: неизвестный узел %d\n", cmd, targetNode);
+        replyCommandResult(pc, "unknown_node", 0);
+        return;
+    }
+    
+    // Регистрируем команду до отправки, чтобы быстрый ответ узла не опередил запись
+    bool registered = false;
+    portENTER_CRITICAL(&commandsMux);
+    for (int i = 0; i < CMD_MAX_PENDING; i++) {
+        if (!pendingCommands[i].used) {
+            pc.used = true;
+            pc.id = nextCommandId++;
+            if (nextCommandId == 0) nextCommandId = 1;
+            pc.sentAt = millis();
+            pendingCommands[i] = pc;
+            registered = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&commandsMux);
+    
+    if (!registered) {
+        replyCommandResult(pc, "busy", 0);
+        return;
+    }
+    
+    if (sendToNode(nodeMacs[pc.nodeIndex], cmd, pc.id) != ESP_OK) {
+        completeCommand(pc.nodeIndex, pc.id, nullptr, "send_error");
+    }
+}
+
+bool wsClientFormat(uint32_t id, WsFormat *format) {
+    bool found = false;
+    portENTER_CRITICAL(&wsClientsMux);
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        if (wsClients[i].used && wsClients[i].id == id) {
+            *format = wsClients[i].format;
+            found = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&wsClientsMux);
+    return found;
+}
+
+// ==================== КЛИЕНТЫ WEBSOCKET ====================
+
+bool wsClientAdd(uint32_t id, WsFormat format) {
+    bool added = false;
+    unsigned long now = millis();
+    portENTER_CRITICAL(&wsClientsMux);
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        if (!wsClients[i].used) {
+            WsClientSlot &slot = wsClients[i];
+            slot.used = true;
+            slot.id = id;
+            slot.format = format;
+            slot.msgCredit = WS_BUDGET_MSGS * 1000;
+            slot.byteCredit = WS_BUDGET_BYTES;
+            slot.lastRefill = now;
+            slot.stalledSince = 0;
+            slot.needsResync = false;
+            slot.dropped = 0;
+            added = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&wsClientsMux);
+    return added;
+}
+
+void wsClientRemove(uint32_t id) {
+    portENTER_CRITICAL(&wsClientsMux);
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        if (wsClients[i].used && wsClients[i].id == id) {
+            wsClients[i].used = false;
+        }
+    }
+    portEXIT_CRITICAL(&wsClientsMux);
+}
+
+void wsClientSetFormat(uint32_t id, WsFormat format) {
+    portENTER_CRITICAL(&wsClientsMux);
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        if (wsClients[i].used && wsClients[i].id == id) {
+            wsClients[i].format = format;
+        }
+    }
+    portEXIT_CRITICAL(&wsClientsMux);
+}
+
+// Копия таблицы клиентов, чтобы не держать блокировку во время отправки
+int wsCollectClients(WsClientSlot *out) {
+    int count = 0;
+    portENTER_CRITICAL(&wsClientsMux);
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        if (wsClients[i].used) out[count++] = wsClients[i];
+    }
+    portEXIT_CRITICAL(&wsClientsMux);
+    return count;
+}
+
+// Решение об отправке: события проходят всегда (если очередь AsyncTCP не полна),
+// периодическое состояние - только в пределах бюджета клиента.
+bool wsAdmit(uint32_t id, WsPriority prio, size_t len, bool queueFull, bool heapLow) {
+    bool admit = false;
+    unsigned long now = millis();
+    portENTER_CRITICAL(&wsClientsMux);
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        WsClientSlot &slot = wsClients[i];
+        if (!slot.used || slot.id != id) continue;
+        
+        if (queueFull) {
+            if (slot.stalledSince == 0) slot.stalledSince = now;
+            slot.needsResync = true;
+            slot.dropped++;
+        } else {
+            slot.stalledSince = 0;
+            bool overBudget = heapLow || slot.msgCredit < 1000 || slot.byteCredit < (int32_t)len;
+            if (prio == WS_PRIO_STATE && overBudget) {
+                slot.needsResync = true;
+                slot.dropped++;
+            } else {
+                slot.msgCredit = max(slot.msgCredit - 1000, (int32_t)0);
+                slot.byteCredit = max(slot.byteCredit - (int32_t)len, (int32_t)0);
+                admit = true;
             }
+        }
+        break;
+    }
+    portEXIT_CRITICAL(&wsClientsMux);
+    return admit;
+}
+
+void wsSendFrame(uint32_t id, const WsWriter &w, WsPriority prio) {
+    AsyncWebSocketClient *client = ws.client(id);
+    if (!client || client->status() != WS_CONNECTED) return;
+    bool heapLow = ESP.getFreeHeap() < WS_MIN_FREE_HEAP;
+    if (!wsAdmit(id, prio, w.length(), client->queueIsFull(), heapLow)) return;
+    if (w.format() == WS_FORMAT_MSGPACK) {
+        client->binary((const char *)w.data(), w.length());
+    } else {
+        client->text((const char *)w.data(), w.length());
+    }
+}
+
+// Пополнение бюджетов, снимок для догнавших клиентов, отключение зависших
+void wsServiceClients() {
+    unsigned long now = millis();
+    WsClientSlot clients[WS_MAX_CLIENTS];
+    int count = wsCollectClients(clients);
+    
+    for (int i = 0; i < count; i++) {
+        uint32_t id = clients[i].id;
+        AsyncWebSocketClient *client = ws.client(id);
+        if (!client || client->status() != WS_CONNECTED) continue;
+        bool queueFull = client->queueIsFull();
+        
+        bool resync = false;
+        bool stuck = false;
+        uint32_t dropped = 0;
+        portENTER_CRITICAL(&wsClientsMux);
+        for (int j = 0; j < WS_MAX_CLIENTS; j++) {
+            WsClientSlot &slot = wsClients[j];
+            if (!slot.used || slot.id != id) continue;
             
-            if (targetMac) {
-                sendToNode(targetMac, cmd);
+            unsigned long elapsed = now - slot.lastRefill;
+            slot.lastRefill = now;
+            slot.msgCredit = min(slot.msgCredit + (int32_t)(elapsed * WS_BUDGET_MSGS_PER_SEC),
+                                 (int32_t)(WS_BUDGET_MSGS * 1000));
+            slot.byteCredit = min(slot.byteCredit + (int32_t)(elapsed * WS_BUDGET_BYTES_PER_SEC / 1000),
+                                  (int32_t)WS_BUDGET_BYTES);
+            
+            if (queueFull) {
+                if (slot.stalledSince == 0) slot.stalledSince = now;
+                stuck = (now - slot.stalledSince) > WS_STALL_TIMEOUT_MS;
+            } else {
+                slot.stalledSince = 0;
+                if (slot.needsResync && slot.msgCredit >= WS_SNAPSHOT_MIN_MSGS * 1000) {
+                    slot.needsResync = false;
+                    resync = true;
+                    dropped = slot.dropped;
+                }
             }
+            break;
+        }
+        portEXIT_CRITICAL(&wsClientsMux);
+        
+        if (stuck) {
+            Serial.printf("WS: клиент %u завис, отключаем\n", id);
+            client->close();
+        } else if (resync) {
+            Serial.printf("WS: клиент %u догнал (пропущено %u), снимок\n", id, dropped);
+            wsSendSnapshot(id, clients[i].format);
+        }
+    }
+}
+
+// Полное текущее состояние для нового или догнавшего клиента
+void wsSendSnapshot(uint32_t id, WsFormat format) {
+    for (int i = 0; i < NODE_COUNT; i++) {
+        if (lastNodeDataTime[i] == 0) continue;
+        int displayIndex = nodeNumbers[i] - 102;
+        if (displayIndex < 0 || displayIndex >= 4) continue;
+        
+        wsSendTo(id, format, [&](WsWriter &w) { buildSensorData(w, displayIndex); });
+        wsSendTo(id, format, [&](WsWriter &w) { buildNodeStats(w, displayIndex); });
+        wsSendTo(id, format, [&](WsWriter &w) {
+            NodeDisplayData &node = nodeDisplayData[displayIndex];
+            w.beginObject();
+            w.field("type", "security");
+            w.field("node", node.id);
+            w.fieldBool("alarm", node.alarm);
+            w.fieldBool("contact1", node.contact1);
+            w.fieldBool("contact2", node.contact2);
+            w.endObject();
+        });
+        if (nodeConnectionLost[i]) {
+            wsSendTo(id, format, [&](WsWriter &w) {
+                w.beginObject();
+                w.field("type", "connection_lost");
+                w.field("node", nodeNumbers[i]);
+                w.endObject();
+            });
+        }
+    }
+    if (lastGreenhouseUpdate > 0) wsSendTo(id, format, buildGreenhouseData);
+    if (currentPressure != 0) wsSendTo(id, format, buildWeatherUpdate);
+    if (windEngine.samples() > 0) wsSendTo(id, format, buildWindData);
+    if (weatherForecast != FC_NONE) wsSendTo(id, format, buildWeatherForecast);
+    for (int i = 0; i < NODE_COUNT; i++) {
+        for (uint8_t m = 0; m < RM_WIND; m++) {
+            portENTER_CRITICAL(&rulesMux);
+            bool has = ruleEngine.find(nodeNumbers[i], m, RULE_BELOW) >= 0 ||
+                       ruleEngine.find(nodeNumbers[i], m, RULE_ABOVE) >= 0;
+            portEXIT_CRITICAL(&rulesMux);
+            if (has) wsSendTo(id, format, [&](WsWriter &w) { buildLimitsUpdate(w, nodeNumbers[i], m); });
         }
     }
 }
 
-void sendToNode(uint8_t* mac, String cmd) {
-    char json_cmd[64];
-    snprintf(json_cmd, sizeof(json_cmd), "{\"type\":\"command\",\"command\":\"%s\"}", cmd.c_str());
+esp_err_t sendToNode(uint8_t* mac, const char* cmd, uint16_t cmdId) {
+    char json_cmd[80];
+    snprintf(json_cmd, sizeof(json_cmd), "{\"type\":\"command\",\"command\":\"%s\",\"id\":%u}", cmd, cmdId);
     strncpy(outgoingMessage.json, json_cmd, sizeof(outgoingMessage.json)-1);
     outgoingMessage.sender_id = 1;
-    esp_now_send(mac, (uint8_t*)&outgoingMessage, sizeof(outgoingMessage));
+    return esp_now_send(mac, (uint8_t*)&outgoingMessage, sizeof(outgoingMessage));
+}
+
+void onEspNowDataSent(const uint8_t *mac_addr, esp_now_send_status_t status) {
+    int nodeIndex = -1;
+    for (int i = 0; i < NODE_COUNT; i++) {
+        if (memcmp(mac_addr, nodeMacs[i], 6) == 0) nodeIndex = i;
+    }
+    if (nodeIndex < 0) return;
+    
+    // Отчёт о доставке относится к самой старой ещё не доставленной команде узла
+    uint16_t failedId = 0;
+    portENTER_CRITICAL(&commandsMux);
+    PendingCommand *oldest = nullptr;
+    for (int i = 0; i < CMD_MAX_PENDING; i++) {
+        PendingCommand &pc = pendingCommands[i];
+        if (!pc.used || pc.delivered || pc.nodeIndex != nodeIndex) continue;
+        if (!oldest || (long)(pc.sentAt - oldest->sentAt) < 0) oldest = &pc;
+    }
+    if (oldest) {
+        if (status == ESP_NOW_SEND_SUCCESS) oldest->delivered = true;
+        else failedId = oldest->id;
+    }
+    portEXIT_CRITICAL(&commandsMux);
+    
+    if (failedId) completeCommand(nodeIndex, failedId, nullptr, "no_ack");
+}
+
+// ==================== ОТСЛЕЖИВАНИЕ КОМАНД ====================
+
+// Завершение команды: по ID, а если узел его не прислал (старая прошивка) -
+// самая старая команда узла с тем же именем. error == nullptr - успех.
+void completeCommand(int nodeIndex, uint16_t cmdId, const char* cmd, const char* error) {
+    PendingCommand done;
+    bool found = false;
+    unsigned long now = millis();
+    
+    portENTER_CRITICAL(&commandsMux);
+    PendingCommand *match = nullptr;
+    for (int i = 0; i < CMD_MAX_PENDING; i++) {
+        PendingCommand &pc = pendingCommands[i];
+        if (!pc.used || pc.nodeIndex != nodeIndex) continue;
+        if (cmdId != 0) {
+            if (pc.id == cmdId) { match = &pc; break; }
+        } else if (cmd && strcmp(pc.command, cmd) == 0) {
+            if (!match || (long)(pc.sentAt - match->sentAt) < 0) match = &pc;
+        }
+    }
+    if (match) {
+        done = *match;
+        match->used = false;
+        found = true;
+        
+        CommandStats &st = commandStats[nodeIndex];
+        if (error) {
+            st.failed++;
+        } else {
+            st.ok++;
+            st.latencyMs[st.latencyIndex] = (uint16_t)min(now - done.sentAt, 65535UL);
+            st.latencyIndex = (st.latencyIndex + 1) % CMD_LATENCY_SAMPLES;
+            if (st.latencyCount < CMD_LATENCY_SAMPLES) st.latencyCount++;
+        }
+    }
+    portEXIT_CRITICAL(&commandsMux);
+    
+    if (!found) return;
+    uint32_t rtt = now - done.sentAt;
+    Serial.printf("Команда #%u %s -> узел #%d: %s, %lu мс\n", done.id, done.command,
+                  nodeNumbers[nodeIndex], error ? error : "OK", (unsigned long)rtt);
+    replyCommandResult(done, error, rtt);
+}
+
+void checkCommandTimeouts() {
+    unsigned long now = millis();
+    for (int i = 0; i < CMD_MAX_PENDING; i++) {
+        int nodeIndex = -1;
+        uint16_t id = 0;
+        portENTER_CRITICAL(&commandsMux);
+        PendingCommand &pc = pendingCommands[i];
+        if (pc.used && now - pc.sentAt > CMD_TIMEOUT_MS) {
+            nodeIndex = pc.nodeIndex;
+            id = pc.id;
+        }
+        portEXIT_CRITICAL(&commandsMux);
+        if (id) completeCommand(nodeIndex, id, nullptr, "timeout");
+    }
+}
+
+void replyCommandResult(const PendingCommand &pc, const char* error, uint32_t rttMs) {
+    WsFormat format;
+    if (!wsClientFormat(pc.clientId, &format)) return;
+    
+    wsSendTo(pc.clientId, format, [&](WsWriter &w) {
+        w.beginObject();
+        w.field("type", "command_result");
+        if (pc.id) w.field("id", pc.id);
+        if (pc.clientReq >= 0) w.field("req", pc.clientReq);
+        w.field("node", pc.nodeId);
+        w.field("command", pc.command);
+        w.fieldBool("ok", error == nullptr);
+        if (error) w.field("error", error);
+        else w.field("rtt_ms", (int32_t)rttMs);
+        w.endObject();
+    });
+}
+
+// Перцентили по последним CMD_LATENCY_SAMPLES командам (ранговый метод)
+void commandLatencyPercentiles(int nodeIndex, uint16_t *p50, uint16_t *p99) {
+    uint16_t sorted[CMD_LATENCY_SAMPLES];
+    uint8_t n;
+    portENTER_CRITICAL(&commandsMux);
+    n = commandStats[nodeIndex].latencyCount;
+    memcpy(sorted, commandStats[nodeIndex].latencyMs, sizeof(sorted));
+    portEXIT_CRITICAL(&commandsMux);
+    
+    *p50 = 0;
+    *p99 = 0;
+    if (n == 0) return;
+    for (int i = 1; i < n; i++) {
+        uint16_t v = sorted[i];
+        int j = i - 1;
+        while (j >= 0 && sorted[j] > v) { sorted[j + 1] = sorted[j]; j--; }
+        sorted[j + 1] = v;
+    }
+    *p50 = sorted[(n * 50 + 99) / 100 - 1];
+    *p99 = sorted[(n * 99 + 99) / 100 - 1];
 }
 
-void onEspNowDataSent(const uint8_t *mac_addr, esp_now_send_status_t status) {}
+void buildCommandStats(WsWriter &w) {
+    WsCommandStats nodes[NODE_COUNT];
+    for (int i = 0; i < NODE_COUNT; i++) {
+        nodes[i] = WsCommandStats{nodeNumbers[i], commandStats[i].ok, commandStats[i].failed, 0, 0};
+        commandLatencyPercentiles(i, &nodes[i].p50, &nodes[i].p99);
+    }
+    wsCommandStats(w, nodes, NODE_COUNT);
+}
 
 void onEspNowDataRecv(const uint8_t *mac_addr, const uint8_t *incomingData, int len) {
+    uint32_t start = micros();
     for (int i = 0; i < NODE_COUNT; i++) {
         if (memcmp(mac_addr, nodeMacs[i], 6) == 0) {
             lastNodeDataTime[i] = millis();
             processNodeData(incomingData, len, i);
-            return;
+            break;
         }
     }
     if (memcmp(mac_addr, greenhouseMac, 6) == 0) {
@@ -481,6 +1538,8 @@ void onEspNowDataRecv(const uint8_t *mac_addr, const uint8_t *incomingData, int
             processGreenhouseData(incomingData);
         }
     }
+    uint32_t us = micros() - start;
+    if (us > displayTaskStats.ingestMaxUs) displayTaskStats.ingestMaxUs = us;
 }
 
 void processNodeData(const uint8_t *data, int len, int nodeIndex) {
@@ -504,53 +1563,41 @@ void processNodeData(const uint8_t *data, int len, int nodeIndex) {
         JsonObject dataObj = doc["data"];
         float temp = dataObj["AHT20"]["temp"].as<float>();
         float hum = dataObj["AHT20"]["hum"].as<float>();
+        float bmpTemp = dataObj["BMP280"]["temp"].as<float>();
         float press = dataObj["BMP280"]["press_mmHg"].as<float>();
         
+        tsAddSample(nodeId, TS_TEMP, temp);
+        tsAddSample(nodeId, TS_HUM, hum);
+        tsAddSample(nodeId, TS_PRESS, press);
+        
         if (nodeId == 102) {
+            portENTER_CRITICAL(&displayMux);
             currentPressure = press;
-            updateWeatherHistory(press, currentTemp, currentHumidity);
+            portEXIT_CRITICAL(&displayMux);
+            updateWeatherHistory(press, currentTemp);
         }
         
         if (displayIndex >= 0 && displayIndex < 4) {
+            portENTER_CRITICAL(&displayMux);
             nodeDisplayData[displayIndex].temp = temp;
             nodeDisplayData[displayIndex].hum = hum;
             nodeDisplayData[displayIndex].press = press;
+            nodeDisplayData[displayIndex].bmp_temp = bmpTemp;
+            portEXIT_CRITICAL(&displayMux);
+            nodeStatsAdd(displayIndex, TS_TEMP, temp);
+            nodeStatsAdd(displayIndex, TS_HUM, hum);
+            nodeStatsAdd(displayIndex, TS_PRESS, press);
+            rulesCheck(nodeId, RM_TEMP, temp);
+            rulesCheck(nodeId, RM_HUM, hum);
+            rulesCheck(nodeId, RM_PRESS, press);
+            
+            wsBroadcast(WS_PRIO_STATE, [&](WsWriter &w) { buildSensorData(w, displayIndex); });
+            wsBroadcast(WS_PRIO_STATE, [&](WsWriter &w) { buildNodeStats(w, displayIndex); });
         }
         
-        StaticJsonDocument<500> resp;
-        resp["type"] = "sensor_data";
-        resp["node"] = nodeId;
-        resp["aht20"]["temp"] = dataObj["AHT20"]["temp"].as<String>();
-        resp["aht20"]["hum"] = dataObj["AHT20"]["hum"].as<String>();
-        resp["bmp280"]["temp"] = dataObj["BMP280"]["temp"].as<String>();
-        resp["bmp280"]["press"] = dataObj["BMP280"]["press_mmHg"].as<String>();
-        
-        if (nodeId == 102) {
-            JsonObject weather = resp.createNestedObject("weather_data");
-            weather["pressure"] = serialized(String(press, 1));
-            weather["humidity"] = serialized(String(currentHumidity, 0));
-            weather["trend3h"] = serialized(String(pressureTrend3h, 1));
-            weather["trend6h"] = serialized(String(pressureTrend6h, 1));
-            weather["trend12h"] = serialized(String(pressureTrend12h, 1));
-            weather["forecast"] = shortForecast;
-            weather["icon"] = weatherIcon;
-            weather["frost"] = frostRisk;
-        }
-        
-        String json;
-        serializeJson(resp, json);
-        ws.textAll(json);
-        
         Serial.printf("Данные узла #%d: T=%.1f, P=%.1f, H=%.0f\n", nodeId, temp, press, hum);
         
-        // Обновляем страницу метеостанции при новых данных
-        if (currentPage == PAGE_WEATHER) {
-            displayWeatherPage();
-        }
-        // Обновляем страницу узла если она открыта
-        else if (currentPage == PAGE_NODE_INFO && displayIndex == displayNodeIndex) {
-            displayNodePage();
-        }
+        displayInvalidate(DISPLAY_DIRTY_WEATHER | DISPLAY_DIRTY_NODE);
     }
     else if (strcmp(type, "security") == 0) {
         bool alarm = doc["alarm"];
@@ -558,106 +1605,122 @@ void processNodeData(const uint8_t *data, int len, int nodeIndex) {
         bool c2 = doc["contact2"];
         
         nodeAlarmState[nodeIndex] = alarm;
+        journalAdd(nodeId, EV_SECURITY, (alarm ? 1 : 0) | (c1 ? 2 : 0) | (c2 ? 4 : 0));
         
         if (displayIndex >= 0 && displayIndex < 4) {
+            portENTER_CRITICAL(&displayMux);
             nodeDisplayData[displayIndex].alarm = alarm;
             nodeDisplayData[displayIndex].contact1 = c1;
             nodeDisplayData[displayIndex].contact2 = c2;
+            portEXIT_CRITICAL(&displayMux);
         }
         
         if (alarm && !securityAlarmActive && nodeId == 102) {
             securityAlarmActive = true;
             alarmStartTime = millis();
-            showAlert("KONTS RAZOMKNUT");
+            showAlert("КОНТАКТ РАЗОМКНУТ");
         } else if (!alarm && nodeId == 102) {
             securityAlarmActive = false;
             clearAlert();
         }
         
-        StaticJsonDocument<200> resp;
-        resp["type"] = "security";
-        resp["node"] = nodeId;
-        resp["alarm"] = alarm;
-        resp["contact1"] = c1;
-        resp["contact2"] = c2;
-        String json;
-        serializeJson(resp, json);
-        ws.textAll(json);
+        wsBroadcast(WS_PRIO_EVENT, [&](WsWriter &w) {
+            w.beginObject();
+            w.field("type", "security");
+            w.field("node", nodeId);
+            w.fieldBool("alarm", alarm);
+            w.fieldBool("contact1", c1);
+            w.fieldBool("contact2", c2);
+            w.endObject();
+        });
         
-        // Обновляем страницу узла
-        if (currentPage == PAGE_NODE_INFO && displayIndex == displayNodeIndex) {
-            displayNodePage();
-        }
+        displayInvalidate(DISPLAY_DIRTY_NODE);
     }
     else if (strcmp(type, "ack") == 0) {
-        const char* cmd = doc["command"];
+        const char* cmd = doc["command"] | "";
+        uint16_t cmdId = doc["id"] | 0;
+        if (cmdId) nodeAcksWithId[nodeIndex] = true;
+        completeCommand(nodeIndex, cmdId, cmd, nullptr);
+        
+        uint8_t cmdCode = strcmp(cmd, "LED_ON") == 0 ? 1 : strcmp(cmd, "LED_OFF") == 0 ? 2 :
+                          strcmp(cmd, "GET_STATUS") == 0 ? 3 : 0;
+        journalAdd(nodeId, EV_COMMAND_ACK, ((int32_t)cmdId << 8) | cmdCode);
+        
         if (strcmp(cmd, "LED_ON") == 0) {
             if (displayIndex >= 0 && displayIndex < 4) {
+                portENTER_CRITICAL(&displayMux);
                 nodeDisplayData[displayIndex].led_state = true;
+                portEXIT_CRITICAL(&displayMux);
             }
             
-            StaticJsonDocument<200> resp;
-            resp["type"] = "node_status";
-            resp["node"] = nodeId;
-            resp["state"] = "on";
-            String json;
-            serializeJson(resp, json);
-            ws.textAll(json);
+            wsBroadcast(WS_PRIO_EVENT, [&](WsWriter &w) {
+                w.beginObject();
+                w.field("type", "node_status");
+                w.field("node", nodeId);
+                w.field("state", "on");
+                w.endObject();
+            });
             
             Serial.printf("LED ON #%d\n", nodeId);
             
-            // Обновляем страницу узла
-            if (currentPage == PAGE_NODE_INFO && displayIndex == displayNodeIndex) {
-                displayNodePage();
-            }
+            displayInvalidate(DISPLAY_DIRTY_NODE);
         }
         else if (strcmp(cmd, "LED_OFF") == 0) {
             if (displayIndex >= 0 && displayIndex < 4) {
+                portENTER_CRITICAL(&displayMux);
                 nodeDisplayData[displayIndex].led_state = false;
+                portEXIT_CRITICAL(&displayMux);
             }
             
-            StaticJsonDocument<200> resp;
-            resp["type"] = "node_status";
-            resp["node"] = nodeId;
-            resp["state"] = "off";
-            String json;
-            serializeJson(resp, json);
-            ws.textAll(json);
+            wsBroadcast(WS_PRIO_EVENT, [&](WsWriter &w) {
+                w.beginObject();
+                w.field("type", "node_status");
+                w.field("node", nodeId);
+                w.field("state", "off");
+                w.endObject();
+            });
             
             Serial.printf("LED OFF #%d\n", nodeId);
             
-            // Обновляем страницу узла
-            if (currentPage == PAGE_NODE_INFO && displayIndex == displayNodeIndex) {
-                displayNodePage();
-            }
+            displayInvalidate(DISPLAY_DIRTY_NODE);
         }
     }
     else if (strcmp(type, "gpio") == 0) {
-        StaticJsonDocument<200> resp;
-        resp["type"] = "gpio_status";
-        resp["node"] = nodeId;
+        // Старые узлы не подтверждают GET_STATUS - ответом служит статус GPIO.
+        // Новые шлют gpio и после LED_ON/LED_OFF, им GET_STATUS закрывает только ack
+        if (!nodeAcksWithId[nodeIndex]) completeCommand(nodeIndex, 0, "GET_STATUS", nullptr);
+        
+        bool hasGpio8 = false;
+        int gpio8State = 0;
         if (doc.containsKey("pin") && doc.containsKey("state")) {
             int pin = doc["pin"];
             int state = doc["state"];
             if (pin == 8) {
-                resp["gpio8"] = state;
+                hasGpio8 = true;
+                gpio8State = state;
                 
                 if (displayIndex >= 0 && displayIndex < 4) {
+                    portENTER_CRITICAL(&displayMux);
                     nodeDisplayData[displayIndex].led_state = (state == 1);
+                    portEXIT_CRITICAL(&displayMux);
                 }
                 
                 Serial.printf("GPIO8 #%d = %d\n", nodeId, state);
                 
-                // Обновляем страницу узла
-                if (currentPage == PAGE_NODE_INFO && displayIndex == displayNodeIndex) {
-                    displayNodePage();
-                }
+                displayInvalidate(DISPLAY_DIRTY_NODE);
             }
         }
-        String json;
-        serializeJson(resp, json);
-        ws.textAll(json);
+        wsBroadcast(WS_PRIO_EVENT, [&](WsWriter &w) {
+            w.beginObject();
+            w.field("type", "gpio_status");
+            w.field("node", nodeId);
+            if (hasGpio8) w.field("gpio8", gpio8State);
+            w.endObject();
+        });
     }
+    // Энкодер ветра (узел 102): грязными помечаются и погода, и страница узла.
+    // Компас есть только на погоде - там поворот перерисовывает одну стрелку
+    // (CompassWidget); на странице узла компаса нет, только магнит текстом
     else if (strcmp(type, "encoder") == 0 && nodeIndex == 0) {
         bool hasMagnet = doc.containsKey("magnet");
         if (!hasMagnet) return;
@@ -665,38 +1728,38 @@ void processNodeData(const uint8_t *data, int len, int nodeIndex) {
         bool magnet = doc["magnet"];
         
         if (displayIndex >= 0 && displayIndex < 4) {
+            bool hasAngle = doc.containsKey("angle");
+            float angle = doc["angle"] | 0.0f;
+            portENTER_CRITICAL(&displayMux);
             nodeDisplayData[displayIndex].magnet = magnet;
-            if (doc.containsKey("angle")) {
-                float angle = doc["angle"];
-                nodeDisplayData[displayIndex].wind_angle = angle;
-                processEncoderData(angle, magnet);
-            }
+            if (hasAngle) nodeDisplayData[displayIndex].wind_angle = angle;
+            portEXIT_CRITICAL(&displayMux);
+            if (hasAngle) processEncoderData(angle, magnet);
         }
         
         if (!magnet) {
             if (!nodeAlarmState[nodeIndex]) {
+                journalAdd(nodeId, EV_MAGNET, 0);
                 sendEncoderAlarmStatus(nodeIndex, true, "Magnet lost");
                 nodeAlarmState[nodeIndex] = true;
+                portENTER_CRITICAL(&displayMux);
                 nodeDisplayData[displayIndex].alarm = true;
-                showAlert("MAGNIT NET");
+                portEXIT_CRITICAL(&displayMux);
+                showAlert("НЕТ МАГНИТА");
             }
         } else {
             if (nodeAlarmState[nodeIndex]) {
+                journalAdd(nodeId, EV_MAGNET, 1);
                 sendEncoderAlarmStatus(nodeIndex, false, "Magnet restored");
                 nodeAlarmState[nodeIndex] = false;
+                portENTER_CRITICAL(&displayMux);
                 nodeDisplayData[displayIndex].alarm = false;
+                portEXIT_CRITICAL(&displayMux);
                 clearAlert();
             }
         }
         
-        // Обновляем страницу метеостанции при новых данных энкодера
-        if (currentPage == PAGE_WEATHER) {
-            displayWeatherPage();
-        }
-        // Обновляем страницу узла если открыта
-        else if (currentPage == PAGE_NODE_INFO && displayIndex == displayNodeIndex) {
-            displayNodePage();
-        }
+        displayInvalidate(DISPLAY_DIRTY_WEATHER | DISPLAY_DIRTY_NODE);
     }
 }
 
@@ -715,35 +1778,35 @@ void processGreenhouseData(const uint8_t *data) {
     strncpy(temp_in, pkt.temp_in, 4);
     strncpy(temp_out, pkt.temp_out, 4);
 
-    currentTemp = atof(temp_out);
+    float tempOut = atof(temp_out);
+    portENTER_CRITICAL(&displayMux);
+    currentTemp = tempOut;
     currentHumidity = pkt.hum_in;
+    portEXIT_CRITICAL(&displayMux);
+    uint32_t sparkTime = nodeStatsTime();
+    portENTER_CRITICAL(&nodeStatsMux);
+    weatherSparkTemp.add(sparkTime, tempOut);
+    portEXIT_CRITICAL(&nodeStatsMux);
     
+    if (greenhouseDisplay.relay1 != (bool)pkt.relay1_state) journalAdd(0, EV_RELAY, (1 << 1) | (pkt.relay1_state ? 1 : 0));
+    if (greenhouseDisplay.relay2 != (bool)pkt.relay2_state) journalAdd(0, EV_RELAY, (2 << 1) | (pkt.relay2_state ? 1 : 0));
+    portENTER_CRITICAL(&displayMux);
     greenhouseDisplay.temp_in = atof(temp_in);
     greenhouseDisplay.temp_out = atof(temp_out);
     greenhouseDisplay.hum_in = pkt.hum_in;
     greenhouseDisplay.relay1 = pkt.relay1_state;
     greenhouseDisplay.relay2 = pkt.relay2_state;
+    portEXIT_CRITICAL(&displayMux);
+    
+    tsAddSample(TS_NODE_GREENHOUSE, TS_TEMP, greenhouseDisplay.temp_in);
+    tsAddSample(TS_NODE_GREENHOUSE, TS_TEMP_OUT, greenhouseDisplay.temp_out);
+    tsAddSample(TS_NODE_GREENHOUSE, TS_HUM, greenhouseDisplay.hum_in);
 
-    StaticJsonDocument<300> resp;
-    resp["type"] = "greenhouse_data";
-    resp["temp_in"] = temp_in;
-    resp["temp_out"] = temp_out;
-    resp["hum_in"] = pkt.hum_in;
-    resp["relay1_state"] = pkt.relay1_state;
-    resp["relay2_state"] = pkt.relay2_state;
-
-    String json;
-    serializeJson(resp, json);
-    ws.textAll(json);
+    wsBroadcast(WS_PRIO_STATE, buildGreenhouseData);
     
     Serial.println("Greenhouse data updated");
     
-    // Обновляем страницу метеостанции и теплицы при новых данных
-    if (currentPage == PAGE_WEATHER) {
-        displayWeatherPage();
-    } else if (currentPage == PAGE_GREENHOUSE) {
-        displayGreenhousePage();
-    }
+    displayInvalidate(DISPLAY_DIRTY_WEATHER | DISPLAY_DIRTY_GREENHOUSE);
 }
 
 void checkNodeConnection() {
@@ -755,37 +1818,37 @@ void checkNodeConnection() {
                     nodeConnectionLost[i] = true;
                     connectionLostTime[i] = now;
                     Serial.printf("Node #%d LOST!\n", nodeNumbers[i]);
+                    journalAdd(nodeNumbers[i], EV_CONNECTION, 0);
                     sendConnectionStatusToWeb(i, false);
                     
                     if (i < 4) {
+                        portENTER_CRITICAL(&displayMux);
                         nodeDisplayData[i].connected = false;
+                        portEXIT_CRITICAL(&displayMux);
                     }
                     
-                    char alertMsg[20];
-                    sprintf(alertMsg, "UZEL #%d LOST", nodeNumbers[i]);
+                    char alertMsg[40];
+                    snprintf(alertMsg, sizeof(alertMsg), "УЗЕЛ #%d НЕТ СВЯЗИ", nodeNumbers[i]);
                     showAlert(alertMsg);
                     
-                    // Обновляем страницу узла если она открыта
-                    if (currentPage == PAGE_NODE_INFO && i == displayNodeIndex) {
-                        displayNodePage();
-                    }
+                    displayInvalidate(DISPLAY_DIRTY_NODE);
                 }
             } else {
                 if (nodeConnectionLost[i]) {
                     nodeConnectionLost[i] = false;
                     Serial.printf("Node #%d RESTORED!\n", nodeNumbers[i]);
+                    journalAdd(nodeNumbers[i], EV_CONNECTION, 1);
                     sendConnectionStatusToWeb(i, true);
                     
                     if (i < 4) {
+                        portENTER_CRITICAL(&displayMux);
                         nodeDisplayData[i].connected = true;
+                        portEXIT_CRITICAL(&displayMux);
                     }
                     
                     clearAlert();
                     
-                    // Обновляем страницу узла если она открыта
-                    if (currentPage == PAGE_NODE_INFO && i == displayNodeIndex) {
-                        displayNodePage();
-                    }
+                    displayInvalidate(DISPLAY_DIRTY_NODE);
                 }
             }
         }
@@ -793,12 +1856,12 @@ void checkNodeConnection() {
 }
 
 void sendConnectionStatusToWeb(int nodeIndex, bool connected) {
-    StaticJsonDocument<100> doc;
-    doc["type"] = connected ? "connection_restored" : "connection_lost";
-    doc["node"] = nodeNumbers[nodeIndex];
-    String json;
-    serializeJson(doc, json);
-    ws.textAll(json);
+    wsBroadcast(WS_PRIO_EVENT, [&](WsWriter &w) {
+        w.beginObject();
+        w.field("type", connected ? "connection_restored" : "connection_lost");
+        w.field("node", nodeNumbers[nodeIndex]);
+        w.endObject();
+    });
 }
 
 void updateAlarmState() {
@@ -810,280 +1873,198 @@ void updateAlarmState() {
 
 void sendEncoderAlarmStatus(int nodeIndex, bool alarm, const char* message) {
     nodeAlarmState[nodeIndex] = alarm;
-    StaticJsonDocument<200> doc;
-    doc["type"] = "encoder_alarm";
-    doc["node"] = nodeNumbers[nodeIndex];
-    doc["alarm"] = alarm;
-    doc["message"] = message;
-    String json;
-    serializeJson(doc, json);
-    ws.textAll(json);
+    wsBroadcast(WS_PRIO_EVENT, [&](WsWriter &w) {
+        w.beginObject();
+        w.field("type", "encoder_alarm");
+        w.field("node", nodeNumbers[nodeIndex]);
+        w.fieldBool("alarm", alarm);
+        w.field("message", message);
+        w.endObject();
+    });
     Serial.printf("Encoder alarm #%d: %s\n", nodeNumbers[nodeIndex], message);
 }
 
 // ========== ФУНКЦИИ МЕТЕОСТАНЦИИ ==========
 
-void updateWeatherHistory(float pressure, float temp, float humidity) {
-    weatherHistory[weatherIndex].pressure = pressure;
-    weatherHistory[weatherIndex].temperature = temp;
-    weatherHistory[weatherIndex].humidity = humidity;
-    weatherHistory[weatherIndex].timestamp = millis();
-    
-    weatherIndex = (weatherIndex + 1) % PRESSURE_HISTORY_SIZE;
-    if (weatherCount < PRESSURE_HISTORY_SIZE) weatherCount++;
-    
+void updateWeatherHistory(float pressure, float temp) {
+    // Без RTC - секунды с загрузки: история не переживёт перезагрузку, но тренды считаются
+    pressureHistory.add(rtcOK ? lastRTCUnix : millis() / 1000, pressure);
     calculatePressureTrends();
+    weatherSparkSync();
     
     if (millis() - lastForecastUpdate > FORECAST_UPDATE_INTERVAL) {
-        time_t nowTime = time(nullptr);
-        struct tm *timeinfo = localtime(&nowTime);
-        int month = timeinfo->tm_mon + 1;
-        int hour = timeinfo->tm_hour;
-        
-        shortForecast = generateForecast(pressure, pressureTrend3h, humidity, month);
-        weatherIcon = getWeatherIcon(shortForecast);
-        frostRisk = checkFrostRisk(temp, hour, month);
+        updateForecast(pressure, temp);
         lastForecastUpdate = millis();
         
         broadcastWeatherData();
     }
 }
 
-void calculatePressureTrends() {
-    if (weatherCount < 6) return;
-    unsigned long now = millis();
-    float pressureNow = 0, pressure3hAgo = 0, pressure6hAgo = 0, pressure12hAgo = 0;
-    int countNow = 0, count3h = 0, count6h = 0, count12h = 0;
-    
-    for (int i = 0; i < weatherCount; i++) {
-        unsigned long age = now - weatherHistory[i].timestamp;
-        if (age < 300000) { pressureNow += weatherHistory[i].pressure; countNow++; }
-        if (age > 900000 && age < 1170000) { pressure3hAgo += weatherHistory[i].pressure; count3h++; }
-        if (age > 1980000 && age < 2220000) { pressure6hAgo += weatherHistory[i].pressure; count6h++; }
-        if (age > 4140000 && age < 4380000) { pressure12hAgo += weatherHistory[i].pressure; count12h++; }
-    }
-    
-    if (countNow > 0 && count3h > 0) pressureTrend3h = (pressureNow/countNow) - (pressure3hAgo/count3h);
-    if (countNow > 0 && count6h > 0) pressureTrend6h = (pressureNow/countNow) - (pressure6hAgo/count6h);
-    if (countNow > 0 && count12h > 0) pressureTrend12h = (pressureNow/countNow) - (pressure12hAgo/count12h);
-}
-
-String generateForecast(float pressure, float trend, float humidity, int month) {
-    bool isWinter = (month <= 3 || month >= 10);
-    
-    if (trend > 1.5) {
-        if (pressure > 1020) return "YASNO UL";
-        if (pressure > 1005) return "PER OBL";
-        return "OBL BEZ OS";
-    } else if (trend > 0.3) {
-        if (pressure > 1015) return "MALO OBL";
-        return "OBL PROYAS";
-    } else if (trend > -0.3) {
-        if (pressure > 1020) return "YASNO";
-        if (pressure > 1010) return "PER OBL";
-        return "OBLACHNO";
-    } else if (trend > -1.5) {
-        if (humidity > 80) return "DOZHD?";
-        return "PASMURNO";
-    } else {
-        if (isWinter) {
-            if (pressure < 1000) return "SNEG VETER";
-            return "OBL SNEG";
-        } else {
-            if (humidity > 85) return "DOZHD GROZA";
-            return "DOZHD";
-        }
+// Месяц и час - из RTC; без него прогноз без сезонной поправки, заморозки не оцениваются
+void updateForecast(float pressure, float temp) {
+    uint8_t month = 0, hour = 0;
+    if (rtcOK) {
+        DateTime now(lastRTCUnix);
+        month = now.month();
+        hour = now.hour();
+    }
+    float seaHpa = forecastSeaLevel(pressure * FC_MMHG_TO_HPA, STATION_ALTITUDE_M, temp);
+    bool wasWet = forecastWet(weatherIcon);
+    weatherForecast = forecastZambretti(seaHpa, pressureTrend3h * FC_MMHG_TO_HPA, month);
+    WeatherIcon icon = forecastIcon(weatherForecast, temp);
+    FrostRisk frost = forecastFrost(temp, hour, month);
+    portENTER_CRITICAL(&displayMux);
+    weatherIcon = icon;
+    frostRisk = frost;
+    portEXIT_CRITICAL(&displayMux);
+    
+    wsBroadcast(WS_PRIO_STATE, buildWeatherForecast);
+    if (!wasWet && forecastWet(weatherIcon)) {
+        journalAdd(nodeNumbers[0], EV_WEATHER_ALARM, -1);
+        wsBroadcast(WS_PRIO_EVENT, [&](WsWriter &w) {
+            w.beginObject();
+            w.field("type", "weather_alarm");
+            w.field("alarm_type", "rain");
+            w.field("node", nodeNumbers[0]);
+            w.field("forecast", forecastText(weatherForecast));
+            w.endObject();
+        });
     }
 }
 
-String getWeatherIcon(String forecast) {
-    if (forecast.indexOf("YASNO") >= 0) return "☀️";
-    if (forecast.indexOf("MALO OBL") >= 0) return "🌤️";
-    if (forecast.indexOf("PER OBL") >= 0) return "⛅";
-    if (forecast.indexOf("OBL PROYAS") >= 0) return "🌥️";
-    if (forecast.indexOf("OBLACHNO") >= 0) return "☁️";
-    if (forecast.indexOf("PASMURNO") >= 0) return "☁️☁️";
-    if (forecast.indexOf("DOZHD") >= 0) return "🌧️";
-    if (forecast.indexOf("GROZA") >= 0) return "⛈️";
-    if (forecast.indexOf("SNEG") >= 0) return "❄️";
-    return "---";
+// Погода метеостанции для сообщений
+WsWeather wsWeather() {
+    return WsWeather{currentPressure, currentHumidity, pressureTrend3h, pressureTrend6h, pressureTrend12h,
+                     weatherForecast, weatherIcon, frostRisk};
 }
 
-String getWeatherText(String icon) {
-    if (icon == "---") return "---";
-    if (icon == "☀️") return "SOLNCE";
-    if (icon == "🌤️") return "MALO SOLN";
-    if (icon == "⛅") return "OBL SOLN";
-    if (icon == "🌥️") return "OBLACHNO";
-    if (icon == "☁️") return "OBLACHNO";
-    if (icon == "☁️☁️") return "PASMURNO";
-    if (icon == "🌧️") return "DOZHD";
-    if (icon == "⛈️") return "GROZA";
-    if (icon == "❄️") return "SNEG";
-    return "---";
+void buildWeatherForecast(WsWriter &w) {
+    wsWeatherForecast(w, nodeNumbers[0], wsWeather());
 }
 
-String checkFrostRisk(float temp, int hour, int month) {
-    if (month < 4 || month > 9) return "0%";
-    
-    if (hour >= 20 && hour <= 22) {
-        if (temp < 3.0) return "100%";
-        if (temp < 6.0) return "70%";
-        if (temp < 10.0) return "30%";
-    }
-    
-    if (hour >= 0 && hour <= 6) {
-        if (temp < 2.0) return "100%";
-        if (temp < 5.0) return "80%";
-    }
-    
-    return "0%";
+// Окна обновляются при закрытии 5-минутной корзины, здесь - только чтение
+void calculatePressureTrends() {
+    pressureHistory.trend(PH_TREND_3H, pressureTrend3h);
+    pressureHistory.trend(PH_TREND_6H, pressureTrend6h);
+    pressureHistory.trend(PH_TREND_12H, pressureTrend12h);
+}
+
+void buildSensorData(WsWriter &w, int displayIndex) {
+    const NodeDisplayData &node = nodeDisplayData[displayIndex];
+    WsWeather weather = wsWeather();
+    weather.pressure = node.press;
+    wsSensorData(w, WsSensor{node.id, node.temp, node.hum, node.bmp_temp, node.press},
+                 node.id == 102 ? &weather : nullptr);
+}
+
+// Время для суточной статистики: RTC, без него - аптайм
+uint32_t nodeStatsTime() {
+    return rtcOK ? lastRTCUnix : millis() / 1000;
+}
+
+// Из обработчика ESP-NOW: O(1), под спинлоком против чтения из loop()
+void nodeStatsAdd(int displayIndex, TsMetric metric, float value) {
+    if (isnan(value) || metric >= NODE_STATS_METRICS) return;
+    uint32_t t = nodeStatsTime();
+    portENTER_CRITICAL(&nodeStatsMux);
+    nodeStats[displayIndex][metric].add(t, value);
+    if (metric == TS_TEMP) nodeSparkTemp[displayIndex].add(t, value);
+    else if (metric == TS_PRESS) nodeSparkPress[displayIndex].add(t, value);
+    portEXIT_CRITICAL(&nodeStatsMux);
+}
+
+// Закрылась 30-минутная корзина pressureHistory - копия кольца для графика.
+// Пишет тот же поток, что и pressureHistory.add()
+void weatherSparkSync() {
+    SparkSeries series;
+    sparkFromCoarse(pressureHistory, series);
+    if (series.newest == weatherSparkPress.newest) return;
+    portENTER_CRITICAL(&nodeStatsMux);
+    weatherSparkPress = series;
+    portEXIT_CRITICAL(&nodeStatsMux);
+}
+
+RunningStats nodeStatsGet(int displayIndex, TsMetric metric) {
+    portENTER_CRITICAL(&nodeStatsMux);
+    RunningStats stats = nodeStats[displayIndex][metric];
+    portEXIT_CRITICAL(&nodeStatsMux);
+    return stats;
+}
+
+void buildNodeStats(WsWriter &w, int displayIndex) {
+    RunningStats stats[NODE_STATS_METRICS];
+    for (uint8_t m = 0; m < NODE_STATS_METRICS; m++) stats[m] = nodeStatsGet(displayIndex, (TsMetric)m);
+    wsNodeStats(w, nodeDisplayData[displayIndex].id, stats, nodeStatsTime());
+}
+
+void buildGreenhouseData(WsWriter &w) {
+    wsGreenhouseData(w, WsGreenhouse{greenhouseDisplay.temp_in, greenhouseDisplay.temp_out, greenhouseDisplay.hum_in,
+                                     greenhouseDisplay.relay1, greenhouseDisplay.relay2});
+}
+
+void buildWeatherUpdate(WsWriter &w) {
+    wsWeatherUpdate(w, wsWeather());
 }
 
 void broadcastWeatherData() {
     if (currentPressure == 0) return;
-    
-    StaticJsonDocument<400> doc;
-    doc["type"] = "weather_update";
-    doc["pressure"] = serialized(String(currentPressure, 1));
-    doc["humidity"] = serialized(String(currentHumidity, 0));
-    doc["trend3h"] = serialized(String(pressureTrend3h, 1));
-    doc["trend6h"] = serialized(String(pressureTrend6h, 1));
-    doc["trend12h"] = serialized(String(pressureTrend12h, 1));
-    doc["forecast"] = shortForecast;
-    doc["icon"] = weatherIcon;
-    doc["frost"] = frostRisk;
-    
-    String json;
-    serializeJson(doc, json);
-    ws.textAll(json);
+    wsBroadcast(WS_PRIO_STATE, buildWeatherUpdate);
 }
 
 // ========== ФУНКЦИИ ВЕТРА ==========
 
+// O(1): показание уходит в открытую корзину движка, окна пересчитываются при её закрытии
 void processEncoderData(float angle, bool magnet) {
-    if (prevEncoderAngle < 0) {
-        prevEncoderAngle = angle;
-        currentEncoderAngle = angle;
+    uint32_t now = millis();
+    portENTER_CRITICAL(&windMux);
+    bool first = windEngine.samples() == 0;
+    if (first) {
         windDirection = angle;
         windCurrentSector = 0.0;
-        Serial.printf("First value %.1f°\n", angle);
-    } else {
-        prevEncoderAngle = currentEncoderAngle;
-        currentEncoderAngle = angle;
-        
-        float diff = fmod(currentEncoderAngle - prevEncoderAngle + 540.0, 360.0) - 180.0;
-        windCurrentSector = fabs(diff);
-        
-        float rad1 = radians(prevEncoderAngle);
-        float rad2 = radians(currentEncoderAngle);
-        float sumSin = sin(rad1) + sin(rad2);
-        float sumCos = cos(rad1) + cos(rad2);
-        float meanRad = atan2(sumSin, sumCos);
-        windDirection = degrees(meanRad);
-        if (windDirection < 0) windDirection += 360.0;
-        
-        Serial.printf("Dir=%.1f°, sector=%.1f°\n", windDirection, windCurrentSector);
     }
+    windEngine.add(now, angle);
     windMagnet = magnet;
+    portEXIT_CRITICAL(&windMux);
+    if (first) Serial.printf("First value %.1f°\n", angle);
 }
 
-void updateHistory(float angle) {
-    encoderHistory[historyIndex] = angle;
-    historyTimestamps[historyIndex] = millis();
-    historyIndex = (historyIndex + 1) % ENCODER_HISTORY_SIZE;
-    if (historyCount < ENCODER_HISTORY_SIZE) historyCount++;
+// Закрывает корзины по времени и снимает статистику минутного окна
+void windUpdate(unsigned long now) {
+    WindStats st;
+    portENTER_CRITICAL(&windMux);
+    windEngine.advance(now);
+    bool ready = windEngine.stats(WIND_1MIN, st);
+    if (ready) {
+        windDirection = st.direction;
+        windCurrentSector = min(2.0f * st.deviation, 360.0f);
+        maxSectorStart = st.gustStart;
+        maxSectorEnd = st.gustEnd;
+        maxSectorWidth = st.gustWidth;
+    } else {
+        maxSectorWidth = 0.0;
+    }
+    portEXIT_CRITICAL(&windMux);
+    if (ready) rulesCheck(nodeNumbers[0], RM_WIND, st.direction);
 }
 
-void updateMaxMin() {
-    if (historyCount < 2 || !windMagnet) return;
-    unsigned long now = millis();
-    
-    float periodMin = 361.0, periodMax = -1.0;
-    int periodCount = 0;
-    
-    for (int i = 0; i < historyCount; i++) {
-        if (now - historyTimestamps[i] <= HISTORY_PERIOD_MS) {
-            float a = encoderHistory[i];
-            if (a < periodMin) periodMin = a;
-            if (a > periodMax) periodMax = a;
-            periodCount++;
-        }
-    }
-    
-    if (periodCount >= 2) {
-        float periodWidth = periodMax - periodMin;
-        if (periodWidth < 0) periodWidth += 360;
-        if (periodWidth > 180) periodWidth = 360 - periodWidth;
-        
-        if (periodWidth > maxSectorWidth) {
-            maxSectorWidth = periodWidth;
-            float centerAngle = (periodMin + periodMax) / 2.0;
-            if (periodMax - periodMin > 180) centerAngle += 180;
-            if (centerAngle >= 360) centerAngle -= 360;
-            maxSectorStart = centerAngle - maxSectorWidth / 2;
-            maxSectorEnd = centerAngle + maxSectorWidth / 2;
-            maxSectorStart = fmod(fmod(maxSectorStart, 360) + 360, 360);
-            maxSectorEnd = fmod(fmod(maxSectorEnd, 360) + 360, 360);
-            maxSectorTimestamp = now;
-            
-            Serial.printf("NEW MAX: %.1f°\n", maxSectorWidth);
-        }
-        
-        if (now - maxSectorTimestamp > HISTORY_PERIOD_MS) {
-            maxSectorWidth = periodWidth;
-            maxSectorStart = currentSectorStart;
-            maxSectorEnd = currentSectorEnd;
-            maxSectorTimestamp = now;
-        }
-    }
+void buildWindData(WsWriter &w) {
+    WindStats st;
+    portENTER_CRITICAL(&windMux);
+    bool tenMin = windEngine.stats(WIND_10MIN, st);
+    WsWind wind = {windMagnet, windDirection, windCurrentSector, maxSectorStart, maxSectorEnd, maxSectorWidth};
+    portEXIT_CRITICAL(&windMux);
+    wsWindData(w, wind, tenMin ? &st : nullptr);
 }
 
 void broadcastEncoderData() {
-    if (prevEncoderAngle < 0) return;
-    
-    if (!windMagnet) {
-        StaticJsonDocument<128> doc;
-        doc["type"] = "wind";
-        doc["magnet"] = false;
-        doc["stability"] = "no_magnet";
-        String json;
-        serializeJson(doc, json);
-        ws.textAll(json);
-        return;
-    }
-    
-    float redStart = fmod(fmod(windDirection - windCurrentSector/2, 360) + 360, 360);
-    float redEnd = fmod(fmod(windDirection + windCurrentSector/2, 360) + 360, 360);
-    
-    String stability;
-    if (windCurrentSector < 10) stability = "calm";
-    else if (windCurrentSector < 30) stability = "gusty";
-    else if (windCurrentSector < 60) stability = "strong";
-    else stability = "storm";
+    if (windEngine.samples() == 0) return;
     
-    StaticJsonDocument<256> doc;
-    doc["type"] = "wind";
-    doc["angle_avg"] = serialized(String(windDirection, 1));
-    doc["sector_width"] = serialized(String(windCurrentSector, 1));
-    doc["sector_start"] = serialized(String(redStart, 0));
-    doc["sector_end"] = serialized(String(redEnd, 0));
+    wsBroadcast(WS_PRIO_STATE, buildWindData);
     
-    if (maxSectorWidth > 0) {
-        doc["history_min"] = serialized(String(maxSectorStart, 0));
-        doc["history_max"] = serialized(String(maxSectorEnd, 0));
-        doc["history_width"] = serialized(String(maxSectorWidth, 1));
+    if (windMagnet) {
+        Serial.printf("Wind: dir=%.1f°, red=%.1f°, yellow=%.1f°\n",
+                      windDirection, windCurrentSector, maxSectorWidth);
     }
-    
-    doc["magnet"] = windMagnet;
-    doc["stability"] = stability;
-    
-    String json;
-    serializeJson(doc, json);
-    ws.textAll(json);
-    
-    Serial.printf("Wind: dir=%.1f°, red=%.1f°, yellow=%.1f°\n",
-                  windDirection, windCurrentSector, maxSectorWidth);
 }
 
 // ========== ФУНКЦИИ ДИСПЛЕЯ ==========
@@ -1104,6 +2085,7 @@ void initDisplay() {
     tftSPI.begin(TFT_SCK, -1, TFT_MOSI, TFT_CS);
     tft.initR(INITR_GREENTAB);
     tft.setRotation(1);
+    hubDisplay.sync();
     tft.fillScreen(ST77XX_BLACK);
     tft.setTextColor(ST77XX_WHITE);
     tft.setTextSize(1);
@@ -1124,7 +2106,7 @@ void initRTC() {
     if (!rtc.begin()) {
         Serial.println("FAIL");
         rtcOK = false;
-        showAlert("RTC OSHIBKA");
+        showAlert("ОШИБКА RTC");
         return;
     }
     
@@ -1138,6 +2120,7 @@ void initRTC() {
     }
     
     lastRTCRead = rtc.now();
+    lastRTCUnix = lastRTCRead.unixtime();
     lastDisplayedMinute = lastRTCRead.minute();
 }
 
@@ -1160,7 +2143,7 @@ while (sdInitAttempts < 3 && !sdInitSuccess) {
     sdInitAttempts++;
     Serial.printf("SD init attempt %d/3... ", sdInitAttempts);
     
-    if (SD.begin(SD_CS, sdSPI, 4000000)) {
+    if (SD.begin(SD_CS, sdSPI, 4000000, "/sd", SD_MAX_OPEN_FILES)) {
         sdInitSuccess = true;
         Serial.println("OK");
     } else {
@@ -1174,7 +2157,7 @@ while (sdInitAttempts < 3 && !sdInitSuccess) {
 if (!sdInitSuccess) {
     sdInitialized = false;
     strcpy(sdErrorMsg, "INIT FAIL");
-    showAlert("SD NET");
+    showAlert("НЕТ SD");
     return;
 }
     
@@ -1183,426 +2166,1945 @@ if (!sdInitSuccess) {
         Serial.println("NO CARD");
         sdInitialized = false;
         strcpy(sdErrorMsg, "NO CARD");
-        showAlert("SD NET");
+        showAlert("НЕТ SD");
         return;
     }
     
     sdInitialized = true;
     sdCardType = cardType;
+    // Полный проход по FAT - только здесь, дальше занятое место считает логгер
+    updateSDInfo();
     Serial.println("OK");
     clearAlert();
 }
 
-void checkHTMLFile() {
+void loadWebAssets() {
     if (!sdInitialized) {
         Serial.println("❌ SD card not initialized");
         return;
     }
     
-    if (SD.exists("/index.html")) {
-        File file = SD.open("/index.html");
-        size_t size = file.size();
+    // Сжатый вариант (scripts/web_assets.py) предпочтительнее
+    const char* candidates[] = {"/index.html.gz", "/index.html"};
+    for (int i = 0; i < 2; i++) {
+        if (!SD.exists(candidates[i])) continue;
+        File file = SD.open(candidates[i]);
+        if (!file) continue;
+        
+        indexPage.found = true;
+        indexPage.gzip = (i == 0);
+        strncpy(indexPage.path, candidates[i], sizeof(indexPage.path) - 1);
+        indexPage.size = file.size();
+        if (indexPage.size <= WEB_CACHE_MAX_BYTES) {
+            indexPage.ram = (uint8_t *)malloc(indexPage.size);
+        }
+        
+        // Один проход по файлу: CRC для ETag и, если есть место, копия в RAM
+        uint8_t chunk[512];
+        uint32_t crc = 0;
+        size_t offset = 0;
+        while (offset < indexPage.size) {
+            uint8_t *dst = indexPage.ram ? indexPage.ram + offset : chunk;
+            size_t want = indexPage.ram ? indexPage.size - offset : min(indexPage.size - offset, sizeof(chunk));
+            size_t got = file.read(dst, want);
+            if (got == 0) break;
+            crc = crc32_le(crc, dst, got);
+            offset += got;
+        }
         file.close();
-        Serial.printf("✅ HTML file found, size: %d bytes\n", size);
-    } else {
-        Serial.println("❌ HTML file not found! Create index.html on SD card");
-        showAlert("NET INDEX.HTML");
+        
+        if (offset != indexPage.size && indexPage.ram) {
+            free(indexPage.ram);
+            indexPage.ram = nullptr;
+        }
+        snprintf(indexPage.etag, sizeof(indexPage.etag), "\"%08x\"", (unsigned)crc);
+        
+        Serial.printf("✅ HTML file found: %s, %u bytes, %s, ETag %s\n", indexPage.path,
+                      (unsigned)indexPage.size, indexPage.ram ? "RAM" : "SD", indexPage.etag);
+        return;
     }
+    
+    Serial.println("❌ HTML file not found! Create index.html on SD card");
+    showAlert("НЕТ INDEX.HTML");
 }
 
-void updateSDInfo() {
-    if (!sdInitialized) return;
-    sdTotalBytes = SD.totalBytes() / (1024 * 1024);
-    sdUsedBytes = SD.usedBytes() / (1024 * 1024);
+void serveIndexPage(AsyncWebServerRequest *request) {
+    if (!indexPage.found) {
+        request->send(200, "text/html", "<h1>SD Card Error</h1><p>HTML file not found</p>");
+        Serial.println("❌ HTML файл не найден на SD");
+        return;
+    }
+    
+    // Страница у браузера актуальна - ни SD, ни передачи тела
+    if (request->hasHeader("If-None-Match") &&
+        request->getHeader("If-None-Match")->value() == indexPage.etag) {
+        AsyncWebServerResponse *response = request->beginResponse(304);
+        response->addHeader("ETag", indexPage.etag);
+        response->addHeader("Cache-Control", WEB_INDEX_CACHE_CONTROL);
+        request->send(response);
+        return;
+    }
+    
+    AsyncWebServerResponse *response;
+    if (indexPage.ram) {
+        response = request->beginResponse_P(200, "text/html", indexPage.ram, indexPage.size);
+    } else {
+        response = beginSdFileResponse(request, indexPage.path, "text/html");
+        if (!response) {
+            request->send(500, "text/html", "<h1>SD Card Error</h1>");
+            return;
+        }
+    }
+    if (indexPage.gzip) response->addHeader("Content-Encoding", "gzip");
+    response->addHeader("ETag", indexPage.etag);
+    response->addHeader("Cache-Control", WEB_INDEX_CACHE_CONTROL);
+    request->send(response);
 }
 
-void testSDWrite() {
-    if (!sdInitialized || !rtcOK) return;
+// /assets/*: если браузер принимает gzip и рядом лежит .gz - отдаём его
+void serveAsset(AsyncWebServerRequest *request) {
+    const String &url = request->url();
+    char path[72];
+    if (url.length() + 4 > sizeof(path) || url.indexOf("..") >= 0) {
+        request->send(400);
+        return;
+    }
     
-    DateTime now = rtc.now();
-    sdWriteCount++;
+    bool gzip = false;
+    if (request->hasHeader("Accept-Encoding") &&
+        request->getHeader("Accept-Encoding")->value().indexOf("gzip") >= 0) {
+        snprintf(path, sizeof(path), "%s.gz", url.c_str());
+        gzip = sdExists(path);
+    }
+    if (!gzip) snprintf(path, sizeof(path), "%s", url.c_str());
     
-    String dataLine = String(now.year()) + "-" +
-                      String(now.month()) + "-" +
-                      String(now.day()) + " " +
-                      String(now.hour()) + ":" +
-                      String(now.minute()) + ":" +
-                      String(now.second()) + "," +
-                      "P:" + String(currentPressure) +
-                      ",T:" + String(currentTemp) +
-                      ",H:" + String(currentHumidity) + "\n";
-    
-    File dataFile = SD.open("/weather.csv", FILE_APPEND);
-    if (dataFile) {
-        if (sdWriteCount == 1) {
-            dataFile.println("Date,Time,Pressure,Temp,Hum");
-        }
-        dataFile.print(dataLine);
-        dataFile.close();
-        updateSDInfo();
-    } else {
-        showAlert("OSHIBKA ZAPISI SD");
+    AsyncWebServerResponse *response = beginSdFileResponse(request, path, webContentType(url.c_str()));
+    if (!response) {
+        request->send(404);
+        return;
     }
+    if (gzip) response->addHeader("Content-Encoding", "gzip");
+    response->addHeader("Cache-Control", WEB_ASSETS_CACHE_CONTROL);
+    request->send(response);
 }
 
-String formatTime(int value) {
-    if (value < 10) return "0" + String(value);
-    return String(value);
+// Файл с SD, который читается кусками через задачу SD
+struct SdFileStream {
+    File file;
+    ~SdFileStream() { sdClose(file); }
+};
+
+AsyncWebServerResponse *beginSdFileResponse(AsyncWebServerRequest *request, const char *path, const char *contentType) {
+    std::shared_ptr<SdFileStream> stream(new SdFileStream());
+    stream->file = sdOpen(path, FILE_READ);
+    if (!stream->file) return nullptr;
+    
+    return request->beginChunkedResponse(contentType,
+        [stream](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+            return sdRead(stream->file, buffer, maxLen);
+        });
 }
 
-// ========== РАЗДЕЛИТЕЛЬНАЯ ЛИНИЯ ==========
-void drawSeparatorLine() {
-    // Рисуем тонкую линию под верхним баром
-    tft.drawLine(0, 18, 160, 18, ST77XX_CYAN);  // Желтая линия
+const char *webContentType(const char *path) {
+    static const struct { const char *ext; const char *type; } types[] = {
+        {".html", "text/html"},
+        {".css", "text/css"},
+        {".js", "application/javascript"},
+        {".json", "application/json"},
+        {".svg", "image/svg+xml"},
+        {".png", "image/png"},
+        {".ico", "image/x-icon"},
+        {".woff2", "font/woff2"}
+    };
+    const char *ext = strrchr(path, '.');
+    if (ext) {
+        for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+            if (strcmp(ext, types[i].ext) == 0) return types[i].type;
+        }
+    }
+    return "application/octet-stream";
 }
 
-// ========== ВЕРХНИЙ БАР ==========
-void drawTopBar(const char* pageName) {
-    // Очищаем верхнюю строку
-    tft.fillRect(0, 0, 160, 18, ST77XX_BLACK);
-    
-    // Рисуем название страницы слева
-    tft.setCursor(12, 6);
-    tft.setTextColor(ST77XX_CYAN);
-    tft.setTextSize(1);
-    tft.setFont();
-    tft.print(pageName);
+// ========== HTTP API ИСТОРИИ ==========
+
+void serveHistory(AsyncWebServerRequest *request) {
+    if (!sdInitialized || !rtcOK) {
+        request->send(503, "application/json", "{\"error\":\"sd_or_rtc\"}");
+        return;
+    }
     
+    std::shared_ptr<HistoryQuery> q(new HistoryQuery());
+    uint8_t metric = TS_PRESS;
+    if (request->hasParam("metric")) {
+        const String &name = request->getParam("metric")->value();
+        metric = TS_METRIC_COUNT;
+        for (uint8_t i = 0; i < TS_METRIC_COUNT; i++) {
+            if (name == TS_METRIC_NAMES[i]) metric = i;
+        }
+        if (metric == TS_METRIC_COUNT) {
+            request->send(400, "application/json", "{\"error\":\"metric\"}");
+            return;
+        }
+    }
     
-    // Получаем время
-    if (rtcOK) {
-        sprintf(timeStr, "%02d:%02d", lastRTCRead.hour(), lastRTCRead.minute());
-    } else {
-        strcpy(timeStr, "--:--");
+    uint16_t node = 102;
+    if (request->hasParam("node")) {
+        const String &name = request->getParam("node")->value();
+        node = (name == "gh") ? TS_NODE_GREENHOUSE : name.toInt();
+    }
+    int series = tsFindSeries(node, metric);
+    if (series < 0) {
+        request->send(404, "application/json", "{\"error\":\"series\"}");
+        return;
     }
+    q->series = series;
     
-    // Рисуем часы справа жирным шрифтом
-    tft.setFont(&FreeMonoBold9pt7b);
-    tft.setTextColor(ST77XX_CYAN);
-    tft.setCursor(100, 14);
-    tft.print(timeStr);
+    // Будущего на карте нет - to не дальше текущего времени
+    uint32_t nowUnix = lastRTCRead.unixtime();
+    q->to = request->hasParam("to") ? (uint32_t)request->getParam("to")->value().toInt() : nowUnix;
+    if (q->to > nowUnix) q->to = nowUnix;
+    q->from = request->hasParam("from") ? (uint32_t)request->getParam("from")->value().toInt()
+                                        : q->to - HISTORY_DEFAULT_RANGE_S;
+    q->step = request->hasParam("step") ? (uint32_t)request->getParam("step")->value().toInt() : 0;
+    if (q->step > 0 && q->step < HISTORY_MIN_STEP_S) q->step = HISTORY_MIN_STEP_S;
+    q->level = HISTORY_RAW;
+    for (uint8_t level = 0; level < TS_ROLLUP_LEVELS; level++) {
+        if (q->step >= TS_ROLLUP_SECONDS[level]) q->level = level;
+    }
+    if (q->from > q->to || q->to / 86400 - q->from / 86400 >= HISTORY_MAX_SPAN_DAYS[q->level]) {
+        request->send(400, "application/json", "{\"error\":\"range\"}");
+        return;
+    }
     
-    tft.setFont();
+    q->nextDay = q->from / 86400;
+    q->firstPoint = true;
+    q->recPos = 0;
+    q->recLen = 0;
     
-    // Перерисовываем линию (на случай если затерлась)
-    drawSeparatorLine();
+    AsyncWebServerResponse *response = request->beginChunkedResponse("application/json",
+        [q](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+            return historyFill(*q, buffer, maxLen);
+        });
+    response->addHeader("Cache-Control", "no-store");
+    request->send(response);
 }
 
-// ========== СИСТЕМА ТРЕВОГ ==========
-void checkSystemAlerts() {
-    // Проверяем SD карту (только при ошибках)
-    if (!sdInitialized && !systemAlert.active) {
-        showAlert("SD NET");
-    }
+HistoryQuery::~HistoryQuery() {
+    if (file) sdClose(file);
+}
+
+// Заполняет очередной кусок ответа; 0 - ответ закончен
+size_t historyFill(HistoryQuery &q, uint8_t *buffer, size_t maxLen) {
+    size_t len = 0;
     
-    // Проверяем RTC
-    if (!rtcOK && !systemAlert.active) {
-        showAlert("RTC OSHIBKA");
+    if (q.stage == 0) {
+        const TsSeries &series = tsSeries[q.series];
+        int n = snprintf((char *)buffer, maxLen,
+                         "{\"metric\":\"%s\",\"node\":%u,\"from\":%lu,\"to\":%lu,\"step\":%lu,"
+                         "\"source\":\"%s\",\"points\":[",
+                         TS_METRIC_NAMES[series.metric], series.node, (unsigned long)q.from,
+                         (unsigned long)q.to, (unsigned long)q.step, HISTORY_SOURCE_NAMES[q.level]);
+        if (n < 0 || (size_t)n >= maxLen) return 0;
+        q.stage = 1;
+        return n;
     }
     
-    // Если тревога активна больше 5 секунд, но причина устранена
-    if (systemAlert.active && (millis() - systemAlert.startTime > 5000)) {
-        bool reasonExists = false;
+    while (q.stage == 1) {
+        if (q.pendingLen > 0) {
+            if (len + q.pendingLen > maxLen) return len;
+            memcpy(buffer + len, q.pending, q.pendingLen);
+            len += q.pendingLen;
+            q.pendingLen = 0;
+        }
         
-        if (!sdInitialized) reasonExists = true;
-        else if (!rtcOK) reasonExists = true;
-        else if (securityAlarmActive) reasonExists = true;
-        else {
-            for (int i = 0; i < NODE_COUNT; i++) {
-                if (nodeConnectionLost[i] || nodeAlarmState[i]) {
-                    reasonExists = true;
-                    break;
+        // Следующая точка: сырая запись или закрытая корзина усреднения
+        TsRollup point;
+        bool havePoint = false;
+        bool endOfData = false;
+        
+        while (!havePoint && !endOfData) {
+            TsRollup item;
+            if (!historyNextRecord(q, item)) {
+                endOfData = true;
+                continue;
+            }
+            uint32_t t = item.start;
+            if (t < q.from) {
+                continue;
+            } else if (t > q.to) {
+                endOfData = true;           // Записи упорядочены по времени
+            } else if (q.step == 0) {
+                point = item;
+                havePoint = true;
+            } else {
+                uint32_t bucket = t - t % q.step;
+                if (q.bucket.count > 0 && bucket != q.bucket.start) {
+                    point = q.bucket;
+                    havePoint = true;
+                    q.bucket.count = 0;
                 }
+                if (q.bucket.count == 0) q.bucket.start = bucket;
+                tsRollupMerge(q.bucket, item);
             }
         }
         
-        if (!reasonExists) {
-            clearAlert();
+        if (endOfData) {
+            q.stage = 2;
+            if (q.bucket.count > 0) {
+                point = q.bucket;
+                havePoint = true;
+                q.bucket.count = 0;
+            }
+        }
+        
+        if (havePoint) {
+            int n;
+            if (q.step == 0) {
+                n = snprintf(q.pending, sizeof(q.pending), "%s[%lu,%.1f]", q.firstPoint ? "" : ",",
+                             (unsigned long)point.start, point.last);
+            } else {
+                n = snprintf(q.pending, sizeof(q.pending), "%s[%lu,%.1f,%.1f,%.1f]", q.firstPoint ? "" : ",",
+                             (unsigned long)point.start, point.sum / point.count, point.min, point.max);
+            }
+            q.pendingLen = (n > 0 && (size_t)n < sizeof(q.pending)) ? n : 0;
+            q.firstPoint = false;
+            if (len + q.pendingLen > maxLen) return len;
+            memcpy(buffer + len, q.pending, q.pendingLen);
+            len += q.pendingLen;
+            q.pendingLen = 0;
         }
     }
-}
-
-void showAlert(const char* message) {
-    strncpy(systemAlert.message, message, 31);
-    systemAlert.message[31] = '\0';
-    systemAlert.active = true;
-    systemAlert.startTime = millis();
     
-    // Полностью очищаем строку тревог
-    tft.fillRect(0, 19, 160, 12, ST77XX_BLACK);
-    // Выводим сообщение со смещением вправо на две буквы (примерно 18px)
-    tft.setCursor(18, 23);
-    tft.setTextColor(ST77XX_MAGENTA);
-    tft.setTextSize(1);
-    tft.print(systemAlert.message);
-    
-    // Перерисовываем линию (на случай если затерлась)
-    drawSeparatorLine();
+    if (q.stage == 2) {
+        if (q.pendingLen > 0) {
+            if (len + q.pendingLen > maxLen) return len;
+            memcpy(buffer + len, q.pending, q.pendingLen);
+            len += q.pendingLen;
+            q.pendingLen = 0;
+        }
+        if (len + 2 > maxLen) return len;
+        buffer[len++] = ']';
+        buffer[len++] = '}';
+        q.stage = 3;
+        if (q.file) sdClose(q.file);
+    }
+    return len;
 }
 
-void clearAlert() {
-    if (systemAlert.active) {
-        systemAlert.active = false;
-        tft.fillRect(0, 19, 160, 12, ST77XX_BLACK);
-        drawSeparatorLine();
+// Следующая запись как агрегат: минутная запись - агрегат из одного значения
+bool historyNextRecord(HistoryQuery &q, TsRollup &item) {
+    while (true) {
+        if (q.recPos < q.recLen) {
+            if (q.level != HISTORY_RAW) {
+                item = q.rollups[q.recPos++];
+                return true;
+            }
+            const TsRecord &rec = q.recs[q.recPos++];
+            item.start = rec.t;
+            item.count = 0;
+            tsRollupAdd(item, rec.value);
+            return true;
+        }
+        // Блок сжатых суток ищется по индексу, начало блока раньше from пропускаем
+        uint32_t t;
+        float value;
+        while (q.decoder.next(t, value)) {
+            if (t < q.from) continue;
+            item.start = t;
+            item.count = 0;
+            tsRollupAdd(item, value);
+            return true;
+        }
+        sdRun(historyLoadBlock, &q);
+        if (q.recLen == 0 && q.decoder.left() == 0) return false;
     }
 }
 
-// ========== СТРАНИЦЫ ==========
-void displayWeatherPage() {
-    tft.fillRect(0, 30, 160, 130, ST77XX_BLACK);
-    drawTopBar("METEOSTANCIYA");
-    
-    int yPos = 35;
-    
-    tft.setCursor(5, yPos);
-    tft.setTextColor(ST77XX_WHITE);
-    tft.print(rusToEng("Temp: "));
-    tft.setTextColor(ST77XX_YELLOW);
-    tft.print(currentTemp, 1);
-    tft.print("C");
-    
-    tft.setCursor(5, yPos + 15);
-    tft.setTextColor(ST77XX_WHITE);
-    tft.print(rusToEng("Davlenie: "));
-    tft.setTextColor(ST77XX_CYAN);
-    tft.print(currentPressure, 1);
-    tft.print("mm");
-    
-    tft.setCursor(5, yPos + 30);
-    tft.setTextColor(ST77XX_WHITE);
-    tft.print(rusToEng("Vlazhnost: "));
-    tft.setTextColor(ST77XX_GREEN);
-    tft.print(currentHumidity, 0);
-    tft.print("%");
-    
-    tft.setCursor(5, yPos + 45);
-    tft.setTextColor(ST77XX_WHITE);
-    tft.print(rusToEng("Prognoz:"));
-    
-    if (currentPressure > 0) {
-        tft.setCursor(60, yPos + 45);
-        tft.setTextColor(ST77XX_CYAN);
-        tft.print(getWeatherText(weatherIcon));
+// На задаче SD: следующий блок записей, при необходимости - файл следующих суток
+void historyLoadBlock(void *ctx) {
+    HistoryQuery &q = *(HistoryQuery *)ctx;
+    q.recPos = 0;
+    q.recLen = 0;
+    if (q.level != HISTORY_RAW) {
+        historyLoadRollups(q);
+        return;
     }
     
-    tft.setCursor(5, yPos + 65);
-    tft.setTextColor(ST77XX_WHITE);
-    tft.print(rusToEng("Zamorozki: "));
-    tft.setTextColor(ST77XX_YELLOW);
-    tft.print(frostRisk);
-    
-    draw_compass(134, 100, 18, windDirection, windMagnet);
+    while (true) {
+        if (q.file && q.compressed) {
+            TscBlock blk;
+            while (q.block < q.blocks) {
+                uint32_t offset = offsetof(TscHeader, index) + q.block++ * sizeof(TscBlock);
+                if (!q.file.seek(offset) || q.file.read((uint8_t *)&blk, sizeof(blk)) != sizeof(blk)) break;
+                if (tscReadBlock(q.file, blk, q.packed, q.decoder)) return;
+            }
+            q.file.close();
+            q.file = File();
+        }
+        if (q.file) {
+            q.recLen = tsReadBlock(q.file, q.pos, q.count, q.recs);
+            if (q.recLen > 0) {
+                q.pos += q.recLen;
+                return;
+            }
+            q.file.close();
+            q.file = File();
+        }
+        if (q.nextDay > q.to / 86400 || q.missing >= HISTORY_MAX_MISSING) return;
+        
+        char path[40];
+        uint32_t dayStart = q.nextDay++ * 86400UL;
+        tsSeriesPath(path, sizeof(path), tsSeries[q.series], dayStart);
+        q.compressed = !SD.exists(path);
+        if (q.compressed) {
+            tsSeriesPath(path, sizeof(path), tsSeries[q.series], dayStart, "tsc");
+            if (!SD.exists(path)) {
+                q.missing++;
+                continue;
+            }
+            TscHeader hdr;
+            q.file = SD.open(path, FILE_READ);
+            if (!q.file || !tscReadHeader(q.file, hdr)) {
+                q.file = File();
+                continue;
+            }
+            q.blocks = hdr.blocks;
+            q.block = tscFindBlock(hdr, q.from);
+            q.missing = 0;
+            continue;
+        }
+        
+        TsHeader hdr;
+        uint16_t lastSlot;
+        q.file = SD.open(path, FILE_READ);
+        if (!q.file || !tsReadHeader(q.file, hdr)) {
+            q.file = File();
+            continue;
+        }
+        q.count = tsCountRecords(q.file, hdr, &lastSlot);
+        q.pos = tsLowerBound(q.file, hdr, q.count, q.from);
+        q.missing = 0;
+    }
 }
 
-void displayNodePage() {
-    tft.fillRect(0, 30, 160, 130, ST77XX_BLACK);
-    
-    NodeDisplayData &node = nodeDisplayData[displayNodeIndex];
-    char title[20];
-    sprintf(title, "UZEL #%d", node.id);
-    drawTopBar(title);
-    
-    int yOffset = 35;
-    
-    tft.setCursor(5, yOffset);
-    tft.setTextColor(node.connected ? ST77XX_WHITE : ST77XX_BLUE);
-    tft.print(rusToEng("Temp: "));
-    tft.setTextColor(ST77XX_YELLOW);
-    tft.print(node.temp, 1);
-    tft.print("C");
-    
-    tft.setCursor(5, yOffset + 12);
-    tft.setTextColor(ST77XX_WHITE);
-    tft.print(rusToEng("Vlazhn: "));
-    tft.setTextColor(ST77XX_GREEN);
-    tft.print(node.hum, 0);
-    tft.print("%");
-    
-    tft.setCursor(5, yOffset + 24);
-    tft.setTextColor(ST77XX_WHITE);
-    tft.print(rusToEng("Davlenie: "));
-    tft.setTextColor(ST77XX_CYAN);
-    tft.print(node.press, 1);
-    tft.print("mm");
-    
-    tft.setCursor(5, yOffset + 36);
-    tft.setTextColor(ST77XX_WHITE);
-    tft.print("LED: ");
-    if (node.led_state) {
-        tft.setTextColor(ST77XX_BLUE);
-        tft.print("ON");
-    } else {
-        tft.setTextColor(ST77XX_GREEN);
-        tft.print("OFF");
-    }
-    
-    if (node.id == 102) {
-        tft.setCursor(5, yOffset + 48);
-        tft.setTextColor(ST77XX_WHITE);
-        tft.print(rusToEng("Konts1: "));
-        tft.setTextColor(node.contact1 ? ST77XX_BLUE : ST77XX_GREEN);
-        tft.print(node.contact1 ? "RAZOMKNUT" : "ZAMKNUT");
+// На задаче SD: следующие непустые слоты агрегатов, файл за файлом (месяц или год)
+void historyLoadRollups(HistoryQuery &q) {
+    uint32_t unit = TS_ROLLUP_SECONDS[q.level];
+    while (true) {
+        if (q.file) {
+            while (q.pos < q.count) {
+                uint16_t n = tsRollupRead(q.file, q.pos, q.count, q.rollups);
+                if (n == 0) break;
+                q.pos += n;
+                for (uint16_t i = 0; i < n; i++) {
+                    if (q.rollups[i].count > 0) q.rollups[q.recLen++] = q.rollups[i];
+                }
+                if (q.recLen > 0) return;
+            }
+            q.file.close();
+            q.file = File();
+        }
+        if (q.nextDay > q.to / 86400 || q.missing >= HISTORY_MAX_MISSING) return;
         
-        tft.setCursor(5, yOffset + 60);
-        tft.setTextColor(ST77XX_WHITE);
-        tft.print(rusToEng("Konts2: "));
-        tft.setTextColor(node.contact2 ? ST77XX_BLUE : ST77XX_GREEN);
-        tft.print(node.contact2 ? "RAZOMKNUT" : "ZAMKNUT");
+        uint16_t slots;
+        uint32_t next;
+        uint32_t period = tsRollupPeriod(q.level, q.nextDay * 86400UL, &slots, &next);
+        q.nextDay = next / 86400;
         
-        tft.setCursor(5, yOffset + 72);
-        tft.setTextColor(ST77XX_WHITE);
-        tft.print(rusToEng("Magnit: "));
-        if (node.magnet) {
-            tft.setTextColor(ST77XX_GREEN);
-            tft.print("OK");
-        } else {
-            tft.setTextColor(ST77XX_BLUE);
-            tft.print("---");
+        char path[40];
+        TsRollupHeader hdr;
+        tsRollupPath(path, sizeof(path), tsSeries[q.series], q.level, period);
+        if (!SD.exists(path)) {
+            q.missing++;
+            continue;
         }
+        q.file = SD.open(path, FILE_READ);
+        if (!q.file || !tsRollupReadHeader(q.file, hdr)) {
+            q.file = File();
+            continue;
+        }
+        q.missing = 0;
+        q.pos = q.from > period ? (q.from - period) / unit : 0;
+        uint32_t end = (q.to - period) / unit + 1;
+        q.count = end < hdr.slots ? end : hdr.slots;
     }
-    
-    tft.fillRect(0, 150, 160, 10, ST77XX_GREEN);
-    tft.setCursor(50, 152);
-    tft.setTextColor(ST77XX_WHITE);
-    tft.print(rusToEng("UZEL "));
-    tft.print(displayNodeIndex + 1);
-    tft.print("/4");
 }
 
-void displayGreenhousePage() {
-    tft.fillRect(0, 30, 160, 130, ST77XX_BLACK);
-    drawTopBar("TEPLITSA");
-    
-    int yPos = 35;
-    
-    tft.setCursor(5, yPos);
-    tft.setTextColor(ST77XX_WHITE);
-    tft.print(rusToEng("Temp in: "));
-    tft.setTextColor(ST77XX_YELLOW);
-    tft.print(greenhouseDisplay.temp_in, 1);
-    tft.print("C");
-    
-    tft.setCursor(5, yPos + 15);
-    tft.setTextColor(ST77XX_WHITE);
-    tft.print(rusToEng("Temp out: "));
-    tft.setTextColor(ST77XX_CYAN);
-    tft.print(greenhouseDisplay.temp_out, 1);
-    tft.print("C");
-    
-    tft.setCursor(5, yPos + 30);
-    tft.setTextColor(ST77XX_WHITE);
-    tft.print(rusToEng("Hum in: "));
-    tft.setTextColor(ST77XX_GREEN);
-    tft.print(greenhouseDisplay.hum_in);
-    tft.print("%");
-    
-    tft.setCursor(5, yPos + 50);
-    tft.setTextColor(ST77XX_WHITE);
-    tft.print(rusToEng("Relay 1: "));
-    tft.fillCircle(60, yPos + 53, 4, greenhouseDisplay.relay1 ? ST77XX_GREEN : ST77XX_BLUE);
-    
-    tft.setCursor(90, yPos + 50);
-    tft.print(rusToEng("Relay 2: "));
-    tft.fillCircle(145, yPos + 53, 4, greenhouseDisplay.relay2 ? ST77XX_GREEN : ST77XX_BLUE);
-    
-    tft.fillRect(0, 150, 160, 10, ST77XX_GREEN);
-    tft.setCursor(50, 152);
-    tft.setTextColor(ST77XX_WHITE);
-    tft.print(rusToEng("TEPLITSA"));
+// ========== ВРЕМЕННЫЕ РЯДЫ ==========
+
+void tsInitSeries() {
+    int n = 0;
+    for (int i = 0; i < NODE_COUNT; i++) {
+        const TsMetric metrics[] = {TS_TEMP, TS_HUM, TS_PRESS};
+        for (int m = 0; m < 3; m++) {
+            tsSeries[n].node = nodeNumbers[i];
+            tsSeries[n++].metric = metrics[m];
+        }
+    }
+    const TsMetric greenhouseMetrics[] = {TS_TEMP, TS_TEMP_OUT, TS_HUM};
+    for (int m = 0; m < 3; m++) {
+        tsSeries[n].node = TS_NODE_GREENHOUSE;
+        tsSeries[n++].metric = greenhouseMetrics[m];
+    }
+    for (int i = 0; i < TS_SERIES_COUNT; i++) {
+        memset(&tsSeries[i].minute, 0, sizeof(TsRollup));
+        memset(tsSeries[i].rollups, 0, sizeof(tsSeries[i].rollups));
+        tsSeries[i].cursor.dayStart = 0;
+    }
 }
 
-void displaySDPage() {
-    tft.fillRect(0, 30, 160, 130, ST77XX_BLACK);
-    drawTopBar("SD KARTA");
-    
-    int yPos = 35;
-    
-    if (!sdInitialized) {
-        tft.setCursor(5, yPos);
-        tft.setTextColor(ST77XX_BLUE);
-        tft.print(rusToEng("OSHI BKA: "));
-        tft.print(sdErrorMsg);
+int tsFindSeries(uint16_t node, uint8_t metric) {
+    for (int i = 0; i < TS_SERIES_COUNT; i++) {
+        if (tsSeries[i].node == node && tsSeries[i].metric == metric) return i;
+    }
+    return -1;
+}
+
+// Вызывается из обработчиков ESP-NOW
+void tsAddSample(uint16_t node, TsMetric metric, float value) {
+    if (isnan(value)) return;
+    int i = tsFindSeries(node, metric);
+    if (i < 0) return;
+    portENTER_CRITICAL(&tsMux);
+    tsRollupAdd(tsSeries[i].minute, value);
+    portEXIT_CRITICAL(&tsMux);
+}
+
+// Из loop(): раз в минуту собирает средние и передаёт их задаче SD
+void tsService(uint32_t now) {
+    if (!sdTaskHandle || !rtcOK || now - lastTsSample < TS_SAMPLE_INTERVAL_MS) return;
+    lastTsSample = now;
+    if (tsBatch.busy) {
+        tsDropped++;        // Накопления не сбрасываем - войдут в следующий пакет
         return;
     }
     
-    updateSDInfo();
-    
-    tft.setCursor(5, yPos);
-    tft.setTextColor(ST77XX_CYAN);
-    tft.print(rusToEng("Tip: "));
-    tft.setTextColor(ST77XX_WHITE);
-    if (sdCardType == CARD_MMC) tft.print("MMC");
-    else if (sdCardType == CARD_SD) tft.print("SDSC");
-    else if (sdCardType == CARD_SDHC) tft.print("SDHC");
-    else tft.print("UNKNOWN");
-    
-    tft.setCursor(5, yPos + 12);
-    tft.setTextColor(ST77XX_CYAN);
-    tft.print(rusToEng("Razmer: "));
-    tft.setTextColor(ST77XX_WHITE);
-    tft.print(sdTotalBytes);
-    tft.print(" MB");
-    
-    tft.setCursor(5, yPos + 24);
-    tft.setTextColor(ST77XX_CYAN);
-    tft.print(rusToEng("Zanyato: "));
-    tft.setTextColor(ST77XX_YELLOW);
-    tft.print(sdUsedBytes);
-    tft.print(" MB");
-    
-    tft.setCursor(5, yPos + 36);
-    tft.setTextColor(ST77XX_CYAN);
-    tft.print(rusToEng("Svobodno: "));
-    tft.setTextColor(ST77XX_GREEN);
-    tft.print(sdTotalBytes - sdUsedBytes);
-    tft.print(" MB");
-    
-    tft.setCursor(5, yPos + 54);
-    tft.setTextColor(ST77XX_CYAN);
-    tft.print(rusToEng("Zapisey: "));
-    tft.setTextColor(ST77XX_WHITE);
-    tft.print(sdWriteCount);
+    uint32_t t = lastRTCRead.unixtime();
+    uint32_t checkpointSlot = t / (60 * TS_ROLLUP_CHECKPOINT_MIN);
+    bool checkpoint = checkpointSlot != tsCheckpointSlot;
+    tsCheckpointSlot = checkpointSlot;
+    tsBatch.t = t;
+    tsBatch.count = 0;
+    tsBatch.rollupCount = 0;
+    for (int i = 0; i < TS_SERIES_COUNT; i++) {
+        TsSeries &series = tsSeries[i];
+        portENTER_CRITICAL(&tsMux);
+        TsRollup minute = series.minute;
+        series.minute.count = 0;
+        portEXIT_CRITICAL(&tsMux);
+        if (minute.count > 0) {
+            tsBatch.series[tsBatch.count] = i;
+            tsBatch.values[tsBatch.count++] = minute.sum / minute.count;
+        }
+        
+        // Минута вливается в час и сутки; закрытый интервал уходит на SD
+        for (uint8_t level = 0; level < TS_ROLLUP_LEVELS; level++) {
+            TsRollup &r = series.rollups[level];
+            uint32_t start = t - t % TS_ROLLUP_SECONDS[level];
+            bool closed = r.count > 0 && r.start != start;
+            if (closed || (checkpoint && r.count > 0 && minute.count > 0)) {
+                TsBatchRollup &out = tsBatch.rollups[tsBatch.rollupCount++];
+                out.series = i;
+                out.level = level;
+                out.rollup = r;
+            }
+            if (closed) r.count = 0;
+            if (r.count == 0) r.start = start;
+            tsRollupMerge(r, minute);
+        }
+    }
+    if (tsBatch.count == 0 && tsBatch.rollupCount == 0) return;
     
-    tft.setCursor(5, yPos + 69);
-    tft.setTextColor(ST77XX_CYAN);
-    tft.print(rusToEng("Fayl: "));
-    tft.setTextColor(ST77XX_WHITE);
-    tft.print("weather.csv");
+    tsBatch.busy = true;
+    if (!sdPost(tsWriteBatch, &tsBatch)) {
+        tsBatch.busy = false;
+        tsDropped++;
+    }
+}
+
+void tsSeriesPath(char *out, size_t size, const TsSeries &series, uint32_t dayStart, const char *ext) {
+    DateTime d(dayStart);
+    char name[8];
+    if (series.node == TS_NODE_GREENHOUSE) strcpy(name, "gh");
+    else snprintf(name, sizeof(name), "%u", series.node);
+    snprintf(out, size, TS_DIR "/%s_%s/%04d%02d%02d.%s", name, TS_METRIC_NAMES[series.metric],
+             d.year(), d.month(), d.day(), ext);
 }
 
-void draw_compass(int cx, int cy, int r, float angle, bool magnet) {
-    tft.fillCircle(cx, cy, r, ST77XX_WHITE);
-    tft.drawCircle(cx, cy, r, ST77XX_BLACK);
+// На задаче SD: открывает файл суток ряда для дописывания, создавая его при необходимости
+bool tsOpenDay(TsSeries &series, uint32_t dayStart, File &file) {
+    char path[40];
+    tsSeriesPath(path, sizeof(path), series, dayStart);
     
-    if (!magnet) {
-        tft.drawLine(cx - r, cy - r, cx + r, cy + r, ST77XX_BLUE);
-        tft.drawLine(cx - r, cy + r, cx + r, cy - r, ST77XX_BLUE);
-        tft.setCursor(cx - 8, cy - 3);
-        tft.setTextColor(ST77XX_BLUE);
-        tft.print("NO");
-        return;
+    if (SD.exists(path)) {
+        file = SD.open(path, "r+");
+        if (!file) return false;
+        if (series.cursor.dayStart != dayStart) {
+            TsHeader hdr;
+            if (!tsReadHeader(file, hdr)) return false;
+            series.cursor.dayStart = dayStart;
+            series.cursor.count = tsCountRecords(file, hdr, &series.cursor.lastSlot);
+        }
+        return true;
     }
     
-    tft.setTextColor(ST77XX_BLUE);
-    tft.setCursor(cx - 2, cy - r + 2);
-    tft.print("N");
-    tft.setCursor(cx + r - 8, cy - 3);
-    tft.print("E");
-    tft.setCursor(cx - 2, cy + r - 8);
-    tft.print("S");
-    tft.setCursor(cx - r + 2, cy - 3);
-    tft.print("W");
-    
-    float arrow_rad = radians(angle - 90);
-    int x_end = cx + (r-4) * cos(arrow_rad);
-    int y_end = cy + (r-4) * sin(arrow_rad);
-    tft.drawLine(cx, cy, x_end, y_end, ST77XX_BLACK);
-    tft.fillCircle(cx, cy, 2, ST77XX_BLUE);
+    if (!tsEnsureDir(path)) return false;
+    file = SD.open(path, "w+");
+    if (!file || !tsCreateDay(file, series.node, series.metric, dayStart)) return false;
+    series.cursor.dayStart = dayStart;
+    series.cursor.count = 0;
+    series.cursor.lastSlot = TS_NO_RECORD;
+    return true;
 }
 
-// ========== КНОПКИ И ЗВУК ==========
-void handleButtons() {
+// На задаче SD: дописывает пакет средних во все ряды
+void tsWriteBatch(void *ctx) {
+    TsBatch &batch = *(TsBatch *)ctx;
+    uint32_t dayStart = batch.t - batch.t % 86400;
+    TsRecord rec = {batch.t, 0};
+    
+    for (uint8_t i = 0; i < batch.count; i++) {
+        TsSeries &series = tsSeries[batch.series[i]];
+        File file;
+        rec.value = batch.values[i];
+        if (!tsOpenDay(series, dayStart, file) || !tsAppend(file, series.cursor, rec)) {
+            series.cursor.dayStart = 0;     // При следующей записи перечитать заголовок
+            sdWriteFailed = true;
+        }
+        if (file) file.close();
+    }
+    for (uint8_t i = 0; i < batch.rollupCount; i++) {
+        const TsBatchRollup &r = batch.rollups[i];
+        if (!tsRollupStore(tsSeries[r.series], r.level, r.rollup)) sdWriteFailed = true;
+    }
+    batch.busy = false;
+}
+
+// Создаёт каталоги ряда для файла path
+bool tsEnsureDir(const char *path) {
+    if (!SD.exists(TS_DIR)) SD.mkdir(TS_DIR);
+    char dir[24];
+    size_t dirLen = strrchr(path, '/') - path;
+    if (dirLen >= sizeof(dir)) return false;
+    memcpy(dir, path, dirLen);
+    dir[dirLen] = '\0';
+    if (!SD.exists(dir)) SD.mkdir(dir);
+    return true;
+}
+
+// Файл агрегатов, в который попадает t: начало периода, число слотов и начало следующего
+uint32_t tsRollupPeriod(uint8_t level, uint32_t t, uint16_t *slots, uint32_t *next) {
+    DateTime d(t);
+    if (level == TS_ROLLUP_HOUR) {
+        *slots = 31 * 24;
+        *next = (d.month() == 12 ? DateTime(d.year() + 1, 1, 1) : DateTime(d.year(), d.month() + 1, 1)).unixtime();
+        return DateTime(d.year(), d.month(), 1).unixtime();
+    }
+    *slots = 366;
+    *next = DateTime(d.year() + 1, 1, 1).unixtime();
+    return DateTime(d.year(), 1, 1).unixtime();
+}
+
+void tsRollupPath(char *out, size_t size, const TsSeries &series, uint8_t level, uint32_t periodStart) {
+    DateTime d(periodStart);
+    char name[8];
+    if (series.node == TS_NODE_GREENHOUSE) strcpy(name, "gh");
+    else snprintf(name, sizeof(name), "%u", series.node);
+    if (level == TS_ROLLUP_HOUR) {
+        snprintf(out, size, TS_DIR "/%s_%s/h%04d%02d.bin", name, TS_METRIC_NAMES[series.metric],
+                 d.year(), d.month());
+    } else {
+        snprintf(out, size, TS_DIR "/%s_%s/d%04d.bin", name, TS_METRIC_NAMES[series.metric], d.year());
+    }
+}
+
+// На задаче SD: пишет агрегат в его слот, создавая файл периода при необходимости
+bool tsRollupStore(const TsSeries &series, uint8_t level, const TsRollup &rollup) {
+    uint16_t slots;
+    uint32_t next;
+    uint32_t period = tsRollupPeriod(level, rollup.start, &slots, &next);
+    char path[40];
+    tsRollupPath(path, sizeof(path), series, level, period);
+    
+    File file;
+    if (SD.exists(path)) {
+        file = SD.open(path, "r+");
+    } else if (tsEnsureDir(path)) {
+        file = SD.open(path, "w+");
+        TsRollupHeader hdr = {TS_ROLLUP_MAGIC, TS_ROLLUP_VERSION, level, series.node,
+                              period, slots, series.metric, 0};
+        if (file && !tsRollupCreate(file, hdr)) {
+            file.close();
+            SD.remove(path);
+            return false;
+        }
+    }
+    if (!file) return false;
+    bool ok = tsRollupWrite(file, (rollup.start - period) / TS_ROLLUP_SECONDS[level], rollup);
+    file.close();
+    return ok;
+}
+
+// При загрузке, до запуска задачи SD: открытые час и сутки продолжаются
+// с последней контрольной точки
+void tsRestoreRollups() {
+    if (!rtcOK) return;
+    uint32_t t = lastRTCUnix;
+    for (int i = 0; i < TS_SERIES_COUNT; i++) {
+        for (uint8_t level = 0; level < TS_ROLLUP_LEVELS; level++) {
+            uint16_t slots;
+            uint32_t next;
+            uint32_t start = t - t % TS_ROLLUP_SECONDS[level];
+            uint32_t period = tsRollupPeriod(level, start, &slots, &next);
+            char path[40];
+            tsRollupPath(path, sizeof(path), tsSeries[i], level, period);
+            if (!SD.exists(path)) continue;
+            
+            File file = SD.open(path, FILE_READ);
+            uint16_t slot = (start - period) / TS_ROLLUP_SECONDS[level];
+            TsRollup r;
+            if (file && tsRollupRead(file, slot, slot + 1, &r) == 1 && r.count > 0 && r.start == start) {
+                tsSeries[i].rollups[level] = r;
+            }
+            if (file) file.close();
+        }
+    }
+}
+
+// Из loop(): раз в сутки запускает проход сжатия, шагами по TS_COMPACT_PERIOD_MS
+void tsCompactService(uint32_t now) {
+    if (!sdTaskHandle || !rtcOK || tsCompact.busy || now - tsCompact.lastRun < TS_COMPACT_PERIOD_MS) return;
+    uint32_t today = lastRTCUnix / 86400;
+    if (today == tsCompact.done) return;
+    tsCompact.lastRun = now;
+    if (today != tsCompact.today) {
+        tsCompact.today = today;
+        tsCompact.series = 0;
+        tsCompact.back = 1;
+    }
+    
+    tsCompact.busy = true;
+    if (!sdPost(tsCompactStep, &tsCompact)) tsCompact.busy = false;
+}
+
+// На задаче SD: ищет следующий несжатый файл прошлых суток и сжимает его
+void tsCompactStep(void *ctx) {
+    TsCompactState &c = *(TsCompactState *)ctx;
+    while (c.series < TS_SERIES_COUNT) {
+        const TsSeries &series = tsSeries[c.series];
+        uint32_t dayStart = (c.today - c.back) * 86400UL;
+        if (++c.back > TS_COMPACT_DAYS) {
+            c.back = 1;
+            c.series++;
+        }
+        if (tsCompactDay(series, dayStart)) break;
+    }
+    if (c.series >= TS_SERIES_COUNT) c.done = c.today;
+    c.busy = false;
+}
+
+// true - файл суток был и на него потрачен шаг (даже если сжать не удалось)
+bool tsCompactDay(const TsSeries &series, uint32_t dayStart) {
+    char src[40], dst[40];
+    tsSeriesPath(src, sizeof(src), series, dayStart);
+    if (!SD.exists(src)) return false;
+    tsSeriesPath(dst, sizeof(dst), series, dayStart, "tsc");
+    
+    File in = SD.open(src, FILE_READ);
+    TsHeader hdr;
+    uint16_t lastSlot;
+    if (!in || !tsReadHeader(in, hdr)) {
+        if (in) in.close();
+        return true;
+    }
+    uint16_t count = tsCountRecords(in, hdr, &lastSlot);
+    
+    File out = SD.open(dst, FILE_WRITE);
+    bool ok = out && tscCompact(in, hdr, count, out);
+    uint32_t outSize = out ? out.size() : 0;
+    in.close();
+    if (out) out.close();
+    
+    if (!ok) {
+        SD.remove(dst);         // Исходник остаётся, следующий проход попробует снова
+        sdWriteFailed = true;
+        return true;
+    }
+    SD.remove(src);
+    tsCompact.files++;
+    tsCompact.bytesIn += TS_FILE_SIZE;
+    tsCompact.bytesOut += outSize;
+    return true;
+}
+
+// ========== ЖУРНАЛ СОБЫТИЙ ==========
+
+// Вызывается из любой задачи: обработчиков ESP-NOW, loop()
+void journalAdd(uint16_t node, JournalEvent type, int32_t value) {
+    uint32_t t = lastRTCUnix;
+    uint32_t ms = millis();
+    
+    portENTER_CRITICAL(&journalMux);
+    journalStats.events++;
+    if (ms / 1000 != journalRateSecond) {
+        journalRateSecond = ms / 1000;
+        journalRateCount = 0;
+    }
+    if (++journalRateCount > journalStats.ratePeak) journalStats.ratePeak = journalRateCount;
+    
+    bool stored = false;
+    if (journalCount > 0) {
+        JournalRecord &last = journalRing[(journalHead + JOURNAL_RING_SIZE - 1) % JOURNAL_RING_SIZE];
+        if (last.node == node && last.type == type && last.value == value &&
+            last.repeat < 255 && t - last.t <= JOURNAL_COALESCE_S) {
+            last.repeat++;
+            journalStats.coalesced++;
+            stored = true;
+        }
+    }
+    if (!stored && journalCount >= JOURNAL_RING_SIZE) {
+        journalStats.dropped++;
+        stored = true;
+    }
+    if (!stored) {
+        if (journalCount == 0) journalOldestMs = ms;
+        JournalRecord &rec = journalRing[journalHead];
+        rec.t = t;
+        rec.node = node;
+        rec.type = type;
+        rec.repeat = 0;
+        rec.value = value;
+        journalHead = (journalHead + 1) % JOURNAL_RING_SIZE;
+        journalCount++;
+        if (journalCount > journalStats.ringPeak) journalStats.ringPeak = journalCount;
+    }
+    portEXIT_CRITICAL(&journalMux);
+}
+
+// Из loop(): групповой коммит, пока предыдущий не записан - события ждут в кольце
+void journalService(uint32_t now) {
+    if (!sdTaskHandle || journalCommit.busy || journalCount == 0) return;
+    if (journalCount < JOURNAL_COMMIT_MAX && now - journalOldestMs < JOURNAL_COMMIT_MS) return;
+    
+    portENTER_CRITICAL(&journalMux);
+    uint16_t n = min(journalCount, (uint16_t)JOURNAL_COMMIT_MAX);
+    uint16_t tail = (journalHead + JOURNAL_RING_SIZE - journalCount) % JOURNAL_RING_SIZE;
+    for (uint16_t i = 0; i < n; i++) {
+        journalCommit.records[i] = journalRing[(tail + i) % JOURNAL_RING_SIZE];
+    }
+    journalCount -= n;
+    if (journalCount > 0) journalOldestMs = now;
+    portEXIT_CRITICAL(&journalMux);
+    
+    journalCommit.count = n;
+    journalCommit.busy = true;
+    if (!sdPost(journalWrite, &journalCommit)) {
+        journalCommit.busy = false;
+        portENTER_CRITICAL(&journalMux);
+        journalStats.dropped += n;
+        portEXIT_CRITICAL(&journalMux);
+    }
+}
+
+// На задаче SD: записи одних суток - одной операцией записи
+void journalWrite(void *ctx) {
+    JournalCommit &commit = *(JournalCommit *)ctx;
+    uint32_t start = micros();
+    bool ok = true;
+    
+    for (uint8_t i = 0; i < commit.count; ) {
+        uint32_t day = commit.records[i].t / 86400;
+        uint8_t n = 1;
+        while (i + n < commit.count && commit.records[i + n].t / 86400 == day) n++;
+        
+        if (!journalFile || day != journalFileDay) {
+            if (journalFile) journalFile.close();
+            if (!SD.exists(JOURNAL_DIR)) SD.mkdir(JOURNAL_DIR);
+            DateTime d(day * 86400UL);
+            char path[32];
+            snprintf(path, sizeof(path), JOURNAL_DIR "/%04d%02d%02d.bin", d.year(), d.month(), d.day());
+            journalFile = SD.open(path, FILE_APPEND);
+            journalFileDay = day;
+            journalFileSize = journalFile ? journalFile.size() : 0;
+            journalSyncBlock = JOURNAL_NO_SYNC;     // Первый кадр после открытия - с маркером
+        }
+        if (!journalFile) {
+            ok = false;
+            i += n;
+            continue;
+        }
+        
+        // Маркер (если нужен), заголовок и записи - одной операцией записи
+        uint8_t buf[sizeof(JournalSync) + JOURNAL_FRAME_MAX];
+        size_t len = 0;
+        if (journalFileSize / JOURNAL_SYNC_INTERVAL != journalSyncBlock) {
+            JournalSync sync = {JOURNAL_SYNC_MAGIC, journalFileSize, commit.records[i].t, 0};
+            sync.crc = crc32_le(0, (const uint8_t *)&sync, offsetof(JournalSync, crc));
+            memcpy(buf, &sync, sizeof(sync));
+            len = sizeof(sync);
+            journalSyncBlock = journalFileSize / JOURNAL_SYNC_INTERVAL;
+        }
+        JournalFrame frame = {JOURNAL_FRAME_MAGIC, (uint16_t)(n * sizeof(JournalRecord)), n, 0};
+        frame.crc = crc32_le(0, (const uint8_t *)&commit.records[i], frame.length);
+        memcpy(buf + len, &frame, sizeof(frame));
+        memcpy(buf + len + sizeof(frame), &commit.records[i], frame.length);
+        len += sizeof(frame) + frame.length;
+        
+        size_t written = journalFile.write(buf, len);
+        journalFileSize += written;
+        if (written != len) ok = false;
+        i += n;
+    }
+    if (journalFile) journalFile.flush();
+    
+    portENTER_CRITICAL(&journalMux);
+    journalStats.commits++;
+    journalStats.records += commit.count;
+    journalStats.writeUs += micros() - start;
+    portEXIT_CRITICAL(&journalMux);
+    
+    if (!ok) sdWriteFailed = true;
+    commit.busy = false;
+}
+
+// ========== ВОССТАНОВЛЕНИЕ ПОСЛЕ СБОЯ ПИТАНИЯ ==========
+// При старте, до запуска задачи SD: в последних файлах журнала и лога
+// проверяется только хвост, повреждённая часть обрезается. Время зависит
+// от размера хвоста, а не файла.
+
+void sdRecoverTails() {
+    uint32_t start = micros();
+    const char *dirs[] = {JOURNAL_DIR, SD_LOG_DIR};
+    
+    for (uint8_t i = 0; i < 2; i++) {
+        char path[40];
+        if (!sdNewestFile(dirs[i], path, sizeof(path))) continue;
+        File file = SD.open(path, FILE_READ);
+        if (!file) continue;
+        uint32_t size = file.size();
+        uint32_t validEnd = (i == 0) ? journalValidEnd(file, size) : sdLogValidEnd(file, size);
+        file.close();
+        
+        if (validEnd < size) {
+            Serial.printf("SD recovery: %s %lu -> %lu\n", path, (unsigned long)size, (unsigned long)validEnd);
+            sdRecoveryCut += size - validEnd;
+            if (!sdTruncate(path, validEnd)) {
+                // Без truncate файл откладывается целиком, новые записи пойдут в чистый
+                char bad[44];
+                snprintf(bad, sizeof(bad), "%s.bad", path);
+                SD.rename(path, bad);
+            }
+        }
+    }
+    
+    sdRecoveryUs = micros() - start;
+    Serial.printf("SD recovery: %lu us, scanned %lu B, cut %lu B\n", (unsigned long)sdRecoveryUs,
+                  (unsigned long)sdRecoveryScanned, (unsigned long)sdRecoveryCut);
+}
+
+// Имена файлов суток - YYYYMMDD, поэтому последний - наибольший по имени
+bool sdNewestFile(const char *dir, char *out, size_t size) {
+    File root = SD.open(dir);
+    if (!root || !root.isDirectory()) return false;
+    
+    char best[16] = "";
+    for (File entry = root.openNextFile(); entry; entry = root.openNextFile()) {
+        const char *name = entry.name();
+        const char *slash = strrchr(name, '/');
+        if (slash) name = slash + 1;
+        if (!entry.isDirectory() && strlen(name) < sizeof(best) && strcmp(name, best) > 0) {
+            strcpy(best, name);
+        }
+    }
+    root.close();
+    if (best[0] == '\0') return false;
+    snprintf(out, size, "%s/%s", dir, best);
+    return true;
+}
+
+// Arduino File не умеет укорачиваться - через VFS по пути с точкой монтирования
+bool sdTruncate(const char *path, uint32_t length) {
+    char full[48];
+    snprintf(full, sizeof(full), "/sd%s", path);
+    return truncate(full, length) == 0;
+}
+
+bool sdReadAt(File &file, uint32_t pos, void *buf, uint32_t len) {
+    return file.seek(pos) && file.read((uint8_t *)buf, len) == len;
+}
+
+// Ищет маркер синхронизации начиная с интервала, в котором лежит from, и ниже.
+// Маркера нет - *pos = JOURNAL_NO_SYNC; false - ошибка чтения
+bool journalFindSync(File &file, uint32_t from, uint32_t size, uint32_t *pos) {
+    uint8_t window[sizeof(JournalSync) + JOURNAL_FRAME_MAX + sizeof(JournalSync)];
+    for (int32_t block = from / JOURNAL_SYNC_INTERVAL; block >= 0; block--) {
+        uint32_t start = block * JOURNAL_SYNC_INTERVAL;
+        if (start >= size) continue;
+        // Маркер пишется первым после перехода границы - не дальше одного кадра от неё
+        uint32_t len = min((uint32_t)sizeof(window), size - start);
+        if (!sdReadAt(file, start, window, len)) return false;
+        sdRecoveryScanned += len;
+        
+        for (uint32_t off = 0; off + sizeof(JournalSync) <= len; off += 4) {
+            JournalSync sync;
+            memcpy(&sync, window + off, sizeof(sync));
+            if (sync.magic == JOURNAL_SYNC_MAGIC && sync.offset == start + off &&
+                sync.crc == crc32_le(0, (const uint8_t *)&sync, offsetof(JournalSync, crc))) {
+                *pos = start + off;
+                return true;
+            }
+        }
+    }
+    *pos = JOURNAL_NO_SYNC;
+    return true;
+}
+
+// Конец последнего целого кадра: от последнего маркера вперёд по кадрам.
+// Обрезается только хвост за найденным маркером; ошибка чтения или файл
+// без маркеров - файл не трогается
+uint32_t journalValidEnd(File &file, uint32_t size) {
+    uint32_t pos;
+    if (size == 0 || !journalFindSync(file, size - 1, size, &pos) || pos == JOURNAL_NO_SYNC) return size;
+    
+    uint8_t payload[JOURNAL_COMMIT_MAX * sizeof(JournalRecord)];
+    while (pos < size) {
+        uint32_t magic;
+        if (size - pos < sizeof(magic)) break;
+        if (!sdReadAt(file, pos, &magic, sizeof(magic))) return size;
+        
+        if (magic == JOURNAL_SYNC_MAGIC) {
+            JournalSync sync;
+            if (size - pos < sizeof(sync)) break;
+            if (!sdReadAt(file, pos, &sync, sizeof(sync))) return size;
+            if (sync.offset != pos || sync.crc != crc32_le(0, (const uint8_t *)&sync, offsetof(JournalSync, crc))) break;
+            sdRecoveryScanned += sizeof(sync);
+            pos += sizeof(sync);
+        } else if (magic == JOURNAL_FRAME_MAGIC) {
+            JournalFrame frame;
+            if (size - pos < sizeof(frame)) break;
+            if (!sdReadAt(file, pos, &frame, sizeof(frame))) return size;
+            if (frame.length != frame.count * sizeof(JournalRecord) || frame.length > sizeof(payload) ||
+                size - pos - sizeof(frame) < frame.length) break;
+            if (file.read(payload, frame.length) != frame.length) return size;
+            if (crc32_le(0, payload, frame.length) != frame.crc) break;
+            sdRecoveryScanned += sizeof(frame) + frame.length;
+            pos += sizeof(frame) + frame.length;
+        } else {
+            break;
+        }
+    }
+    return pos;
+}
+
+// Строка лога без '\n'. С CRC: "...,xxxxxxxx" - CRC32 всего до последней
+// запятой; без CRC (файл прошлой прошивки) - лишь бы без нулевых байт
+bool sdLogLineValid(const char *line, uint16_t len, bool crc) {
+    if (len == 0 || memchr(line, 0, len)) return false;
+    if (!crc) return true;
+    if (len < 10 || line[len - 9] != ',') return false;
+    char hex[9];
+    memcpy(hex, line + len - 8, 8);
+    hex[8] = '\0';
+    char *end;
+    uint32_t sum = strtoul(hex, &end, 16);
+    return end == hex + 8 && sum == crc32_le(0, (const uint8_t *)line, len - 9);
+}
+
+// Лог CSV: с конца, блоками, отбрасываются нули недописанных кластеров,
+// обрывок строки и строки с неверной CRC32 - до первой целой строки. Окно -
+// SD_LOG_RECOVER_SCAN; целой строки в нём нет - файл не трогается (кроме
+// случая, когда окно дошло до заголовка). Ошибка чтения - тоже не трогается
+uint32_t sdLogValidEnd(File &file, uint32_t size) {
+    char buf[SD_LOG_BLOCK_SIZE];
+    uint32_t n = min(size, (uint32_t)sizeof(buf));
+    if (!sdReadAt(file, 0, buf, n)) return size;
+    uint32_t headerLen = strlen(SD_LOG_HEADER);
+    bool crc = n >= headerLen && memcmp(buf, SD_LOG_HEADER, headerLen) == 0;
+    if (!crc) {
+        headerLen = strlen(SD_LOG_HEADER_V1);
+        if (n < headerLen || memcmp(buf, SD_LOG_HEADER_V1, headerLen) != 0) {
+            // Оборван сам заголовок - файл как новый; чужой файл не трогаем
+            return n < strlen(SD_LOG_HEADER) && memcmp(buf, SD_LOG_HEADER, n) == 0 ? 0 : size;
+        }
+    }
+    
+    uint32_t limit = max(headerLen, size > SD_LOG_RECOVER_SCAN ? size - SD_LOG_RECOVER_SCAN : 0);
+    uint32_t end = size;        // Всё после end уже отброшено
+    while (end > limit) {
+        uint32_t start = end - limit > sizeof(buf) ? end - sizeof(buf) : limit;
+        uint32_t len = end - start;
+        if (!sdReadAt(file, start, buf, len)) return size;
+        sdRecoveryScanned += len;
+        
+        int32_t nl = len - 1;
+        while (nl >= 0 && buf[nl] != '\n') nl--;
+        if (nl < 0) {                           // Ни одного конца строки - нули или мусор
+            end = start;
+            continue;
+        }
+        int32_t begin = nl - 1;
+        while (begin >= 0 && buf[begin] != '\n') begin--;
+        if (begin < 0 && start > limit) {
+            // Начало строки - в предыдущем блоке: блок заново, концом на этой строке.
+            // Строка длиннее блока - мусор
+            end = (uint32_t)nl + 1 < len ? start + nl + 1 : start;
+            continue;
+        }
+        if (sdLogLineValid(buf + begin + 1, nl - begin - 1, crc)) return start + nl + 1;
+        end = start + begin + 1;
+    }
+    return limit == headerLen ? headerLen : size;
+}
+
+// ========== СНИМОК СОСТОЯНИЯ ==========
+
+// Из loop(): раз в STATE_INTERVAL_MS копирует состояние и отдаёт задаче SD
+void stateService(uint32_t now) {
+    if (!sdTaskHandle || !rtcOK || stateJob.busy || now - lastStateWrite < STATE_INTERVAL_MS) return;
+    lastStateWrite = now;
+    
+    StateSnapshot &snap = stateJob.snap;
+    memset(&snap, 0, sizeof(snap));
+    snap.magic = STATE_MAGIC;
+    snap.size = sizeof(StateSnapshot);
+    snap.seq = ++stateSeq;
+    snap.t = lastRTCUnix;
+    memcpy(snap.nodes, nodeDisplayData, sizeof(snap.nodes));
+    snap.greenhouse = greenhouseDisplay;
+    snap.currentPressure = currentPressure;
+    snap.currentTemp = currentTemp;
+    snap.currentHumidity = currentHumidity;
+    snap.pressureTrend3h = pressureTrend3h;
+    snap.pressureTrend6h = pressureTrend6h;
+    snap.pressureTrend12h = pressureTrend12h;
+    snap.windDirection = windDirection;
+    snap.windCurrentSector = windCurrentSector;
+    snap.crc = crc32_le(0, (const uint8_t *)&snap, offsetof(StateSnapshot, crc));
+    
+    stateJob.busy = true;
+    if (!sdPost(stateWrite, &stateJob)) stateJob.busy = false;
+}
+
+// На задаче SD: слот по чётности номера, файл создаётся сразу на два слота
+void stateWrite(void *ctx) {
+    StateWriteJob &job = *(StateWriteJob *)ctx;
+    File file = SD.exists(STATE_PATH) ? SD.open(STATE_PATH, "r+") : SD.open(STATE_PATH, "w+");
+    bool ok = false;
+    if (file) {
+        uint8_t slot[STATE_SLOT_SIZE];
+        memset(slot, 0, sizeof(slot));
+        memcpy(slot, &job.snap, sizeof(job.snap));
+        ok = file.seek((job.snap.seq & 1) * STATE_SLOT_SIZE) &&
+             file.write(slot, sizeof(slot)) == sizeof(slot);
+        file.close();
+    }
+    if (!ok) sdWriteFailed = true;
+    job.busy = false;
+}
+
+// На задаче SD: в ctx - новейший целый снимок из двух слотов (magic == 0 - нет)
+void stateLoad(void *ctx) {
+    StateSnapshot &best = *(StateSnapshot *)ctx;
+    memset(&best, 0, sizeof(best));
+    if (!SD.exists(STATE_PATH)) return;
+    File file = SD.open(STATE_PATH, FILE_READ);
+    if (!file) return;
+    for (uint8_t i = 0; i < 2; i++) {
+        StateSnapshot snap;
+        if (!file.seek(i * STATE_SLOT_SIZE) || file.read((uint8_t *)&snap, sizeof(snap)) != sizeof(snap)) continue;
+        if (snap.magic != STATE_MAGIC || snap.size != sizeof(StateSnapshot) ||
+            snap.crc != crc32_le(0, (const uint8_t *)&snap, offsetof(StateSnapshot, crc))) continue;
+        if (best.magic == 0 || snap.seq > best.seq) best = snap;
+    }
+    file.close();
+}
+
+// При загрузке: таблица узлов и тренды - из снимка, история давления - из
+// хранилища рядов. Читается только хвост: снимок и последние сутки ряда давления.
+void warmRestore() {
+    if (!sdInitialized || !rtcOK) return;
+    uint32_t start = micros();
+    uint32_t nowUnix = lastRTCUnix;
+    
+    StateSnapshot snap;
+    sdRun(stateLoad, &snap);
+    if (snap.magic == STATE_MAGIC && snap.t <= nowUnix && nowUnix - snap.t < STATE_MAX_AGE_S) {
+        stateSeq = snap.seq;
+        uint32_t age = nowUnix - snap.t;
+        // Значения - последние известные; связь и тревоги узлы подтвердят сами
+        memcpy(nodeDisplayData, snap.nodes, sizeof(snap.nodes));
+        for (int i = 0; i < NODE_COUNT_DISP; i++) {
+            nodeDisplayData[i].connected = false;
+            nodeDisplayData[i].alarm = false;
+        }
+        greenhouseDisplay = snap.greenhouse;
+        currentPressure = snap.currentPressure;
+        currentTemp = snap.currentTemp;
+        currentHumidity = snap.currentHumidity;
+        pressureTrend3h = snap.pressureTrend3h;
+        pressureTrend6h = snap.pressureTrend6h;
+        pressureTrend12h = snap.pressureTrend12h;
+        windDirection = snap.windDirection;
+        windCurrentSector = snap.windCurrentSector;
+        // Порывы - только из окон движка: после перезагрузки они пусты
+        warmRestoreStats.snapshotAge = age;
+    } else if (snap.magic == STATE_MAGIC) {
+        stateSeq = snap.seq;    // Нумерацию продолжаем, чтобы не писать в слот новейшего
+    }
+    
+    warmRestoreStats.points = warmRestorePressure(nowUnix);
+    if (warmRestoreStats.points > 0) {
+        calculatePressureTrends();
+        weatherSparkSync();
+        lastForecastUpdate = millis() - FORECAST_UPDATE_INTERVAL - 1;   // Прогноз - по первым данным
+    }
+    
+    warmRestoreStats.us = micros() - start;
+    Serial.printf("Warm restore: %lu us, snapshot age %ld s, pressure points %u\n",
+                  (unsigned long)warmRestoreStats.us, (long)warmRestoreStats.snapshotAge,
+                  warmRestoreStats.points);
+}
+
+// Минутные средние давления узла 102 за глубину истории (24 ч) - в pressureHistory.
+// Чтение тем же путём, что и /api/history: поиск по индексу суток, затем блоки.
+uint16_t warmRestorePressure(uint32_t nowUnix) {
+    int series = tsFindSeries(102, TS_PRESS);
+    if (series < 0) return 0;
+    
+    std::unique_ptr<HistoryQuery> q(new HistoryQuery());
+    q->series = series;
+    q->level = HISTORY_RAW;
+    q->to = nowUnix;
+    q->from = nowUnix - PH_COARSE_SIZE * PH_COARSE_SECONDS;
+    q->nextDay = q->from / 86400;
+    
+    uint16_t points = 0;
+    TsRollup item;
+    while (historyNextRecord(*q, item) && item.start <= nowUnix) {
+        pressureHistory.add(item.start, item.last);
+        currentPressure = item.last;
+        points++;
+    }
+    return points;
+}
+
+// ========== ПРАВИЛА ТРЕВОГ ==========
+
+// При загрузке: правила с SD, без файла - встроенные
+void rulesLoad() {
+    ruleEngine.begin();
+    rulesJob.count = 0;
+    if (sdInitialized) sdRun(rulesRead, &rulesJob);
+    for (uint8_t i = 0; i < rulesJob.count; i++) ruleEngine.set(rulesJob.configs[i]);
+    if (rulesJob.count == 0) rulesDefaults();
+    ruleEngine.compile();
+    Serial.printf("Правила: %u (%s)\n", ruleEngine.count(), rulesJob.count ? "SD" : "по умолчанию");
+}
+
+// Резкое падение давления (около 3 гПа за 3 ч) и поворот ветра на 45° за 10 минут
+void rulesDefaults() {
+    ruleEngine.set(RuleConfig{(uint16_t)nodeNumbers[0], RM_PRESS, RULE_FALL, 2.0, 0.5, 10800, 1, 0});
+    ruleEngine.set(RuleConfig{(uint16_t)nodeNumbers[0], RM_WIND, RULE_SHIFT, 45.0, 10.0, 600, 1, 0});
+}
+
+// На задаче SD: rules.bin, а если запись оборвалась между удалением и переименованием - rules.tmp
+void rulesRead(void *ctx) {
+    RulesJob &job = *(RulesJob *)ctx;
+    job.count = 0;
+    const char *paths[2] = {RULES_PATH, RULES_TMP_PATH};
+    for (uint8_t p = 0; p < 2 && job.count == 0; p++) {
+        if (!SD.exists(paths[p])) continue;
+        File file = SD.open(paths[p], FILE_READ);
+        if (!file) continue;
+        RulesFileHeader hdr;
+        if (file.read((uint8_t *)&hdr, sizeof(hdr)) == sizeof(hdr) && hdr.magic == RULES_MAGIC &&
+            hdr.size == sizeof(RuleConfig) && hdr.count <= RULES_MAX) {
+            size_t bytes = hdr.count * sizeof(RuleConfig);
+            if (file.read((uint8_t *)job.configs, bytes) == bytes &&
+                crc32_le(0, (const uint8_t *)job.configs, bytes) == hdr.crc) {
+                job.count = hdr.count;
+            }
+        }
+        file.close();
+    }
+}
+
+// На задаче SD
+void rulesWrite(void *ctx) {
+    RulesJob &job = *(RulesJob *)ctx;
+    size_t bytes = job.count * sizeof(RuleConfig);
+    RulesFileHeader hdr = {RULES_MAGIC, sizeof(RuleConfig), job.count,
+                           crc32_le(0, (const uint8_t *)job.configs, bytes)};
+    bool ok = false;
+    File file = SD.open(RULES_TMP_PATH, FILE_WRITE);
+    if (file) {
+        ok = file.write((const uint8_t *)&hdr, sizeof(hdr)) == sizeof(hdr) &&
+             file.write((const uint8_t *)job.configs, bytes) == bytes;
+        file.close();
+    }
+    if (ok) {
+        SD.remove(RULES_PATH);
+        ok = SD.rename(RULES_TMP_PATH, RULES_PATH);
+    }
+    if (!ok) sdWriteFailed = true;
+    job.busy = false;
+}
+
+// Из loop(): изменённые правила уходят на SD копией, задача SD пишет без блокировки
+void rulesService() {
+    if (!rulesDirty || rulesJob.busy || !sdTaskHandle) return;
+    portENTER_CRITICAL(&rulesMux);
+    rulesJob.count = ruleEngine.count();
+    for (uint8_t i = 0; i < rulesJob.count; i++) rulesJob.configs[i] = ruleEngine.config(i);
+    rulesDirty = false;
+    portEXIT_CRITICAL(&rulesMux);
+    
+    rulesJob.busy = true;
+    if (!sdPost(rulesWrite, &rulesJob)) {
+        rulesJob.busy = false;
+        rulesDirty = true;
+    }
+}
+
+// Из обработчиков показаний: проверяются только правила этой метрики узла
+void rulesCheck(uint16_t node, uint8_t metric, float value) {
+    RuleEvent events[RULES_EVENTS_MAX];
+    RuleConfig configs[RULES_EVENTS_MAX];
+    uint32_t t = nodeStatsTime();
+    portENTER_CRITICAL(&rulesMux);
+    uint8_t n = ruleEngine.evaluate(node, metric, t, value, events, RULES_EVENTS_MAX);
+    for (uint8_t i = 0; i < n; i++) configs[i] = ruleEngine.config(events[i].rule);
+    portEXIT_CRITICAL(&rulesMux);
+    
+    for (uint8_t i = 0; i < n; i++) {
+        const RuleEvent &ev = events[i];
+        const RuleConfig &cfg = configs[i];
+        journalAdd(node, EV_WEATHER_ALARM, ((int32_t)ev.rule << 1) | (ev.raised ? 1 : 0));
+        Serial.printf("Правило %s/%s узла %u: %s (%.1f, %+.1f)\n", RULE_METRIC_NAMES[cfg.metric],
+                      RULE_KIND_NAMES[cfg.kind], node, ev.raised ? "тревога" : "норма", ev.value, ev.delta);
+        if (!ev.raised) continue;
+        wsBroadcast(WS_PRIO_EVENT, [&](WsWriter &w) {
+            w.beginObject();
+            w.field("type", "weather_alarm");
+            w.field("alarm_type", ruleAlarmType(cfg));
+            w.field("node", node);
+            w.field("sensor", RULE_METRIC_NAMES[cfg.metric]);
+            w.fieldFixed("value", ev.value, 1);
+            w.fieldFixed("delta", ev.delta, 1);
+            w.fieldFixed("threshold", cfg.threshold, 1);
+            w.endObject();
+        });
+    }
+}
+
+// Имена, которые понимает web4.html; остальные показываются как общая тревога
+const char *ruleAlarmType(const RuleConfig &cfg) {
+    switch (cfg.kind) {
+        case RULE_BELOW: return "limit_min";
+        case RULE_ABOVE: return "limit_max";
+        case RULE_FALL: return cfg.metric == RM_PRESS ? "pressure_drop" : "rate_fall";
+        case RULE_RISE: return "rate_rise";
+        default: return "wind_change";
+    }
+}
+
+int ruleMetricByName(const char *name) {
+    for (uint8_t i = 0; i < RM_COUNT; i++) {
+        if (strcmp(name, RULE_METRIC_NAMES[i]) == 0) return i;
+    }
+    return -1;
+}
+
+int ruleKindByName(const char *name) {
+    for (uint8_t i = 0; i < RULE_KIND_COUNT; i++) {
+        if (strcmp(name, RULE_KIND_NAMES[i]) == 0) return i;
+    }
+    return -1;
+}
+
+bool ruleNodeKnown(int node) {
+    for (int i = 0; i < NODE_COUNT; i++) {
+        if (nodeNumbers[i] == node) return true;
+    }
+    return false;
+}
+
+void buildLimitsUpdate(WsWriter &w, uint16_t node, uint8_t metric) {
+    RuleConfig lo = {}, hi = {};
+    portENTER_CRITICAL(&rulesMux);
+    int i = ruleEngine.find(node, metric, RULE_BELOW);
+    if (i >= 0) lo = ruleEngine.config(i);
+    i = ruleEngine.find(node, metric, RULE_ABOVE);
+    if (i >= 0) hi = ruleEngine.config(i);
+    portEXIT_CRITICAL(&rulesMux);
+    
+    wsLimitsUpdate(w, node, RULE_METRIC_NAMES[metric], lo, hi);
+}
+
+// {"type":"set_limits","node":102,"sensor":"temp","min":{"enabled":true,"value":18},
+//  "max":{"enabled":false,"value":25},"hysteresis":0.5} - hysteresis необязателен
+void handleSetLimits(JsonDocument &doc) {
+    int node = doc["node"] | 0;
+    int metric = ruleMetricByName(doc["sensor"] | "");
+    if (!ruleNodeKnown(node) || metric < 0 || metric == RM_WIND) return;
+    float hysteresis = doc["hysteresis"] | RULE_DEFAULT_HYSTERESIS[metric];
+    
+    RuleConfig lo = {(uint16_t)node, (uint8_t)metric, RULE_BELOW, doc["min"]["value"] | 0.0f,
+                     hysteresis, 0, (uint8_t)(doc["min"]["enabled"] | false), 0};
+    RuleConfig hi = {(uint16_t)node, (uint8_t)metric, RULE_ABOVE, doc["max"]["value"] | 0.0f,
+                     hysteresis, 0, (uint8_t)(doc["max"]["enabled"] | false), 0};
+    portENTER_CRITICAL(&rulesMux);
+    bool ok = ruleEngine.set(lo) && ruleEngine.set(hi);
+    ruleEngine.compile();
+    portEXIT_CRITICAL(&rulesMux);
+    if (!ok) Serial.println("Правила: нет места");
+    rulesDirty = true;
+    
+    wsBroadcast(WS_PRIO_EVENT, [&](WsWriter &w) { buildLimitsUpdate(w, node, metric); });
+}
+
+// {"type":"set_rule","node":102,"sensor":"press","kind":"fall","threshold":2,
+//  "hysteresis":0.5,"window_s":10800,"enabled":true}
+// Окно вне 1..65535 с не влезает в uint16_t правила - отказ, а не обрезка:
+// {"type":"set_rule","node":102,"ok":false,"error":"window_s"}
+void handleSetRule(AsyncWebSocketClient *client, JsonDocument &doc) {
+    int node = doc["node"] | 0;
+    int metric = ruleMetricByName(doc["sensor"] | "");
+    int kind = ruleKindByName(doc["kind"] | "");
+    if (!ruleNodeKnown(node) || metric < 0 || kind < 0) return;
+    
+    JsonVariant window = doc["window_s"];
+    long windowS = window.isNull() ? 3600 : window.is<long>() ? window.as<long>() : 0;
+    if (windowS < 1 || windowS > 65535) {
+        WsFormat format;
+        if (!wsClientFormat(client->id(), &format)) return;
+        wsSendTo(client->id(), format, [&](WsWriter &w) {
+            w.beginObject();
+            w.field("type", "set_rule");
+            w.field("node", node);
+            w.fieldBool("ok", false);
+            w.field("error", "window_s");
+            w.endObject();
+        });
+        return;
+    }
+    
+    RuleConfig cfg = {(uint16_t)node, (uint8_t)metric, (uint8_t)kind, doc["threshold"] | 0.0f,
+                      doc["hysteresis"] | RULE_DEFAULT_HYSTERESIS[metric],
+                      (uint16_t)windowS, (uint8_t)(doc["enabled"] | true), 0};
+    portENTER_CRITICAL(&rulesMux);
+    bool ok = ruleEngine.set(cfg);
+    ruleEngine.compile();
+    portEXIT_CRITICAL(&rulesMux);
+    if (!ok) Serial.println("Правила: нет места");
+    rulesDirty = true;
+    
+    if (kind == RULE_BELOW || kind == RULE_ABOVE) {
+        wsBroadcast(WS_PRIO_EVENT, [&](WsWriter &w) { buildLimitsUpdate(w, node, metric); });
+    }
+}
+
+// Полный проход по FAT: медленно, вызывается только при инициализации
+void updateSDInfo() {
+    if (!sdInitialized) return;
+    sdTotalBytes = SD.totalBytes();
+    sdUsedBytes = SD.usedBytes();
+}
+
+// ========== ЛОГГЕР SD ==========
+
+void sdLogPath(char *out, size_t size, uint32_t day) {
+    DateTime d(day * 86400UL);
+    snprintf(out, size, SD_LOG_DIR "/%04d%02d%02d.csv", d.year(), d.month(), d.day());
+}
+
+// ---------- Сторона задачи SD ----------
+
+// Открывает (или создаёт) файл суток day; хвост прошлого файла уже дописан
+bool sdLogOpen(uint32_t day) {
+    if (sdLogFile.file) sdLogFile.file.close();
+    if (!SD.exists(SD_LOG_DIR)) SD.mkdir(SD_LOG_DIR);
+    
+    sdLogPath(sdLogFile.path, sizeof(sdLogFile.path), day);
+    sdLogFile.file = SD.open(sdLogFile.path, FILE_APPEND);
+    if (!sdLogFile.file) return false;
+    
+    sdLogFile.day = day;
+    sdLogFile.fileSize = sdLogFile.file.size();
+    sdLogFile.carryLen = 0;
+    if (sdLogFile.fileSize == 0) return sdLogAppend(SD_LOG_HEADER, strlen(SD_LOG_HEADER));
+    return true;
+}
+
+bool sdLogWrite(uint32_t day, const char *data, uint16_t len, bool sync) {
+    bool ok = true;
+    if (len > 0 && (!sdLogFile.file || day != sdLogFile.day)) {
+        ok = sdLogFlushCarry();
+        ok = sdLogOpen(day) && ok;
+    }
+    if (sdLogFile.file) {
+        if (len > 0) ok = sdLogAppend(data, len) && ok;
+        if (sync) ok = sdLogFlushCarry() && ok;
+        sdLogFile.file.flush();
+    }
+    return ok;
+}
+
+// Пишет только целые блоки файла; остаток копится в carry
+bool sdLogAppend(const char *data, uint16_t len) {
+    while (len > 0) {
+        uint16_t room = SD_LOG_BLOCK_SIZE - (sdLogFile.fileSize + sdLogFile.carryLen) % SD_LOG_BLOCK_SIZE;
+        if (len < room) {
+            memcpy(sdLogFile.carry + sdLogFile.carryLen, data, len);
+            sdLogFile.carryLen += len;
+            return true;
+        }
+        if (sdLogFile.carryLen > 0) {
+            memcpy(sdLogFile.carry + sdLogFile.carryLen, data, room);
+            sdLogFile.carryLen += room;
+            data += room;
+            len -= room;
+            if (!sdLogFlushCarry()) return false;
+        } else {
+            // Целые блоки - прямо из половины буфера, без копирования
+            uint16_t n = room + (len - room) / SD_LOG_BLOCK_SIZE * SD_LOG_BLOCK_SIZE;
+            if (!sdLogWriteRaw(data, n)) return false;
+            data += n;
+            len -= n;
+        }
+    }
+    return true;
+}
+
+bool sdLogWriteRaw(const char *data, uint16_t len) {
+    size_t written = sdLogFile.file.write((const uint8_t *)data, len);
+    sdLogFile.fileSize += written;
+    sdUsedBytes += written;     // С точностью до кластера - для экрана достаточно
+    return written == len;
+}
+
+bool sdLogFlushCarry() {
+    if (sdLogFile.carryLen == 0 || !sdLogFile.file) return true;
+    bool ok = sdLogWriteRaw(sdLogFile.carry, sdLogFile.carryLen);
+    sdLogFile.carryLen = 0;
+    return ok;
+}
+
+// ---------- Сторона loop() ----------
+
+// Передаёт активную половину буфера задаче SD. false - задача ещё занята
+// второй половиной, записи остаются в активной
+bool sdLogSubmit(bool sync) {
+    SdLogBuffer &b = sdLogBufs[sdLogActive];
+    if (b.len == 0 && !sync) return true;
+    
+    uint8_t other = sdLogActive ^ 1;
+    if (!sdTaskHandle || sdLogBufs[other].busy) return false;
+    
+    b.busy = true;
+    SdJob job = {SD_JOB_WRITE, sdLogActive, sync, nullptr, nullptr, nullptr, (uint32_t)micros()};
+    if (xQueueSend(sdQueue, &job, 0) != pdTRUE) {
+        b.busy = false;
+        return false;
+    }
+    sdLogActive = other;
+    return true;
+}
+
+void sdLogRecord() {
+    if (!sdInitialized || !rtcOK) return;
+    
+    DateTime now = rtc.now();
+    uint32_t day = now.unixtime() / 86400;
+    
+    char line[64];
+    int n = snprintf(line, sizeof(line), "%04d-%02d-%02d %02d:%02d:%02d,P:%.2f,T:%.2f,H:%.2f",
+                     now.year(), now.month(), now.day(), now.hour(), now.minute(), now.second(),
+                     currentPressure, currentTemp, currentHumidity);
+    if (n <= 0 || n >= (int)sizeof(line)) return;
+    uint32_t crc = crc32_le(0, (const uint8_t *)line, n);
+    int tail = snprintf(line + n, sizeof(line) - n, ",%08lx\n", (unsigned long)crc);
+    if (tail <= 0 || n + tail >= (int)sizeof(line)) return;
+    n += tail;
+    
+    // Смена суток: записи прошлого дня целиком уходят в свой файл
+    SdLogBuffer *b = &sdLogBufs[sdLogActive];
+    if ((b->len > 0 && b->day != day) || b->len + n > SD_LOG_BUFFER_SIZE) {
+        sdLogSubmit(b->day != day);
+        b = &sdLogBufs[sdLogActive];
+    }
+    if ((b->len > 0 && b->day != day) || b->len + n > SD_LOG_BUFFER_SIZE) {
+        sdLogDropped++;
+        return;
+    }
+    
+    if (b->len == 0) {
+        b->day = day;
+        sdLogOldestMs = millis();
+    }
+    memcpy(b->data + b->len, line, n);
+    b->len += n;
+    sdWriteCount++;
+    displayInvalidate(DISPLAY_DIRTY_SD);
+    if (b->len >= SD_LOG_BLOCK_SIZE) sdLogSubmit(false);
+}
+
+// Из loop(): неполный блок не должен висеть в RAM дольше SD_LOG_MAX_AGE_MS
+void sdLogService(uint32_t now) {
+    if (sdWriteFailed) {
+        sdWriteFailed = false;
+        showAlert("ОШИБКА ЗАПИСИ SD");
+    }
+    if (sdLogBufs[sdLogActive].len > 0 && now - sdLogOldestMs >= SD_LOG_MAX_AGE_MS) {
+        sdLogSubmit(true);
+    }
+}
+
+// ========== ЗАДАЧА SD ==========
+
+void sdStartWorker() {
+    sdQueue = xQueueCreate(SD_QUEUE_LEN, sizeof(SdJob));
+    if (!sdQueue) return;
+    if (xTaskCreatePinnedToCore(sdWorkerTask, "sd", SD_TASK_STACK, nullptr,
+                                SD_TASK_PRIORITY, &sdTaskHandle, SD_TASK_CORE) != pdPASS) {
+        sdTaskHandle = nullptr;
+        Serial.println("❌ SD task not started");
+    }
+}
+
+void sdWorkerTask(void *param) {
+    SdJob job;
+    while (true) {
+        if (xQueueReceive(sdQueue, &job, portMAX_DELAY) != pdTRUE) continue;
+        
+        if (job.type == SD_JOB_WRITE) {
+            uint32_t start = micros();
+            SdLogBuffer &b = sdLogBufs[job.buffer];
+            if (!sdLogWrite(b.day, b.data, b.len, job.sync)) sdWriteFailed = true;
+            b.len = 0;
+            b.busy = false;
+            sdRecordLatency(sdWriteStats, micros() - start);
+        } else if (job.waiter) {
+            job.fn(job.ctx);
+            sdRecordLatency(sdReadStats, micros() - job.queuedUs);
+            xTaskNotifyGive(job.waiter);
+        } else {
+            uint32_t start = micros();
+            job.fn(job.ctx);
+            sdRecordLatency(sdWriteStats, micros() - start);
+        }
+    }
+}
+
+void sdRecordLatency(SdLatencyStats &stats, uint32_t us) {
+    uint32_t ms = us / 1000;
+    uint8_t bucket = 0;
+    while (bucket < SD_HIST_BUCKETS - 1 && ms >= SD_HIST_LIMITS_MS[bucket]) bucket++;
+    
+    portENTER_CRITICAL(&sdStatsMux);
+    stats.count++;
+    stats.buckets[bucket]++;
+    if (us > stats.maxUs) stats.maxUs = us;
+    portEXIT_CRITICAL(&sdStatsMux);
+}
+
+// Выполняет fn на задаче SD и ждёт завершения. До запуска задачи (setup)
+// и из неё самой - вызывает напрямую
+void sdRun(SdCallFn fn, void *ctx) {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    if (!sdTaskHandle || self == sdTaskHandle) {
+        fn(ctx);
+        return;
+    }
+    SdJob job = {SD_JOB_CALL, 0, false, fn, ctx, self, (uint32_t)micros()};
+    xQueueSendToFront(sdQueue, &job, portMAX_DELAY);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+}
+
+// Ставит fn в очередь задачи SD и не ждёт; ctx должен жить до выполнения
+bool sdPost(SdCallFn fn, void *ctx) {
+    if (!sdQueue) return false;
+    SdJob job = {SD_JOB_CALL, 0, false, fn, ctx, nullptr, (uint32_t)micros()};
+    return xQueueSend(sdQueue, &job, 0) == pdTRUE;
+}
+
+struct SdFileCall {
+    File *file;
+    const char *path;
+    const char *mode;
+    uint8_t *buf;
+    size_t len;
+    size_t result;
+};
+
+File sdOpen(const char *path, const char *mode) {
+    File file;
+    SdFileCall call = {&file, path, mode, nullptr, 0, 0};
+    sdRun([](void *ctx) {
+        SdFileCall *c = (SdFileCall *)ctx;
+        *c->file = SD.open(c->path, c->mode);
+    }, &call);
+    return file;
+}
+
+bool sdExists(const char *path) {
+    SdFileCall call = {nullptr, path, nullptr, nullptr, 0, 0};
+    sdRun([](void *ctx) {
+        SdFileCall *c = (SdFileCall *)ctx;
+        c->result = SD.exists(c->path);
+    }, &call);
+    return call.result;
+}
+
+size_t sdRead(File &file, uint8_t *buf, size_t len) {
+    SdFileCall call = {&file, nullptr, nullptr, buf, len, 0};
+    sdRun([](void *ctx) {
+        SdFileCall *c = (SdFileCall *)ctx;
+        c->result = c->file->read(c->buf, c->len);
+    }, &call);
+    return call.result;
+}
+
+void sdClose(File &file) {
+    SdFileCall call = {&file, nullptr, nullptr, nullptr, 0, 0};
+    sdRun([](void *ctx) {
+        SdFileCall *c = (SdFileCall *)ctx;
+        c->file->close();
+        *c->file = File();
+    }, &call);
+}
+
+// GET /api/sdstats: гистограммы задержек записи и запросов HTTP к карте, журнал событий
+void serveSdStats(AsyncWebServerRequest *request) {
+    SdLatencyStats stats[2];
+    portENTER_CRITICAL(&sdStatsMux);
+    stats[0] = sdWriteStats;
+    stats[1] = sdReadStats;
+    portEXIT_CRITICAL(&sdStatsMux);
+    
+    char json[1536];
+    size_t len = snprintf(json, sizeof(json), "{\"limits_ms\":[");
+    for (uint8_t i = 0; i < SD_HIST_BUCKETS - 1; i++) {
+        len += snprintf(json + len, sizeof(json) - len, "%s%u", i ? "," : "", SD_HIST_LIMITS_MS[i]);
+    }
+    len += snprintf(json + len, sizeof(json) - len, "]");
+    
+    const char *names[] = {"write", "read"};
+    for (uint8_t s = 0; s < 2; s++) {
+        len += snprintf(json + len, sizeof(json) - len, ",\"%s\":{\"count\":%lu,\"max_us\":%lu,\"hist\":[",
+                        names[s], (unsigned long)stats[s].count, (unsigned long)stats[s].maxUs);
+        for (uint8_t i = 0; i < SD_HIST_BUCKETS; i++) {
+            len += snprintf(json + len, sizeof(json) - len, "%s%lu", i ? "," : "",
+                            (unsigned long)stats[s].buckets[i]);
+        }
+        len += snprintf(json + len, sizeof(json) - len, "]}");
+    }
+    len += snprintf(json + len, sizeof(json) - len, ",\"dropped\":%lu,\"queued\":%u",
+                    (unsigned long)sdLogDropped, sdQueue ? (unsigned)uxQueueMessagesWaiting(sdQueue) : 0);
+    
+    // Журнал: пропускная способность записи - байты на секунду чистого времени записи
+    JournalStats js;
+    portENTER_CRITICAL(&journalMux);
+    js = journalStats;
+    portEXIT_CRITICAL(&journalMux);
+    uint32_t writeBps = js.writeUs ? (uint64_t)js.records * sizeof(JournalRecord) * 1000000 / js.writeUs : 0;
+    snprintf(json + len, sizeof(json) - len,
+             ",\"journal\":{\"events\":%lu,\"coalesced\":%lu,\"dropped\":%lu,\"commits\":%lu,"
+             "\"records\":%lu,\"ring_peak\":%u,\"rate_peak\":%u,\"write_bps\":%lu},"
+             "\"recovery\":{\"us\":%lu,\"scanned\":%lu,\"cut\":%lu},"
+             "\"compact\":{\"files\":%lu,\"in\":%lu,\"out\":%lu},"
+             "\"warm_restore\":{\"us\":%lu,\"points\":%u,\"snapshot_age\":%ld},"
+             "\"display\":{\"updates\":%lu,\"widgets\":%lu,\"pixels\":%lu,\"last_pixels\":%lu,"
+             "\"max_pixels\":%lu,\"page_switches\":%lu,\"invalidations\":%lu,\"frames\":%lu,"
+             "\"frame_us\":%lu,\"max_frame_us\":%lu,\"ingest_max_us\":%lu,\"strip_render\":%d,"
+             "\"strips\":%lu,\"page_us\":%lu,\"max_page_us\":%lu}}",
+             (unsigned long)js.events, (unsigned long)js.coalesced, (unsigned long)js.dropped,
+             (unsigned long)js.commits, (unsigned long)js.records, js.ringPeak, js.ratePeak,
+             (unsigned long)writeBps, (unsigned long)sdRecoveryUs, (unsigned long)sdRecoveryScanned,
+             (unsigned long)sdRecoveryCut, (unsigned long)tsCompact.files,
+             (unsigned long)tsCompact.bytesIn, (unsigned long)tsCompact.bytesOut,
+             (unsigned long)warmRestoreStats.us, warmRestoreStats.points,
+             (long)warmRestoreStats.snapshotAge, (unsigned long)hubDisplay.stats.updates,
+             (unsigned long)hubDisplay.stats.widgets, (unsigned long)hubDisplay.stats.pixels,
+             (unsigned long)hubDisplay.stats.lastPixels, (unsigned long)hubDisplay.stats.maxPixels,
+             (unsigned long)hubDisplay.stats.pageSwitches, (unsigned long)displayTaskStats.invalidations,
+             (unsigned long)displayTaskStats.frames, (unsigned long)displayTaskStats.frameUs,
+             (unsigned long)displayTaskStats.maxFrameUs, (unsigned long)displayTaskStats.ingestMaxUs,
+             hubDisplay.stripRender() ? 1 : 0, (unsigned long)hubDisplay.stats.strips,
+             (unsigned long)hubDisplay.stats.pageUs, (unsigned long)hubDisplay.stats.maxPageUs);
+    request->send(200, "application/json", json);
+}
+
+String formatTime(int value) {
+    if (value < 10) return "0" + String(value);
+    return String(value);
+}
+
+// ========== ВЕРХНИЙ БАР ==========
+// Заголовок задаёт страница, здесь - только часы
+void displayUpdateClock() {
+    char text[sizeof(timeStr)];
+    if (rtcOK) {
+        sprintf(text, "%02d:%02d", lastRTCRead.hour(), lastRTCRead.minute());
+    } else {
+        strcpy(text, "--:--");
+    }
+    portENTER_CRITICAL(&displayMux);
+    strcpy(timeStr, text);
+    portEXIT_CRITICAL(&displayMux);
+    displayInvalidate(DISPLAY_DIRTY_HEADER);
+}
+
+// ========== ЗАДАЧА ДИСПЛЕЯ ==========
+// Из любой задачи: только пометка, без SPI
+void displayInvalidate(uint32_t flags) {
+    portENTER_CRITICAL(&displayMux);
+    displayDirty |= flags;
+    displayTaskStats.invalidations++;
+    portEXIT_CRITICAL(&displayMux);
+    if (displayTaskHandle) xTaskNotifyGive(displayTaskHandle);
+}
+
+void displayStartTask() {
+    displayUpdateClock();
+    displayInvalidate(DISPLAY_DIRTY_ALL);
+    if (xTaskCreatePinnedToCore(displayTask, "display", DISPLAY_TASK_STACK, nullptr,
+                                DISPLAY_TASK_PRIORITY, &displayTaskHandle, DISPLAY_TASK_CORE) != pdPASS) {
+        displayTaskHandle = nullptr;
+        Serial.println("❌ Display task not started");
+    }
+}
+
+void displayTask(void *param) {
+    uint32_t lastFrame = millis() - DISPLAY_FRAME_MS;
+    while (true) {
+        // Пометки до пробуждения копятся в displayDirty, уведомления - в счётчике
+        if (displayDirty == 0) ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        uint32_t elapsed = millis() - lastFrame;
+        if (elapsed < DISPLAY_FRAME_MS) vTaskDelay(pdMS_TO_TICKS(DISPLAY_FRAME_MS - elapsed));
+        ulTaskNotifyTake(pdTRUE, 0);
+        
+        lastFrame = millis();
+        uint32_t start = micros();
+        portENTER_CRITICAL(&displayMux);
+        uint32_t flags = displayDirty;
+        displayDirty = 0;
+        portEXIT_CRITICAL(&displayMux);
+        if (flags == 0) continue;
+        
+        displayFrame(flags);
+        uint32_t us = micros() - start;
+        displayTaskStats.frames++;
+        displayTaskStats.frameUs = us;
+        if (us > displayTaskStats.maxFrameUs) displayTaskStats.maxFrameUs = us;
+    }
+}
+
+// Копия всего, что показывают страницы. Суточная статистика узла и
+// графики берутся под своим спинлоком сразу следом
+void displaySnapshot(DisplayState &s) {
+    portENTER_CRITICAL(&displayMux);
+    s.page = currentPage;
+    s.nodeIndex = displayNodeIndex;
+    s.temp = currentTemp;
+    s.pressure = currentPressure;
+    s.humidity = currentHumidity;
+    s.icon = weatherIcon;
+    s.frost = frostRisk;
+    s.windDirection = windDirection;
+    s.windMagnet = windMagnet;
+    s.node = nodeDisplayData[displayNodeIndex];
+    s.greenhouse = greenhouseDisplay;
+    s.sdOk = sdInitialized;
+    strcpy(s.sdType, sdCardType == CARD_MMC ? "MMC" : sdCardType == CARD_SD ? "SDSC" :
+                     sdCardType == CARD_SDHC ? "SDHC" : "UNKNOWN");
+    s.sdTotalBytes = sdTotalBytes;
+    s.sdUsedBytes = sdUsedBytes;
+    s.sdWriteCount = sdWriteCount;
+    memcpy(s.sdError, sdErrorMsg, sizeof(s.sdError));
+    s.sdError[sizeof(s.sdError) - 1] = '\0';
+    memcpy(s.alert, systemAlert.active ? systemAlert.message : "", systemAlert.active ? sizeof(s.alert) : 1);
+    s.alert[sizeof(s.alert) - 1] = '\0';
+    memcpy(s.clock, timeStr, sizeof(s.clock));
+    s.clock[sizeof(s.clock) - 1] = '\0';
+    portEXIT_CRITICAL(&displayMux);
+    
+    // Файлом лога владеет задача SD: имя - как и раньше, без блокировки
+    strncpy(s.sdFile, sdLogFile.file ? sdLogFile.path + strlen(SD_LOG_DIR) + 1 : "---", sizeof(s.sdFile) - 1);
+    s.sdFile[sizeof(s.sdFile) - 1] = '\0';
+    s.statsTemp = nodeStatsGet(s.nodeIndex, TS_TEMP);
+    s.statsHum = nodeStatsGet(s.nodeIndex, TS_HUM);
+    s.statsPress = nodeStatsGet(s.nodeIndex, TS_PRESS);
+    s.statsTime = nodeStatsTime();
+    portENTER_CRITICAL(&nodeStatsMux);
+    weatherSparkTemp.copy(s.sparkTemp);
+    s.sparkPress = weatherSparkPress;
+    nodeSparkTemp[s.nodeIndex].copy(s.nodeSparkTemp);
+    nodeSparkPress[s.nodeIndex].copy(s.nodeSparkPress);
+    portEXIT_CRITICAL(&nodeStatsMux);
+}
+
+void displayFrame(uint32_t flags) {
+    displaySnapshot(displayState);
+    hubDisplay.frame(displayState, flags);
+}
+
+// ========== СИСТЕМА ТРЕВОГ ==========
+void checkSystemAlerts() {
+    // Проверяем SD карту (только при ошибках)
+    if (!sdInitialized && !systemAlert.active) {
+        showAlert("НЕТ SD");
+    }
+    
+    // Проверяем RTC
+    if (!rtcOK && !systemAlert.active) {
+        showAlert("ОШИБКА RTC");
+    }
+    
+    // Если тревога активна больше 5 секунд, но причина устранена
+    if (systemAlert.active && (millis() - systemAlert.startTime > 5000)) {
+        bool reasonExists = false;
+        
+        if (!sdInitialized) reasonExists = true;
+        else if (!rtcOK) reasonExists = true;
+        else if (securityAlarmActive) reasonExists = true;
+        else {
+            for (int i = 0; i < NODE_COUNT; i++) {
+                if (nodeConnectionLost[i] || nodeAlarmState[i]) {
+                    reasonExists = true;
+                    break;
+                }
+            }
+        }
+        
+        if (!reasonExists) {
+            clearAlert();
+        }
+    }
+}
+
+void showAlert(const char* message) {
+    portENTER_CRITICAL(&displayMux);
+    // Строка тревоги - не больше знаков, чем помещается в её виджет
+    size_t n = utf8Prefix(message, DISPLAY_ALERT_COLS);
+    memcpy(systemAlert.message, message, n);
+    systemAlert.message[n] = '\0';
+    systemAlert.active = true;
+    systemAlert.startTime = millis();
+    portEXIT_CRITICAL(&displayMux);
+    displayInvalidate(DISPLAY_DIRTY_HEADER);
+}
+
+void clearAlert() {
+    portENTER_CRITICAL(&displayMux);
+    bool wasActive = systemAlert.active;
+    systemAlert.active = false;
+    portEXIT_CRITICAL(&displayMux);
+    if (wasActive) displayInvalidate(DISPLAY_DIRTY_HEADER);
+}
+
+// ========== КНОПКИ И ЗВУК ==========
+void handleButtons() {
     unsigned long now = millis();
     
     bool btnCycle = digitalRead(BTN_CYCLE);
@@ -1611,13 +4113,14 @@ void handleButtons() {
     if (btnCycle == LOW && lastBtnCycle == HIGH && (now - lastDebounceCycle) > DEBOUNCE_DELAY) {
         lastDebounceCycle = now;
         
+        portENTER_CRITICAL(&displayMux);
         if (currentPage == PAGE_NODE_INFO) {
             displayNodeIndex = (displayNodeIndex + 1) % 4;
-            displayNodePage();
         } else {
             currentPage = PAGE_NODE_INFO;
-            displayNodePage();
         }
+        portEXIT_CRITICAL(&displayMux);
+        displayInvalidate(DISPLAY_DIRTY_ALL);
         
         buzzerBeep(30);
     }
@@ -1631,12 +4134,10 @@ void handleButtons() {
     
     if (btnEnter == HIGH && lastBtnEnter == LOW) {
         if (!enterLongPressHandled && (now - enterPressStart) < LONG_PRESS_MS) {
+            portENTER_CRITICAL(&displayMux);
             currentPage = (DisplayPage)((currentPage + 1) % PAGE_COUNT);
-            
-            if (currentPage == PAGE_WEATHER) displayWeatherPage();
-            else if (currentPage == PAGE_NODE_INFO) displayNodePage();
-            else if (currentPage == PAGE_GREENHOUSE) displayGreenhousePage();
-            else displaySDPage();
+            portEXIT_CRITICAL(&displayMux);
+            displayInvalidate(DISPLAY_DIRTY_ALL);
             
             buzzerBeep(50);
         }
@@ -1646,7 +4147,8 @@ void handleButtons() {
     if (btnEnter == LOW && !enterLongPressHandled && (now - enterPressStart) >= LONG_PRESS_MS) {
         enterLongPressHandled = true;
         if (sdInitialized) {
-            testSDWrite();
+            sdLogRecord();
+            sdLogSubmit(true);
             buzzerBeep(100);
             delay(100);
             buzzerBeep(100);
@@ -0,0 +1,50 @@
+// node_stats.h - Суточная потоковая статистика показаний узла
+// Среднее и дисперсия по Уэлфорду: один проход, O(1) на показание, без
+// вычитания больших близких сумм - точности float хватает и для давления
+// (~750 мм) с разбросом в десятые доли. Минимум и максимум - с моментом.
+// Сутки - по unixtime RTC: первое показание новых суток начинает заново.
+#ifndef NODE_STATS_H
+#define NODE_STATS_H
+
+#include <Arduino.h>
+
+#define NODE_STATS_DAY_SECONDS  86400UL
+
+struct RunningStats {
+    uint32_t day;           // Номер суток: t / 86400
+    uint32_t count;
+    float mean;
+    float m2;               // Сумма квадратов отклонений от среднего
+    float min;
+    float max;
+    uint32_t minT;          // unixtime RTC
+    uint32_t maxT;
+
+    void reset(uint32_t d) {
+        day = d;
+        count = 0;
+        mean = m2 = 0;
+        min = max = 0;
+        minT = maxT = 0;
+    }
+
+    void add(uint32_t t, float v) {
+        uint32_t d = t / NODE_STATS_DAY_SECONDS;
+        if (d != day) reset(d);
+        count++;
+        float delta = v - mean;
+        mean += delta / count;
+        m2 += delta * (v - mean);
+        if (count == 1 || v < min) { min = v; minT = t; }
+        if (count == 1 || v > max) { max = v; maxT = t; }
+    }
+
+    // Несмещённая оценка; до двух показаний - ноль
+    float variance() const { return count > 1 ? m2 / (count - 1) : 0; }
+    float stddev() const { return sqrtf(variance()); }
+
+    // Статистика относится к суткам t; вчерашняя, не сброшенная показанием, - пустая
+    bool current(uint32_t t) const { return count > 0 && day == t / NODE_STATS_DAY_SECONDS; }
+};
+
+#endif
@@ -0,0 +1,193 @@
+// pressure_history.h - Каскадная история давления и тренды за O(1)
+// Сырые показания копятся в открытой 5-минутной корзине; закрытая корзина
+// уходит в кольцо 5-минутных средних (12 ч) и в 30-минутную корзину, закрытые
+// 30-минутные - в своё кольцо (24 ч). Вся история - около килобайта.
+//
+// Тренд - наклон прямой МНК по средним корзин в окне 3/6/12 ч, пересчитанный
+// в изменение за окно. Суммы окна (n, Σx, Σx², Σy, Σxy) сдвигаются на каждую
+// корзину за O(1): x - номер корзины относительно новейшей (0, -1, -2, ...),
+// y - давление в сотых долях, всё в целых - накопленной ошибки нет.
+#ifndef PRESSURE_HISTORY_H
+#define PRESSURE_HISTORY_H
+
+#include <Arduino.h>
+
+#define PH_SCALE            100             // Значения в кольцах - сотые доли
+#define PH_EMPTY            INT32_MIN       // Корзина без показаний
+#define PH_FINE_SECONDS     300
+#define PH_COARSE_SECONDS   1800
+#define PH_FINE_SIZE        144             // 12 ч по 5 минут
+#define PH_COARSE_SIZE      48              // 24 ч по 30 минут
+
+enum PhTrendWindow : uint8_t {
+    PH_TREND_3H = 0,
+    PH_TREND_6H,
+    PH_TREND_12H,
+    PH_TREND_COUNT
+};
+
+// Скользящая оценка наклона по последним len корзинам кольца
+class TrendWindow {
+public:
+    void begin(uint16_t len) {
+        _len = len;
+        _n = 0;
+        _sx = _sxx = _sy = _sxy = 0;
+    }
+
+    // leaving - корзина, выходящая из окна (возраст len - 1 до сдвига), v - новая
+    void push(int32_t leaving, int32_t v) {
+        // Все x уменьшаются на 1
+        _sxx += _n - 2 * _sx;
+        _sxy -= _sy;
+        _sx -= _n;
+        if (leaving != PH_EMPTY) {
+            int64_t x = -(int64_t)_len;
+            _n--;
+            _sx -= x;
+            _sxx -= x * x;
+            _sy -= leaving;
+            _sxy -= x * leaving;
+        }
+        if (v != PH_EMPTY) {        // x = 0: в суммы с x ничего не добавляет
+            _n++;
+            _sy += v;
+        }
+    }
+
+    // Изменение за окно в единицах измерения; false - мало точек
+    bool change(float bucketsPerWindow, float &out) const {
+        if (_n < 3 || _n < _len / 2) return false;
+        int64_t den = _n * _sxx - _sx * _sx;
+        if (den == 0) return false;
+        float slope = (float)(_n * _sxy - _sx * _sy) / (float)den;    // Сотые доли на корзину
+        out = slope * bucketsPerWindow / PH_SCALE;
+        return true;
+    }
+
+    uint16_t points() const { return _n; }
+
+private:
+    uint16_t _len;
+    int64_t _n;
+    int64_t _sx;
+    int64_t _sxx;
+    int64_t _sy;
+    int64_t _sxy;
+};
+
+// Кольцо средних корзин одной длительности
+template <uint16_t SIZE>
+class BucketRing {
+public:
+    void begin() {
+        _head = 0;
+        _count = 0;
+    }
+
+    void push(int32_t v) {
+        _values[_head] = v;
+        _head = (_head + 1) % SIZE;
+        if (_count < SIZE) _count++;
+    }
+
+    // age 0 - новейшая; за пределами заполненного - пусто
+    int32_t at(uint16_t age) const {
+        if (age >= _count) return PH_EMPTY;
+        return _values[(_head + SIZE - 1 - age) % SIZE];
+    }
+
+    uint16_t count() const { return _count; }
+
+private:
+    int32_t _values[SIZE];
+    uint16_t _head;
+    uint16_t _count;
+};
+
+// Открытая корзина: номер, сумма и число показаний
+struct PhAccumulator {
+    bool started;
+    uint32_t index;         // t / длительность корзины
+    int64_t sum;
+    uint32_t count;
+
+    int32_t mean() const { return count ? (int32_t)(sum / (int64_t)count) : PH_EMPTY; }
+};
+
+class PressureHistory {
+public:
+    void begin() {
+        _fine.begin();
+        _coarse.begin();
+        _fineOpen = PhAccumulator{false, 0, 0, 0};
+        _coarseOpen = PhAccumulator{false, 0, 0, 0};
+        for (uint8_t i = 0; i < PH_TREND_COUNT; i++) _windows[i].begin(windowBuckets(i));
+    }
+
+    // t - секунды (unixtime RTC), не убывают. O(1) на показание; после долгого
+    // перерыва кольца добиваются пустыми корзинами, не больше своего размера
+    void add(uint32_t t, float value) {
+        uint32_t index = t / PH_FINE_SECONDS;
+        if (_fineOpen.started && index != _fineOpen.index) {
+            if (index < _fineOpen.index) return;            // Время пошло назад
+            pushFine(_fineOpen.index, _fineOpen.mean(), _fineOpen.count);
+            uint32_t gap = index - _fineOpen.index - 1;
+            if (gap > PH_FINE_SIZE) gap = PH_FINE_SIZE;
+            for (uint32_t i = index - gap; i < index; i++) pushFine(i, PH_EMPTY, 0);
+            _fineOpen.sum = 0;
+            _fineOpen.count = 0;
+        }
+        _fineOpen.started = true;
+        _fineOpen.index = index;
+        _fineOpen.sum += (int32_t)lroundf(value * PH_SCALE);
+        _fineOpen.count++;
+    }
+
+    bool trend(uint8_t window, float &out) const {
+        return _windows[window].change(windowBuckets(window), out);
+    }
+
+    const BucketRing<PH_FINE_SIZE> &fine() const { return _fine; }
+    const BucketRing<PH_COARSE_SIZE> &coarse() const { return _coarse; }
+    // t / PH_COARSE_SECONDS новейшей закрытой корзины (если coarse() не пусто)
+    uint32_t coarseNewest() const { return _coarseOpen.index - 1; }
+
+    static uint16_t windowBuckets(uint8_t window) {
+        static const uint16_t hours[PH_TREND_COUNT] = {3, 6, 12};
+        return hours[window] * 3600 / PH_FINE_SECONDS;
+    }
+
+private:
+    BucketRing<PH_FINE_SIZE> _fine;
+    BucketRing<PH_COARSE_SIZE> _coarse;
+    PhAccumulator _fineOpen;
+    PhAccumulator _coarseOpen;
+    TrendWindow _windows[PH_TREND_COUNT];
+
+    // Закрытая 5-минутная корзина: в окна, в кольцо и в 30-минутную корзину
+    void pushFine(uint32_t index, int32_t mean, uint32_t count) {
+        for (uint8_t i = 0; i < PH_TREND_COUNT; i++) {
+            _windows[i].push(_fine.at(windowBuckets(i) - 1), mean);
+        }
+        _fine.push(mean);
+
+        uint32_t coarseIndex = index * PH_FINE_SECONDS / PH_COARSE_SECONDS;
+        if (_coarseOpen.started && coarseIndex != _coarseOpen.index) {
+            _coarse.push(_coarseOpen.mean());
+            uint32_t gap = coarseIndex - _coarseOpen.index - 1;
+            if (gap > PH_COARSE_SIZE) gap = PH_COARSE_SIZE;
+            while (gap-- > 0) _coarse.push(PH_EMPTY);
+            _coarseOpen.sum = 0;
+            _coarseOpen.count = 0;
+        }
+        _coarseOpen.started = true;
+        _coarseOpen.index = coarseIndex;
+        if (count > 0) {
+            _coarseOpen.sum += (int64_t)mean * count;
+            _coarseOpen.count += count;
+        }
+    }
+};
+
+#endif
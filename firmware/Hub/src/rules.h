@@ -0,0 +1,228 @@
+// rules.h - Правила погодных тревог: пороги, скорость изменения, гистерезис
+// Правило привязано к узлу и метрике. После compile() номера правил лежат
+// плоским массивом, отсортированным по (узел, метрика), поверх него -
+// таблица диапазонов; показание проверяет только правила своей метрики.
+//
+// Скорость изменения: окно правила делится на RULE_RATE_SLOTS слотов, в
+// кольце - среднее каждого слота (для направления ветра - первое значение:
+// углы не усредняются линейно). Изменение - от слота, начавшегося окно назад.
+#ifndef RULES_H
+#define RULES_H
+
+#include <Arduino.h>
+
+#define RULES_MAX           32
+#define RULE_RATE_SLOTS     12
+#define RULE_EMPTY          NAN
+
+enum RuleMetric : uint8_t {
+    RM_TEMP = 0,            // Совпадают с TsMetric
+    RM_HUM,
+    RM_PRESS,
+    RM_WIND,                // Направление ветра, градусы
+    RM_COUNT
+};
+
+enum RuleKind : uint8_t {
+    RULE_BELOW = 0,         // Значение ниже порога
+    RULE_ABOVE,             // Значение выше порога
+    RULE_FALL,              // Падение за окно не меньше порога
+    RULE_RISE,              // Рост за окно не меньше порога
+    RULE_SHIFT,             // Поворот (по кругу) за окно не меньше порога
+    RULE_KIND_COUNT
+};
+
+// Хранится на SD как есть
+struct RuleConfig {
+    uint16_t node;
+    uint8_t metric;
+    uint8_t kind;
+    float threshold;
+    float hysteresis;       // Тревога снимается, когда значение отойдёт от порога на столько
+    uint16_t windowS;       // Окно для FALL/RISE/SHIFT, секунды
+    uint8_t enabled;
+    uint8_t reserved;
+};
+
+struct RuleEvent {
+    uint8_t rule;           // Индекс в конфигурации
+    bool raised;            // true - тревога, false - снята
+    float value;
+    float delta;            // Изменение за окно (для порогов - 0)
+};
+
+class RuleEngine {
+public:
+    void begin() {
+        _count = 0;
+        _rangeCount = 0;
+    }
+
+    // Заменяет правило с тем же (узел, метрика, вид) или добавляет новое.
+    // Состояние изменённого правила сбрасывается. false - нет места
+    bool set(const RuleConfig &cfg) {
+        int i = find(cfg.node, cfg.metric, cfg.kind);
+        if (i < 0) {
+            if (_count >= RULES_MAX) return false;
+            i = _count++;
+        }
+        _configs[i] = cfg;
+        resetState(i);
+        return true;
+    }
+
+    int find(uint16_t node, uint8_t metric, uint8_t kind) const {
+        for (uint8_t i = 0; i < _count; i++) {
+            if (_configs[i].node == node && _configs[i].metric == metric && _configs[i].kind == kind) return i;
+        }
+        return -1;
+    }
+
+    uint8_t count() const { return _count; }
+    const RuleConfig &config(uint8_t i) const { return _configs[i]; }
+    bool active(uint8_t i) const { return _state[i].active; }
+
+    // Сортировка вставками по (узел, метрика) и таблица диапазонов
+    void compile() {
+        uint8_t n = 0;
+        for (uint8_t i = 0; i < _count; i++) {
+            if (!_configs[i].enabled) continue;
+            uint32_t k = key(_configs[i]);
+            uint8_t j = n++;
+            while (j > 0 && key(_configs[_order[j - 1]]) > k) {
+                _order[j] = _order[j - 1];
+                j--;
+            }
+            _order[j] = i;
+        }
+        _rangeCount = 0;
+        for (uint8_t j = 0; j < n; j++) {
+            uint32_t k = key(_configs[_order[j]]);
+            if (_rangeCount == 0 || _ranges[_rangeCount - 1].key != k) {
+                _ranges[_rangeCount++] = Range{k, j, 0};
+            }
+            _ranges[_rangeCount - 1].count++;
+        }
+    }
+
+    // t - секунды, не убывают. O(правил метрики); события - в out
+    uint8_t evaluate(uint16_t node, uint8_t metric, uint32_t t, float v, RuleEvent *out, uint8_t max) {
+        const Range *range = findRange(((uint32_t)node << 8) | metric);
+        if (!range || isnan(v)) return 0;
+        uint8_t events = 0;
+        for (uint8_t j = range->first; j < range->first + range->count; j++) {
+            uint8_t i = _order[j];
+            const RuleConfig &cfg = _configs[i];
+            State &st = _state[i];
+            float delta = 0;
+            bool over, clear;
+            if (cfg.kind == RULE_BELOW || cfg.kind == RULE_ABOVE) {
+                over = cfg.kind == RULE_BELOW ? v < cfg.threshold : v > cfg.threshold;
+                clear = cfg.kind == RULE_BELOW ? v > cfg.threshold + cfg.hysteresis
+                                               : v < cfg.threshold - cfg.hysteresis;
+            } else {
+                float old = rateSample(cfg, st, t, v);
+                if (isnan(old)) continue;
+                delta = v - old;
+                if (cfg.kind == RULE_SHIFT) {
+                    delta = fmodf(delta + 540.0f, 360.0f) - 180.0f;
+                    over = fabsf(delta) >= cfg.threshold;
+                    clear = fabsf(delta) < cfg.threshold - cfg.hysteresis;
+                } else if (cfg.kind == RULE_FALL) {
+                    over = -delta >= cfg.threshold;
+                    clear = -delta < cfg.threshold - cfg.hysteresis;
+                } else {
+                    over = delta >= cfg.threshold;
+                    clear = delta < cfg.threshold - cfg.hysteresis;
+                }
+            }
+            bool changed = false;
+            if (!st.active && over) st.active = changed = true;
+            else if (st.active && clear) { st.active = false; changed = true; }
+            if (changed && events < max) out[events++] = RuleEvent{i, st.active, v, delta};
+        }
+        return events;
+    }
+
+private:
+    struct State {
+        bool active;
+        uint8_t head;           // Следующий слот кольца
+        uint8_t filled;
+        uint32_t slot;          // Номер открытого слота: t / длина слота
+        float sum;
+        uint16_t samples;
+        float slots[RULE_RATE_SLOTS];
+    };
+
+    struct Range {
+        uint32_t key;
+        uint8_t first;
+        uint8_t count;
+    };
+
+    RuleConfig _configs[RULES_MAX];
+    State _state[RULES_MAX];
+    uint8_t _count;
+    uint8_t _order[RULES_MAX];
+    Range _ranges[RULES_MAX];
+    uint8_t _rangeCount;
+
+    static uint32_t key(const RuleConfig &cfg) { return ((uint32_t)cfg.node << 8) | cfg.metric; }
+
+    const Range *findRange(uint32_t k) const {
+        uint8_t lo = 0, hi = _rangeCount;
+        while (lo < hi) {
+            uint8_t mid = (lo + hi) / 2;
+            if (_ranges[mid].key < k) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo < _rangeCount && _ranges[lo].key == k ? &_ranges[lo] : nullptr;
+    }
+
+    void resetState(uint8_t i) {
+        State &st = _state[i];
+        st.active = false;
+        st.head = 0;
+        st.filled = 0;
+        st.slot = 0;
+        st.sum = 0;
+        st.samples = 0;
+    }
+
+    // Кладёт показание в открытый слот; возвращает значение окно назад или NAN
+    float rateSample(const RuleConfig &cfg, State &st, uint32_t t, float v) {
+        uint32_t slotLen = cfg.windowS / RULE_RATE_SLOTS;
+        if (slotLen == 0) slotLen = 1;
+        uint32_t slot = t / slotLen;
+        if (st.samples > 0 && slot != st.slot) {
+            if (slot < st.slot) return RULE_EMPTY;          // Время пошло назад
+            pushSlot(st, cfg.kind == RULE_SHIFT ? st.sum : st.sum / st.samples);
+            uint32_t gap = slot - st.slot - 1;
+            if (gap > RULE_RATE_SLOTS) gap = RULE_RATE_SLOTS;
+            while (gap-- > 0) pushSlot(st, RULE_EMPTY);
+            st.samples = 0;
+        }
+        if (st.samples == 0) {
+            st.slot = slot;
+            st.sum = 0;
+        }
+        if (cfg.kind == RULE_SHIFT) {
+            if (st.samples == 0) st.sum = v;
+        } else {
+            st.sum += v;
+        }
+        st.samples++;
+        // Самый старый слот кольца начался (RULE_RATE_SLOTS) слотов назад
+        if (st.filled < RULE_RATE_SLOTS) return RULE_EMPTY;
+        return st.slots[st.head];
+    }
+
+    static void pushSlot(State &st, float v) {
+        st.slots[st.head] = v;
+        st.head = (st.head + 1) % RULE_RATE_SLOTS;
+        if (st.filled < RULE_RATE_SLOTS) st.filled++;
+    }
+};
+
+#endif
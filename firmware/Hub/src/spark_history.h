@@ -0,0 +1,80 @@
+// spark_history.h - Суточные ряды для графиков на дисплее
+// SparkHistory копит показания в 30-минутной корзине и кладёт закрытые
+// средние в кольцо на 24 ч (48 точек, десятые доли) - O(1) на показание.
+// SparkSeries - копия ряда для снимка дисплея: точки от старой к новой и
+// номер новейшей корзины, по которому график понимает, сколько точек
+// добавилось с прошлого кадра.
+#ifndef SPARK_HISTORY_H
+#define SPARK_HISTORY_H
+
+#include <Arduino.h>
+#include "pressure_history.h"
+
+#define SPARK_POINTS        48              // 24 ч по 30 минут
+#define SPARK_SECONDS       1800
+#define SPARK_SCALE         10              // Десятые доли
+#define SPARK_EMPTY         INT16_MIN
+
+struct SparkSeries {
+    uint32_t newest;                        // t / SPARK_SECONDS новейшей точки; 0 - ряда нет
+    int16_t values[SPARK_POINTS];           // [SPARK_POINTS - 1] - новейшая
+};
+
+class SparkHistory {
+public:
+    void begin() {
+        _head = 0;
+        _count = 0;
+        _open = PhAccumulator{false, 0, 0, 0};
+    }
+
+    // t - секунды, не убывают; после перерыва кольцо добивается пустыми точками
+    void add(uint32_t t, float value) {
+        if (isnan(value)) return;
+        uint32_t index = t / SPARK_SECONDS;
+        if (_open.started && index != _open.index) {
+            if (index < _open.index) return;            // Время пошло назад
+            push(_open.mean());
+            uint32_t gap = index - _open.index - 1;
+            if (gap > SPARK_POINTS) gap = SPARK_POINTS;
+            while (gap-- > 0) push(SPARK_EMPTY);
+            _open.sum = 0;
+            _open.count = 0;
+        }
+        _open.started = true;
+        _open.index = index;
+        _open.sum += (int32_t)lroundf(value * SPARK_SCALE);
+        _open.count++;
+    }
+
+    void copy(SparkSeries &out) const {
+        out.newest = _count ? _open.index - 1 : 0;
+        for (uint8_t age = 0; age < SPARK_POINTS; age++) {
+            out.values[SPARK_POINTS - 1 - age] = age < _count ? _values[(_head + SPARK_POINTS - 1 - age) % SPARK_POINTS] : SPARK_EMPTY;
+        }
+    }
+
+private:
+    int16_t _values[SPARK_POINTS];
+    uint8_t _head;
+    uint8_t _count;
+    PhAccumulator _open;
+
+    void push(int32_t mean) {
+        _values[_head] = mean == PH_EMPTY ? SPARK_EMPTY : (int16_t)mean;
+        _head = (_head + 1) % SPARK_POINTS;
+        if (_count < SPARK_POINTS) _count++;
+    }
+};
+
+// 30-минутное кольцо PressureHistory (сотые доли) - в ряд графика
+inline void sparkFromCoarse(const PressureHistory &history, SparkSeries &out) {
+    const BucketRing<PH_COARSE_SIZE> &ring = history.coarse();
+    out.newest = ring.count() ? history.coarseNewest() : 0;
+    for (uint8_t age = 0; age < SPARK_POINTS; age++) {
+        int32_t v = ring.at(age);
+        out.values[SPARK_POINTS - 1 - age] = v == PH_EMPTY ? SPARK_EMPTY : (int16_t)((v + (v >= 0 ? 5 : -5)) / (PH_SCALE / SPARK_SCALE));
+    }
+}
+
+#endif
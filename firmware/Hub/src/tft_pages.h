@@ -0,0 +1,482 @@
+// tft_pages.h - Страницы дисплея хаба
+// Всё, что показывают страницы, приходит снимком DisplayState; HubDisplay
+// раскладывает его по виджетам и рисует изменившееся - полосами (GfxStrip)
+// или прямо в дисплей. От остальной прошивки страницы не зависят, поэтому
+// тот же код собирается на ПК эмулятором tools/tft_emu.
+#ifndef TFT_PAGES_H
+#define TFT_PAGES_H
+
+#include <Arduino.h>
+#include <Adafruit_ST7735.h>
+#include <Fonts/FreeMonoBold9pt7b.h>
+#include "tft_widgets.h"
+#include "forecast.h"
+#include "node_stats.h"
+
+// 1 - кадр собирается полосами в RAM и уходит в дисплей окнами;
+// 0 - виджеты рисуют прямо в дисплей (для сравнения времени кадра)
+#ifndef DISPLAY_STRIP_RENDER
+#define DISPLAY_STRIP_RENDER    1
+#endif
+
+#define WIDGET_COUNT(list) (sizeof(list) / sizeof(list[0]))
+
+#define DISPLAY_ALERT_COLS  23      // Знаков в строке тревог
+#define DISPLAY_ALERT_MAX   (DISPLAY_ALERT_COLS * 2 + 1)    // Байт UTF-8
+
+enum DisplayPage {
+    PAGE_WEATHER,
+    PAGE_NODE_INFO,
+    PAGE_GREENHOUSE,
+    PAGE_SD_MONITOR,
+    PAGE_COUNT
+};
+
+struct NodeDisplayData {
+    int id;
+    float temp;
+    float hum;
+    float press;
+    bool alarm;
+    bool led_state;
+    bool connected;
+    float wind_angle;
+    float wind_sector;
+    bool magnet;
+    bool contact1;
+    bool contact2;
+    float bmp_temp;
+};
+
+struct GreenhouseDisplayData {
+    float temp_in;
+    float temp_out;
+    int hum_in;
+    bool relay1;
+    bool relay2;
+};
+
+// Всё, что нужно для кадра
+struct DisplayState {
+    DisplayPage page;
+    int nodeIndex;
+    float temp;
+    float pressure;
+    float humidity;
+    WeatherIcon icon;
+    FrostRisk frost;
+    float windDirection;
+    bool windMagnet;
+    SparkSeries sparkTemp;      // Сутки метеостанции по 30 минут
+    SparkSeries sparkPress;
+    NodeDisplayData node;
+    RunningStats statsTemp;     // Суточная статистика показанного узла
+    RunningStats statsHum;
+    RunningStats statsPress;
+    uint32_t statsTime;
+    SparkSeries nodeSparkTemp;  // Сутки показанного узла
+    SparkSeries nodeSparkPress;
+    GreenhouseDisplayData greenhouse;
+    bool sdOk;
+    char sdType[8];
+    uint64_t sdTotalBytes;
+    uint64_t sdUsedBytes;
+    uint32_t sdWriteCount;
+    char sdError[32];
+    char sdFile[16];
+    char alert[DISPLAY_ALERT_MAX];
+    char clock[6];
+};
+
+struct DisplayStats {
+    uint32_t updates;       // Отрисовки, в которых что-то поменялось
+    uint32_t widgets;       // Перерисовано виджетов
+    uint32_t pixels;        // Отправлено пикселей всего
+    uint32_t lastPixels;
+    uint32_t maxPixels;
+    uint32_t pageSwitches;
+    uint32_t strips;        // Отправлено полос
+    uint32_t pageUs;        // Последняя полная отрисовка страницы
+    uint32_t maxPageUs;
+};
+
+class HubDisplay {
+public:
+    explicit HubDisplay(Adafruit_SPITFT &tft)
+        : stats(), _tft(tft), _gfx(tft), _stripRender(DISPLAY_STRIP_RENDER), _stripsFull(0),
+          _page(-1), _nodeIndex(-1) {
+        // Неизменные подписи задаются один раз
+        wwTempLabel.set("Темп: ");
+        wwPressLabel.set("Давление: ");
+        wwHumLabel.set("Влажность: ");
+        wwForecastLabel.set("Прогноз:");
+        wwFrostLabel.set("Заморозки: ");
+
+        wnHumLabel.set("Влажн.: ");
+        wnPressLabel.set("Давление: ");
+        wnTempLabel.set("Темп: ");
+        wnLedLabel.set("LED: ");
+
+        wgTempInLabel.set("Внутри: ");
+        wgTempOutLabel.set("Снаружи: ");
+        wgHumLabel.set("Влажн.: ");
+        wgRelay1Label.set("Реле 1:");
+        wgRelay2Label.set("Реле 2:");
+
+        wsSizeLabel.set("Объём: ");
+        wsUsedLabel.set("Занято: ");
+        wsFreeLabel.set("Свободно: ");
+        wsWritesLabel.set("Записей: ");
+        wsFileLabel.set("Файл: ");
+    }
+
+    DisplayStats stats;
+
+    // После setRotation() у дисплея
+    void sync() { _gfx.sync(); }
+    void setStripRender(bool on) { _stripRender = on; }
+    bool stripRender() const { return _stripRender; }
+
+    // Страница перерисовывается, если её пометили (бит 1 << page) или она
+    // сменилась; иначе - только верхний бар
+    void frame(const DisplayState &s, uint32_t flags) {
+        wClock.set(s.clock);
+        wAlert.set(s.alert);
+
+        bool entered = s.page != _page || (s.page == PAGE_NODE_INFO && s.nodeIndex != _nodeIndex);
+        if (!entered && !(flags & (1u << s.page))) {
+            render(nullptr, 0);
+            return;
+        }
+        uint32_t start = micros();
+        if (s.page == PAGE_WEATHER) weatherPage(s);
+        else if (s.page == PAGE_NODE_INFO) nodePage(s);
+        else if (s.page == PAGE_GREENHOUSE) greenhousePage(s);
+        else sdPage(s);
+
+        // Время отрисовки страницы целиком - для сравнения режимов
+        if (entered) {
+            uint32_t us = micros() - start;
+            stats.pageUs = us;
+            if (us > stats.maxPageUs) stats.maxPageUs = us;
+        }
+    }
+
+private:
+    Adafruit_SPITFT &_tft;
+    GfxCounter _gfx;            // Прямое рисование идёт через счётчик пикселей
+    GfxStrip _strip;
+    bool _stripRender;
+    uint8_t _stripsFull;        // Полосы, которые уходят целиком (смена страницы)
+    int _page;                  // Что сейчас размечено на экране; -1 - ничего
+    int _nodeIndex;
+
+    // Верхний бар и строка тревог - общие для всех страниц
+    TextWidget wTitle{12, 6, 14, ST77XX_CYAN};
+    FontTextWidget wClock{100, 0, 60, 18, 14, &FreeMonoBold9pt7b, ST77XX_CYAN};
+    TextWidget wAlert{18, 23, DISPLAY_ALERT_COLS, ST77XX_MAGENTA};
+    LineWidget wSeparator{0, 18, 160, ST77XX_CYAN};
+    Widget *const _header[4] = {&wTitle, &wClock, &wAlert, &wSeparator};
+
+    // Метеостанция
+    TextWidget wwTempLabel{5, 35, 6, ST77XX_WHITE};
+    TextWidget wwTemp{41, 35, 8, ST77XX_YELLOW};
+    TextWidget wwPressLabel{5, 50, 10, ST77XX_WHITE};
+    TextWidget wwPress{65, 50, 7, ST77XX_CYAN};
+    TextWidget wwHumLabel{5, 65, 11, ST77XX_WHITE};
+    TextWidget wwHum{71, 65, 4, ST77XX_GREEN};
+    TextWidget wwForecastLabel{5, 80, 8, ST77XX_WHITE};
+    TextWidget wwForecast{60, 80, 9, ST77XX_CYAN};     // До компаса
+    TextWidget wwFrostLabel{5, 100, 11, ST77XX_WHITE};
+    TextWidget wwFrost{71, 100, 4, ST77XX_YELLOW};
+    CompassWidget wwCompass{134, 100, 18, ST77XX_WHITE, ST77XX_BLUE, ST77XX_BLACK};
+    // Графики справа от строк, каждый - ровно одна полоса: 1 °C и 1 мм на шаг шкалы
+    SparkWidget wwTempSpark{112, 32, 16, ST77XX_YELLOW, 10, 40};
+    SparkWidget wwPressSpark{112, 48, 16, ST77XX_CYAN, 10, 20};
+    Widget *const _weather[13] = {
+        &wwTempLabel, &wwTemp, &wwPressLabel, &wwPress, &wwHumLabel, &wwHum,
+        &wwForecastLabel, &wwForecast, &wwFrostLabel, &wwFrost, &wwCompass,
+        &wwTempSpark, &wwPressSpark
+    };
+
+    // Узел: строки через 10 пикселей, внизу - суточные диапазоны
+    TextWidget wnTempLabel{5, 32, 6, ST77XX_WHITE};
+    TextWidget wnTemp{41, 32, 8, ST77XX_YELLOW};
+    TextWidget wnHumLabel{5, 42, 8, ST77XX_WHITE};
+    TextWidget wnHum{53, 42, 4, ST77XX_GREEN};
+    TextWidget wnPressLabel{5, 52, 10, ST77XX_WHITE};
+    TextWidget wnPress{65, 52, 7, ST77XX_CYAN};
+    TextWidget wnLedLabel{5, 62, 5, ST77XX_WHITE};
+    TextWidget wnLed{35, 62, 4, ST77XX_GREEN};
+    TextWidget wnContact1Label{5, 72, 8, ST77XX_WHITE};
+    TextWidget wnContact1{53, 72, 9, ST77XX_GREEN};
+    TextWidget wnContact2Label{5, 82, 8, ST77XX_WHITE};
+    TextWidget wnContact2{53, 82, 9, ST77XX_GREEN};
+    TextWidget wnMagnetLabel{5, 92, 8, ST77XX_WHITE};
+    TextWidget wnMagnet{53, 92, 3, ST77XX_GREEN};
+    TextWidget wnTempRange{5, 106, 25, ST77XX_YELLOW};
+    TextWidget wnRanges{5, 116, 25, ST77XX_CYAN};
+    SparkWidget wnTempSpark{112, 32, 16, ST77XX_YELLOW, 10, 40};
+    SparkWidget wnPressSpark{112, 48, 16, ST77XX_CYAN, 10, 20};
+    Widget *const _node[18] = {
+        &wnTempLabel, &wnTemp, &wnHumLabel, &wnHum, &wnPressLabel, &wnPress, &wnLedLabel, &wnLed,
+        &wnContact1Label, &wnContact1, &wnContact2Label, &wnContact2, &wnMagnetLabel, &wnMagnet,
+        &wnTempRange, &wnRanges, &wnTempSpark, &wnPressSpark
+    };
+
+    // Теплица
+    TextWidget wgTempInLabel{5, 35, 9, ST77XX_WHITE};
+    TextWidget wgTempIn{59, 35, 8, ST77XX_YELLOW};
+    TextWidget wgTempOutLabel{5, 50, 10, ST77XX_WHITE};
+    TextWidget wgTempOut{65, 50, 8, ST77XX_CYAN};
+    TextWidget wgHumLabel{5, 65, 8, ST77XX_WHITE};
+    TextWidget wgHum{53, 65, 4, ST77XX_GREEN};
+    TextWidget wgRelay1Label{5, 85, 8, ST77XX_WHITE};
+    DotWidget wgRelay1{60, 88, 4, ST77XX_BLUE};
+    TextWidget wgRelay2Label{90, 85, 8, ST77XX_WHITE};
+    DotWidget wgRelay2{145, 88, 4, ST77XX_BLUE};
+    Widget *const _greenhouse[10] = {
+        &wgTempInLabel, &wgTempIn, &wgTempOutLabel, &wgTempOut, &wgHumLabel, &wgHum,
+        &wgRelay1Label, &wgRelay1, &wgRelay2Label, &wgRelay2
+    };
+
+    // SD-карта
+    TextWidget wsTypeLabel{5, 35, 9, ST77XX_CYAN};
+    TextWidget wsType{59, 35, 16, ST77XX_WHITE};
+    TextWidget wsSizeLabel{5, 47, 8, ST77XX_CYAN};
+    TextWidget wsSize{53, 47, 10, ST77XX_WHITE};
+    TextWidget wsUsedLabel{5, 59, 9, ST77XX_CYAN};
+    TextWidget wsUsed{59, 59, 10, ST77XX_YELLOW};
+    TextWidget wsFreeLabel{5, 71, 10, ST77XX_CYAN};
+    TextWidget wsFree{65, 71, 10, ST77XX_GREEN};
+    TextWidget wsWritesLabel{5, 89, 9, ST77XX_CYAN};
+    TextWidget wsWrites{59, 89, 10, ST77XX_WHITE};
+    TextWidget wsFileLabel{5, 104, 6, ST77XX_CYAN};
+    TextWidget wsFile{41, 104, 19, ST77XX_WHITE};
+    Widget *const _sd[12] = {
+        &wsTypeLabel, &wsType, &wsSizeLabel, &wsSize, &wsUsedLabel, &wsUsed,
+        &wsFreeLabel, &wsFree, &wsWritesLabel, &wsWrites, &wsFileLabel, &wsFile
+    };
+
+    // ---------- Страницы ----------
+    // Каждая страница переносит значения снимка в свои виджеты и рисует
+    // только изменившиеся; очистка области - лишь при смене страницы
+
+    void weatherPage(const DisplayState &s) {
+        enterPage(s, _weather, WIDGET_COUNT(_weather));
+        wTitle.set("МЕТЕОСТАНЦИЯ");
+
+        wwTemp.setValue(s.temp, 1, "°C");
+        wwPress.setValue(s.pressure, 1, "мм");
+        wwHum.setValue(s.humidity, 0, "%");
+        wwForecast.set(s.pressure > 0 ? ICON_TFT[s.icon] : "");
+        wwFrost.set(FROST_TEXT[s.frost]);
+        wwCompass.set(s.windDirection, s.windMagnet);
+        wwTempSpark.set(s.sparkTemp);
+        wwPressSpark.set(s.sparkPress);
+
+        render(_weather, WIDGET_COUNT(_weather));
+    }
+
+    void nodePage(const DisplayState &s) {
+        enterPage(s, _node, WIDGET_COUNT(_node));
+
+        const NodeDisplayData &node = s.node;
+        char text[WIDGET_TEXT_MAX];
+        snprintf(text, sizeof(text), "УЗЕЛ #%d %d/4", node.id, s.nodeIndex + 1);
+        wTitle.set(text);
+
+        wnTempLabel.setColor(node.connected ? ST77XX_WHITE : ST77XX_BLUE);
+        wnTemp.setValue(node.temp, 1, "°C");
+        wnHum.setValue(node.hum, 0, "%");
+        wnPress.setValue(node.press, 1, "мм");
+        wnTempSpark.set(s.nodeSparkTemp);
+        wnPressSpark.set(s.nodeSparkPress);
+        wnLed.set(node.led_state ? "ВКЛ" : "ВЫКЛ");
+        wnLed.setColor(node.led_state ? ST77XX_BLUE : ST77XX_GREEN);
+
+        // Контакты и магнит есть только у узла 102
+        bool full = node.id == 102;
+        wnContact1Label.set(full ? "Конт1: " : "");
+        wnContact1.set(full ? (node.contact1 ? "РАЗОМКНУТ" : "ЗАМКНУТ") : "");
+        wnContact1.setColor(node.contact1 ? ST77XX_BLUE : ST77XX_GREEN);
+        wnContact2Label.set(full ? "Конт2: " : "");
+        wnContact2.set(full ? (node.contact2 ? "РАЗОМКНУТ" : "ЗАМКНУТ") : "");
+        wnContact2.setColor(node.contact2 ? ST77XX_BLUE : ST77XX_GREEN);
+        wnMagnetLabel.set(full ? "Магнит: " : "");
+        wnMagnet.set(full ? (node.magnet ? "ДА" : "НЕТ") : "");
+        wnMagnet.setColor(node.magnet ? ST77XX_GREEN : ST77XX_BLUE);
+
+        // Суточные min..max и разброс температуры
+        uint32_t t = s.statsTime;
+        const RunningStats &ts = s.statsTemp;
+        const RunningStats &hs = s.statsHum;
+        const RunningStats &ps = s.statsPress;
+        text[0] = '\0';
+        if (ts.current(t)) snprintf(text, sizeof(text), "T: %.1f..%.1f s%.1f", ts.min, ts.max, ts.stddev());
+        wnTempRange.set(text);
+        size_t len = 0;
+        text[0] = '\0';
+        if (hs.current(t)) len += snprintf(text, sizeof(text), "H: %.0f..%.0f%% ", hs.min, hs.max);
+        if (ps.current(t)) snprintf(text + len, sizeof(text) - len, "P: %.0f..%.0f", ps.min, ps.max);
+        wnRanges.set(text);
+
+        render(_node, WIDGET_COUNT(_node));
+    }
+
+    void greenhousePage(const DisplayState &s) {
+        enterPage(s, _greenhouse, WIDGET_COUNT(_greenhouse));
+        wTitle.set("ТЕПЛИЦА");
+
+        wgTempIn.setValue(s.greenhouse.temp_in, 1, "°C");
+        wgTempOut.setValue(s.greenhouse.temp_out, 1, "°C");
+        wgHum.setValue(s.greenhouse.hum_in, 0, "%");
+        wgRelay1.set(s.greenhouse.relay1 ? ST77XX_GREEN : ST77XX_BLUE);
+        wgRelay2.set(s.greenhouse.relay2 ? ST77XX_GREEN : ST77XX_BLUE);
+
+        render(_greenhouse, WIDGET_COUNT(_greenhouse));
+    }
+
+    void sdPage(const DisplayState &s) {
+        enterPage(s, _sd, WIDGET_COUNT(_sd));
+        wTitle.set("SD КАРТА");
+
+        char text[WIDGET_TEXT_MAX];
+        if (!s.sdOk) {
+            // Ошибка - в первой строке, остальные пустые
+            wsTypeLabel.set("ОШИБКА: ");
+            wsTypeLabel.setColor(ST77XX_BLUE);
+            wsType.set(s.sdError);
+            wsType.setColor(ST77XX_BLUE);
+            wsSize.set("");
+            wsUsed.set("");
+            wsFree.set("");
+            wsWrites.set("");
+            wsFile.set("");
+        } else {
+            wsTypeLabel.set("Тип: ");
+            wsTypeLabel.setColor(ST77XX_CYAN);
+            wsType.setColor(ST77XX_WHITE);
+            wsType.set(s.sdType);
+            snprintf(text, sizeof(text), "%lu МБ", (unsigned long)(s.sdTotalBytes / (1024 * 1024)));
+            wsSize.set(text);
+            snprintf(text, sizeof(text), "%lu МБ", (unsigned long)(s.sdUsedBytes / (1024 * 1024)));
+            wsUsed.set(text);
+            snprintf(text, sizeof(text), "%lu МБ", (unsigned long)((s.sdTotalBytes - s.sdUsedBytes) / (1024 * 1024)));
+            wsFree.set(text);
+            snprintf(text, sizeof(text), "%lu", (unsigned long)s.sdWriteCount);
+            wsWrites.set(text);
+            wsFile.set(s.sdFile);
+        }
+        // Подписи строк без данных гаснут вместе с ними
+        wsSizeLabel.setColor(s.sdOk ? ST77XX_CYAN : ST77XX_BLACK);
+        wsUsedLabel.setColor(s.sdOk ? ST77XX_CYAN : ST77XX_BLACK);
+        wsFreeLabel.setColor(s.sdOk ? ST77XX_CYAN : ST77XX_BLACK);
+        wsWritesLabel.setColor(s.sdOk ? ST77XX_CYAN : ST77XX_BLACK);
+        wsFileLabel.setColor(s.sdOk ? ST77XX_CYAN : ST77XX_BLACK);
+
+        render(_sd, WIDGET_COUNT(_sd));
+    }
+
+    // ---------- Отрисовка ----------
+
+    // Смена страницы (или узла на странице узла): очистка области и полная
+    // перерисовка её виджетов. true - страница размечена заново
+    bool enterPage(const DisplayState &s, Widget *const *widgets, uint8_t count) {
+        if (_page == s.page && (s.page != PAGE_NODE_INFO || _nodeIndex == s.nodeIndex)) return false;
+        _page = s.page;
+        _nodeIndex = s.nodeIndex;
+        stats.pageSwitches++;
+
+        if (_stripRender) {
+            // Полосы области страницы собираются с чёрного фона целиком
+            for (uint8_t strip = 31 / GFX_STRIP_H; strip < GFX_STRIP_COUNT; strip++) _stripsFull |= 1 << strip;
+        } else {
+            uint32_t before = _gfx.pixels();
+            _gfx.fillRect(0, 31, 160, 97, ST77XX_BLACK);
+            stats.pixels += _gfx.pixels() - before;
+        }
+        for (uint8_t i = 0; i < count; i++) widgets[i]->invalidate();
+        return true;
+    }
+
+    // Рисует только грязные виджеты верхнего бара и страницы
+    void render(Widget *const *widgets, uint8_t count) {
+        uint32_t pixels = 0;
+        uint16_t drawn = 0;
+        if (_stripRender) {
+            drawn = renderStrips(widgets, count, &pixels);
+        } else {
+            uint32_t before = _gfx.pixels();
+            for (uint8_t i = 0; i < WIDGET_COUNT(_header); i++) {
+                if (_header[i]->render(_gfx)) drawn++;
+            }
+            for (uint8_t i = 0; i < count; i++) {
+                if (widgets[i]->render(_gfx)) drawn++;
+            }
+            pixels = _gfx.pixels() - before;
+        }
+        if (drawn == 0) return;
+        stats.updates++;
+        stats.widgets += drawn;
+        stats.pixels += pixels;
+        stats.lastPixels = pixels;
+        if (pixels > stats.maxPixels) stats.maxPixels = pixels;
+    }
+
+    // Грязные виджеты (их dirtyBox) задают полосы, столбцы и строки для отправки.
+    // Полоса собирается со всеми задевающими её виджетами - чистые рисуются
+    // заново поверх фона, но уходит только прямоугольник, покрывающий грязные
+    uint16_t renderStrips(Widget *const *widgets, uint8_t count, uint32_t *pixels) {
+        Widget *const *lists[2] = {_header, widgets};
+        uint8_t counts[2] = {(uint8_t)WIDGET_COUNT(_header), count};
+        int16_t from[GFX_STRIP_COUNT], to[GFX_STRIP_COUNT];
+        int16_t rowFrom[GFX_STRIP_COUNT], rowTo[GFX_STRIP_COUNT];     // Строки внутри полосы
+        for (uint8_t strip = 0; strip < GFX_STRIP_COUNT; strip++) {
+            bool full = _stripsFull & (1 << strip);
+            from[strip] = full ? 0 : GFX_STRIP_W;
+            to[strip] = full ? GFX_STRIP_W : 0;
+            rowFrom[strip] = full ? 0 : GFX_STRIP_H;
+            rowTo[strip] = full ? GFX_STRIP_H : 0;
+        }
+        _stripsFull = 0;
+
+        uint16_t drawn = 0;
+        for (uint8_t l = 0; l < 2; l++) {
+            for (uint8_t i = 0; i < counts[l]; i++) {
+                if (!lists[l][i]->dirty()) continue;
+                drawn++;
+                WidgetBox b = lists[l][i]->dirtyBox();
+                int16_t x1 = max(b.x, (int16_t)0), x2 = min((int16_t)(b.x + b.w), (int16_t)GFX_STRIP_W);
+                for (uint8_t strip = 0; strip < GFX_STRIP_COUNT; strip++) {
+                    int16_t top = strip * GFX_STRIP_H;
+                    if (!b.crosses(top, GFX_STRIP_H)) continue;
+                    from[strip] = min(from[strip], x1);
+                    to[strip] = max(to[strip], x2);
+                    rowFrom[strip] = min(rowFrom[strip], (int16_t)max(b.y - top, 0));
+                    rowTo[strip] = max(rowTo[strip], (int16_t)min(b.y + b.h - top, GFX_STRIP_H));
+                }
+            }
+        }
+
+        *pixels = 0;
+        for (uint8_t strip = 0; strip < GFX_STRIP_COUNT; strip++) {
+            if (to[strip] <= from[strip]) continue;
+            _strip.begin(strip, ST77XX_BLACK);
+            for (uint8_t l = 0; l < 2; l++) {
+                for (uint8_t i = 0; i < counts[l]; i++) {
+                    if (lists[l][i]->box().crosses(_strip.top(), GFX_STRIP_H)) lists[l][i]->paint(_strip);
+                }
+            }
+            *pixels += _strip.push(_tft, from[strip], to[strip] - from[strip],
+                                   rowFrom[strip], rowTo[strip] - rowFrom[strip]);
+            stats.strips++;
+        }
+        for (uint8_t l = 0; l < 2; l++) {
+            for (uint8_t i = 0; i < counts[l]; i++) lists[l][i]->clean();
+        }
+        return drawn;
+    }
+};
+
+#endif
@@ -0,0 +1,90 @@
+// tft_text.h - Текст UTF-8 шрифтом хаба 6x8 (латиница и кириллица)
+// Строки в коде - UTF-8: utf8Next() разбирает их по знакам, знак шрифта
+// находится таблицами hub_font.h за O(1). Знак рисуется горизонтальными
+// отрезками закрашенных точек: одно окно дисплея на отрезок вместо окна
+// на каждую точку, как у drawChar() библиотеки. Знака нет в шрифте - '?'.
+#ifndef TFT_TEXT_H
+#define TFT_TEXT_H
+
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+#include "hub_font.h"
+
+#define UTF8_REPLACEMENT    0xFFFD
+
+// Следующий знак; s сдвигается за него. Битая последовательность - один байт
+// и UTF8_REPLACEMENT
+inline uint32_t utf8Next(const char *&s) {
+    uint8_t c = *s++;
+    if (c < 0x80) return c;
+    uint8_t extra = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : 0;
+    if (extra == 0 || c >= 0xF8) return UTF8_REPLACEMENT;
+    uint32_t cp = c & (0x3F >> extra);
+    for (uint8_t i = 0; i < extra; i++) {
+        if (((uint8_t)s[i] & 0xC0) != 0x80) return UTF8_REPLACEMENT;
+        cp = (cp << 6) | ((uint8_t)s[i] & 0x3F);
+    }
+    s += extra;
+    return cp;
+}
+
+// Число знаков (не байт)
+inline uint16_t utf8Length(const char *s) {
+    uint16_t n = 0;
+    while (*s) {
+        utf8Next(s);
+        n++;
+    }
+    return n;
+}
+
+// Байт в первых cols знаках: обрезка строки без разрыва знака
+inline size_t utf8Prefix(const char *s, uint16_t cols) {
+    const char *p = s;
+    while (cols-- > 0 && *p) utf8Next(p);
+    return p - s;
+}
+
+inline const GFXglyph *tftGlyph(uint32_t cp) {
+    uint32_t page = cp >> HUB_FONT_PAGE_BITS;
+    uint8_t index = HUB_FONT_MISSING;
+    if (page < HUB_FONT_PAGE_COUNT && HubFontPages[page]) {
+        index = HubFontPages[page][cp & ((1 << HUB_FONT_PAGE_BITS) - 1)];
+    }
+    if (index == HUB_FONT_MISSING) index = '?' - 0x20;
+    return &HubFont6x8Glyphs[index];
+}
+
+// Знак в клетке с левым верхним углом (x, y)
+inline void tftGlyphDraw(Adafruit_GFX &gfx, int16_t x, int16_t y, const GFXglyph *g, uint16_t color) {
+    const uint8_t *bits = HubFont6x8Bitmaps + g->bitmapOffset;
+    int16_t top = y + HUB_FONT_BASELINE + g->yOffset;
+    int16_t left = x + g->xOffset;
+    uint16_t bit = 0;
+    for (uint8_t row = 0; row < g->height; row++) {
+        int8_t run = -1;
+        for (uint8_t col = 0; col <= g->width; col++, bit++) {
+            bool on = col < g->width && (bits[bit >> 3] & (0x80 >> (bit & 7)));
+            if (on && run < 0) run = col;
+            if (!on && run >= 0) {
+                gfx.writeFastHLine(left + run, top + row, col - run, color);
+                run = -1;
+            }
+        }
+        bit--;  // Столбец-ограничитель не занимает бит
+    }
+}
+
+// Строка без фона (фон - забота вызывающего). Возвращает число знаков
+inline uint16_t tftText(Adafruit_GFX &gfx, int16_t x, int16_t y, const char *text, uint16_t color) {
+    uint16_t n = 0;
+    gfx.startWrite();
+    while (*text) {
+        tftGlyphDraw(gfx, x + n * HUB_FONT_ADVANCE, y, tftGlyph(utf8Next(text)), color);
+        n++;
+    }
+    gfx.endWrite();
+    return n;
+}
+
+#endif
@@ -0,0 +1,609 @@
+// tft_widgets.h - Виджеты дисплея с перерисовкой только изменившегося
+// Виджет помнит, что нарисовал в прошлый раз: set() с тем же значением
+// ничего не делает, с другим - помечает виджет грязным. render() рисует
+// только грязные. Текст (UTF-8, шрифт хаба из tft_text.h) рисуется поверх
+// фона, залитого одним fillRect на клетки нового и прежнего текста.
+//
+// GfxCounter - прокси Adafruit_GFX: примитивы библиотеки раскладываются
+// в writePixel/writeFillRect/writeFast*Line, прокси считает отправленные
+// пиксели (с учётом обрезки по экрану) и передаёт их настоящему дисплею.
+//
+// GfxStrip - полоса экрана в RAM (160x16 RGB565, 5 КБ). Виджеты рисуют в неё
+// в экранных координатах, всё вне полосы отсекается; готовая полоса уходит
+// в дисплей одним окном setAddrWindow и сплошным потоком пикселей вместо
+// отдельной транзакции на каждый пиксель символа.
+//
+// SparkWidget - суточный график столбцами: столбец x показывает точку из
+// ячейки x кольца, новая точка пишется поверх самой старой, за ней - пустой
+// столбец-разрыв. Новая точка - два столбца, остальные не трогаются.
+#ifndef TFT_WIDGETS_H
+#define TFT_WIDGETS_H
+
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+#include <Adafruit_SPITFT.h>
+#include "tft_text.h"
+#include "trig_q14.h"
+#include "spark_history.h"
+
+#define WIDGET_TEXT_COLS    26      // 160 / 6 знаков шрифта
+#define WIDGET_TEXT_MAX     (WIDGET_TEXT_COLS * 2 + 1)  // Байт UTF-8: кириллица - по 2
+#define WIDGET_CHAR_W       HUB_FONT_ADVANCE
+#define WIDGET_CHAR_H       HUB_FONT_HEIGHT
+
+#define GFX_STRIP_W         160
+#define GFX_STRIP_H         16
+#define GFX_STRIP_COUNT     8       // 128 строк экрана
+
+class GfxCounter : public Adafruit_GFX {
+public:
+    explicit GfxCounter(Adafruit_GFX &out) : Adafruit_GFX(out.width(), out.height()), _out(&out), _pixels(0) {}
+
+    // После setRotation() у дисплея - размеры для обрезки
+    void sync() {
+        _width = _out->width();
+        _height = _out->height();
+    }
+
+    uint32_t pixels() const { return _pixels; }
+    void resetPixels() { _pixels = 0; }
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override {
+        _pixels += area(x, y, 1, 1);
+        _out->drawPixel(x, y, color);
+    }
+    void startWrite() override { _out->startWrite(); }
+    void writePixel(int16_t x, int16_t y, uint16_t color) override {
+        _pixels += area(x, y, 1, 1);
+        _out->writePixel(x, y, color);
+    }
+    void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override {
+        _pixels += area(x, y, w, h);
+        _out->writeFillRect(x, y, w, h, color);
+    }
+    void writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override {
+        _pixels += area(x, y, 1, h);
+        _out->writeFastVLine(x, y, h, color);
+    }
+    void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override {
+        _pixels += area(x, y, w, 1);
+        _out->writeFastHLine(x, y, w, color);
+    }
+    void endWrite() override { _out->endWrite(); }
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override {
+        _pixels += area(x, y, 1, h);
+        _out->drawFastVLine(x, y, h, color);
+    }
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override {
+        _pixels += area(x, y, w, 1);
+        _out->drawFastHLine(x, y, w, color);
+    }
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override {
+        _pixels += area(x, y, w, h);
+        _out->fillRect(x, y, w, h, color);
+    }
+    void fillScreen(uint16_t color) override {
+        _pixels += (uint32_t)_width * _height;
+        _out->fillScreen(color);
+    }
+
+private:
+    Adafruit_GFX *_out;
+    uint32_t _pixels;
+
+    uint32_t area(int32_t x, int32_t y, int32_t w, int32_t h) const {
+        if (w < 0) { x += w + 1; w = -w; }
+        if (h < 0) { y += h + 1; h = -h; }
+        int32_t x1 = max(x, (int32_t)0), y1 = max(y, (int32_t)0);
+        int32_t x2 = min(x + w, (int32_t)_width), y2 = min(y + h, (int32_t)_height);
+        return x2 > x1 && y2 > y1 ? (uint32_t)(x2 - x1) * (y2 - y1) : 0;
+    }
+};
+
+// Полоса экрана: прямоугольник в экранных координатах, строки [top, top + 16)
+class GfxStrip : public Adafruit_GFX {
+public:
+    GfxStrip() : Adafruit_GFX(GFX_STRIP_W, GFX_STRIP_H * GFX_STRIP_COUNT), _top(0) {}
+
+    void begin(uint8_t strip, uint16_t bg) {
+        _top = strip * GFX_STRIP_H;
+        for (uint16_t i = 0; i < GFX_STRIP_W * GFX_STRIP_H; i++) _buf[i] = bg;
+    }
+    int16_t top() const { return _top; }
+
+    // Столбцы [x, x + w) строк [row, row + rows) полосы - одним окном;
+    // возвращает число пикселей
+    uint32_t push(Adafruit_SPITFT &tft, int16_t x, int16_t w, int16_t row, int16_t rows) {
+        tft.startWrite();
+        tft.setAddrWindow(x, _top + row, w, rows);
+        if (w == GFX_STRIP_W) {
+            tft.writePixels(&_buf[row * GFX_STRIP_W], GFX_STRIP_W * rows);
+        } else {
+            for (int16_t r = row; r < row + rows; r++) tft.writePixels(&_buf[r * GFX_STRIP_W + x], w);
+        }
+        tft.endWrite();
+        return (uint32_t)w * rows;
+    }
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override {
+        if (x < 0 || x >= GFX_STRIP_W || y < _top || y >= _top + GFX_STRIP_H) return;
+        _buf[(y - _top) * GFX_STRIP_W + x] = color;
+    }
+    void writePixel(int16_t x, int16_t y, uint16_t color) override { drawPixel(x, y, color); }
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override {
+        if (w < 0) { x += w + 1; w = -w; }
+        if (h < 0) { y += h + 1; h = -h; }
+        int16_t x1 = max(x, (int16_t)0), x2 = min((int16_t)(x + w), (int16_t)GFX_STRIP_W);
+        int16_t y1 = max(y, _top), y2 = min((int16_t)(y + h), (int16_t)(_top + GFX_STRIP_H));
+        for (int16_t row = y1; row < y2; row++) {
+            uint16_t *p = &_buf[(row - _top) * GFX_STRIP_W];
+            for (int16_t col = x1; col < x2; col++) p[col] = color;
+        }
+    }
+    void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override { fillRect(x, y, w, h, color); }
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override { fillRect(x, y, 1, h, color); }
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override { fillRect(x, y, w, 1, color); }
+    void writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override { fillRect(x, y, 1, h, color); }
+    void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override { fillRect(x, y, w, 1, color); }
+    void fillScreen(uint16_t color) override { fillRect(0, _top, GFX_STRIP_W, GFX_STRIP_H, color); }
+
+private:
+    int16_t _top;
+    uint16_t _buf[GFX_STRIP_W * GFX_STRIP_H];
+};
+
+struct WidgetBox {
+    int16_t x, y, w, h;
+
+    bool crosses(int16_t top, int16_t rows) const { return y < top + rows && y + h > top; }
+    bool empty() const { return w <= 0 || h <= 0; }
+};
+
+// Наименьший прямоугольник, покрывающий оба
+inline WidgetBox widgetUnion(const WidgetBox &a, const WidgetBox &b) {
+    if (a.empty()) return b;
+    if (b.empty()) return a;
+    int16_t x1 = min(a.x, b.x), y1 = min(a.y, b.y);
+    int16_t x2 = max(a.x + a.w, b.x + b.w), y2 = max(a.y + a.h, b.y + b.h);
+    return WidgetBox{x1, y1, (int16_t)(x2 - x1), (int16_t)(y2 - y1)};
+}
+
+class Widget {
+public:
+    Widget() : _dirty(true) {}
+    virtual ~Widget() {}
+
+    // Экран под виджетом потерян (смена страницы) - рисовать целиком
+    virtual void invalidate() { _dirty = true; }
+    bool dirty() const { return _dirty; }
+
+    // true - виджет перерисован
+    bool render(Adafruit_GFX &gfx) {
+        if (!_dirty) return false;
+        _dirty = false;
+        update(gfx);
+        return true;
+    }
+
+    // Для полос: виджет, задевающий собираемую полосу, рисуется в неё
+    // целиком, грязный он или нет; флаг снимается после отправки всех полос
+    void paint(Adafruit_GFX &gfx) { draw(gfx); }
+    void clean() { _dirty = false; }
+
+    // Всё, что виджет может закрасить
+    virtual WidgetBox box() const = 0;
+    // Что изменится при следующей отрисовке грязного виджета
+    virtual WidgetBox dirtyBox() const { return box(); }
+
+protected:
+    bool _dirty;
+    virtual void draw(Adafruit_GFX &gfx) = 0;
+    // Отрисовка поверх прежней картинки виджета; по умолчанию - целиком
+    virtual void update(Adafruit_GFX &gfx) { draw(gfx); }
+};
+
+// Неизменная горизонтальная линия (разделитель под верхним баром)
+class LineWidget : public Widget {
+public:
+    LineWidget(int16_t x, int16_t y, int16_t w, uint16_t color) : _x(x), _y(y), _w(w), _color(color) {}
+
+    WidgetBox box() const override { return WidgetBox{_x, _y, _w, 1}; }
+
+protected:
+    void draw(Adafruit_GFX &gfx) override { gfx.drawFastHLine(_x, _y, _w, _color); }
+
+private:
+    int16_t _x, _y, _w;
+    uint16_t _color;
+};
+
+// Строка шрифта 6x8 в поле из cols знаков
+class TextWidget : public Widget {
+public:
+    TextWidget(int16_t x, int16_t y, uint8_t cols, uint16_t fg, uint16_t bg = 0)
+        : _x(x), _y(y), _cols(min(cols, (uint8_t)WIDGET_TEXT_COLS)), _fg(fg), _bg(bg), _drawnLen(0) {
+        _text[0] = '\0';
+    }
+
+    void set(const char *text) {
+        size_t n = utf8Prefix(text, _cols);
+        if (strncmp(text, _text, n) == 0 && _text[n] == '\0') return;
+        memcpy(_text, text, n);
+        _text[n] = '\0';
+        _dirty = true;
+    }
+
+    void setColor(uint16_t fg) {
+        if (fg == _fg) return;
+        _fg = fg;
+        _dirty = true;
+    }
+
+    void setValue(float v, uint8_t decimals, const char *suffix) {
+        char buf[WIDGET_TEXT_MAX];
+        snprintf(buf, sizeof(buf), "%.*f%s", decimals, v, suffix);
+        set(buf);
+    }
+
+    WidgetBox box() const override { return WidgetBox{_x, _y, (int16_t)(_cols * WIDGET_CHAR_W), WIDGET_CHAR_H}; }
+
+    // Меняются только знаки новой строки и хвост прежней, а не всё поле
+    WidgetBox dirtyBox() const override {
+        uint8_t cells = max((uint8_t)utf8Length(_text), _drawnLen);
+        return WidgetBox{_x, _y, (int16_t)(cells * WIDGET_CHAR_W), WIDGET_CHAR_H};
+    }
+
+protected:
+    void draw(Adafruit_GFX &gfx) override {
+        uint8_t len = utf8Length(_text);
+        gfx.fillRect(_x, _y, max(len, _drawnLen) * WIDGET_CHAR_W, WIDGET_CHAR_H, _bg);
+        tftText(gfx, _x, _y, _text, _fg);
+        _drawnLen = len;
+    }
+
+private:
+    int16_t _x, _y;
+    uint8_t _cols;
+    uint16_t _fg, _bg;
+    uint8_t _drawnLen;      // Знаков на экране
+    char _text[WIDGET_TEXT_MAX];
+};
+
+// Текст шрифтом GFXfont: у таких шрифтов нет фона символа, поле заливается целиком
+class FontTextWidget : public Widget {
+public:
+    FontTextWidget(int16_t x, int16_t y, int16_t w, int16_t h, int16_t baseline,
+                   const GFXfont *font, uint16_t fg, uint16_t bg = 0)
+        : _x(x), _y(y), _w(w), _h(h), _baseline(baseline), _font(font), _fg(fg), _bg(bg), _inkDrawn(false) {
+        _text[0] = '\0';
+    }
+
+    void set(const char *text) {
+        if (strcmp(text, _text) == 0) return;
+        strncpy(_text, text, sizeof(_text) - 1);
+        _text[sizeof(_text) - 1] = '\0';
+        _dirty = true;
+    }
+
+    void invalidate() override {
+        Widget::invalidate();
+        _inkDrawn = false;
+    }
+
+    WidgetBox box() const override { return WidgetBox{_x, _y, _w, _h}; }
+
+    // Поле заливается целиком, но меняются лишь пиксели прежнего и нового текста
+    WidgetBox dirtyBox() const override {
+        if (!_inkDrawn) return box();
+        return widgetUnion(_ink, inkBox(_text));
+    }
+
+protected:
+    void draw(Adafruit_GFX &gfx) override {
+        gfx.fillRect(_x, _y, _w, _h, _bg);
+        gfx.setFont(_font);
+        gfx.setTextColor(_fg);
+        gfx.setCursor(_x, _y + _baseline);
+        gfx.print(_text);
+        gfx.setFont();
+        _ink = inkBox(_text);
+        _inkDrawn = true;
+    }
+
+private:
+    int16_t _x, _y, _w, _h, _baseline;
+    const GFXfont *_font;
+    uint16_t _fg, _bg;
+    bool _inkDrawn;         // _ink - то, что сейчас на экране
+    WidgetBox _ink;
+    char _text[12];
+
+    // Пиксели глифов строки - по метрикам шрифта, как их ставит Adafruit_GFX
+    WidgetBox inkBox(const char *text) const {
+        WidgetBox ink = {0, 0, 0, 0};
+        int16_t cx = _x, cy = _y + _baseline;
+        for (const char *p = text; *p; p++) {
+            uint8_t c = *p;
+            if (c < _font->first || c > _font->last) continue;
+            const GFXglyph &g = _font->glyph[c - _font->first];
+            if (g.width > 0 && g.height > 0) {
+                ink = widgetUnion(ink, WidgetBox{(int16_t)(cx + g.xOffset), (int16_t)(cy + g.yOffset),
+                                                 (int16_t)g.width, (int16_t)g.height});
+            }
+            cx += g.xAdvance;
+        }
+        return ink;
+    }
+};
+
+// Круглый индикатор состояния
+class DotWidget : public Widget {
+public:
+    DotWidget(int16_t cx, int16_t cy, int16_t r, uint16_t color)
+        : _cx(cx), _cy(cy), _r(r), _color(color) {}
+
+    void set(uint16_t color) {
+        if (color == _color) return;
+        _color = color;
+        _dirty = true;
+    }
+
+    WidgetBox box() const override { return WidgetBox{(int16_t)(_cx - _r), (int16_t)(_cy - _r), (int16_t)(2 * _r + 1), (int16_t)(2 * _r + 1)}; }
+
+protected:
+    void draw(Adafruit_GFX &gfx) override { gfx.fillCircle(_cx, _cy, _r, _color); }
+
+private:
+    int16_t _cx, _cy, _r;
+    uint16_t _color;
+};
+
+// Компас: циферблат рисуется при входе на страницу и смене наличия магнита,
+// при повороте на целый градус - только стрелка. Старая стрелка стирается
+// цветом циферблата, задетые ею буквы рисуются заново. Конец стрелки - по
+// таблице синусов Q14, без float
+class CompassWidget : public Widget {
+public:
+    CompassWidget(int16_t cx, int16_t cy, int16_t r, uint16_t face, uint16_t ink, uint16_t needle)
+        : _cx(cx), _cy(cy), _r(r), _face(face), _ink(ink), _needle(needle), _angle(-1), _magnet(false),
+          _drawnAngle(-1), _dialDrawn(false) {}
+
+    void set(float angle, bool magnet) {
+        int16_t a = magnet ? ((int16_t)lroundf(angle) % 360 + 360) % 360 : -1;
+        if (a == _angle && magnet == _magnet) return;
+        if (magnet != _magnet) _dialDrawn = false;
+        _angle = a;
+        _magnet = magnet;
+        _dirty = true;
+    }
+
+    void invalidate() override {
+        Widget::invalidate();
+        _dialDrawn = false;
+    }
+
+    WidgetBox box() const override { return WidgetBox{(int16_t)(_cx - _r), (int16_t)(_cy - _r), (int16_t)(2 * _r + 1), (int16_t)(2 * _r + 1)}; }
+
+    // Только поворот - меняются старая и новая стрелки со ступицей
+    WidgetBox dirtyBox() const override {
+        if (!_dialDrawn) return box();
+        return widgetUnion(needleBox(_drawnAngle), needleBox(_angle));
+    }
+
+protected:
+    void draw(Adafruit_GFX &gfx) override {
+        gfx.fillCircle(_cx, _cy, _r, _face);
+        gfx.drawCircle(_cx, _cy, _r, _needle);
+        _dialDrawn = true;
+        _drawnAngle = _angle;
+
+        if (!_magnet) {
+            gfx.drawLine(_cx - _r, _cy - _r, _cx + _r, _cy + _r, _ink);
+            gfx.drawLine(_cx - _r, _cy + _r, _cx + _r, _cy - _r, _ink);
+            tftText(gfx, _cx - 9, _cy - 3, "НЕТ", _ink);
+            return;
+        }
+        for (uint8_t i = 0; i < 4; i++) letter(gfx, i);
+        needle(gfx, _angle, _needle);
+    }
+
+    void update(Adafruit_GFX &gfx) override {
+        if (!_dialDrawn || !_magnet) {
+            draw(gfx);
+            return;
+        }
+        needle(gfx, _drawnAngle, _face);
+        WidgetBox old = needleBox(_drawnAngle);
+        for (uint8_t i = 0; i < 4; i++) {
+            if (crosses(old, letterBox(i))) letter(gfx, i);
+        }
+        needle(gfx, _angle, _needle);
+        _drawnAngle = _angle;
+    }
+
+private:
+    int16_t _cx, _cy, _r;
+    uint16_t _face, _ink, _needle;
+    int16_t _angle;         // Целые градусы, -1 - без магнита
+    bool _magnet;
+    int16_t _drawnAngle;    // Стрелка на экране
+    bool _dialDrawn;        // Циферблат на экране цел
+
+    // С, В, Ю, З (i = 0..3): клетка 6x8 у края циферблата
+    WidgetBox letterBox(uint8_t i) const {
+        int16_t x = i == 1 ? _cx + _r - 8 : i == 3 ? _cx - _r + 2 : _cx - 2;
+        int16_t y = i == 0 ? _cy - _r + 2 : i == 2 ? _cy + _r - 8 : _cy - 3;
+        return WidgetBox{x, y, WIDGET_CHAR_W, WIDGET_CHAR_H};
+    }
+
+    void letter(Adafruit_GFX &gfx, uint8_t i) {
+        static const char *const letters[4] = {"С", "В", "Ю", "З"};
+        WidgetBox b = letterBox(i);
+        tftText(gfx, b.x, b.y, letters[i], _ink);
+    }
+
+    // Конец стрелки: 0° - вверх, по часовой
+    void tip(int16_t angle, int16_t &x, int16_t &y) const {
+        uint16_t deg = (angle + 270) % 360;
+        x = _cx + TrigQ14::scale(_r - 4, TrigQ14::cosDeg(deg));
+        y = _cy + TrigQ14::scale(_r - 4, TrigQ14::sinDeg(deg));
+    }
+
+    // Стрелка со ступицей (ступица всегда цветом букв)
+    void needle(Adafruit_GFX &gfx, int16_t angle, uint16_t color) {
+        int16_t x, y;
+        tip(angle, x, y);
+        gfx.drawLine(_cx, _cy, x, y, color);
+        gfx.fillCircle(_cx, _cy, 2, _ink);
+    }
+
+    WidgetBox needleBox(int16_t angle) const {
+        int16_t x, y;
+        tip(angle, x, y);
+        int16_t x1 = min(x, (int16_t)(_cx - 2)), y1 = min(y, (int16_t)(_cy - 2));
+        int16_t x2 = max(x, (int16_t)(_cx + 2)), y2 = max(y, (int16_t)(_cy + 2));
+        return WidgetBox{x1, y1, (int16_t)(x2 - x1 + 1), (int16_t)(y2 - y1 + 1)};
+    }
+
+    static bool crosses(const WidgetBox &a, const WidgetBox &b) {
+        return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+    }
+};
+
+// Суточный график SPARK_POINTS x h. Шкала - по минимуму и максимуму ряда,
+// округлённым до step наружу, не уже minSpan (десятые доли). Ряд сдвинулся
+// на несколько точек при той же шкале - рисуются только новые столбцы и
+// разрыв; другая шкала, другой ряд (смена узла) или вход на страницу -
+// график целиком
+class SparkWidget : public Widget {
+public:
+    SparkWidget(int16_t x, int16_t y, int16_t h, uint16_t color, int16_t step, int16_t minSpan, uint16_t bg = 0)
+        : _x(x), _y(y), _h(h), _color(color), _bg(bg), _step(step), _minSpan(minSpan),
+          _newest(0), _head(0), _drawnHead(0), _lo(0), _hi(minSpan), _chartDrawn(false) {
+        for (uint8_t i = 0; i < SPARK_POINTS; i++) _ring[i] = SPARK_EMPTY;
+    }
+
+    void set(const SparkSeries &s) {
+        uint32_t k = s.newest - _newest;
+        bool shifted = s.newest >= _newest && k < SPARK_POINTS && follows(s, k);
+        if (shifted && k == 0) return;
+        if (shifted) {
+            _head = (_head + k) % SPARK_POINTS;
+        } else {
+            _head = SPARK_POINTS - 1;       // Заново - слева направо, разрыв в столбце 0
+            _chartDrawn = false;
+        }
+        _newest = s.newest;
+        for (uint8_t i = 0; i < SPARK_POINTS; i++) _ring[slot(i)] = s.values[i];
+        // Точки, добавленные с прошлой отрисовки, съели весь разрыв - целиком
+        if ((_head + SPARK_POINTS - _drawnHead) % SPARK_POINTS >= SPARK_POINTS - 1) _chartDrawn = false;
+
+        int16_t lo, hi;
+        scale(lo, hi);
+        if (lo != _lo || hi != _hi) {
+            _lo = lo;
+            _hi = hi;
+            _chartDrawn = false;
+        }
+        _dirty = true;
+    }
+
+    void invalidate() override {
+        Widget::invalidate();
+        _chartDrawn = false;
+    }
+
+    WidgetBox box() const override { return WidgetBox{_x, _y, SPARK_POINTS, _h}; }
+
+    // Новые столбцы и разрыв за ними; через край кольца - весь график
+    WidgetBox dirtyBox() const override {
+        if (!_chartDrawn) return box();
+        uint8_t first = (_drawnHead + 1) % SPARK_POINTS, gap = (_head + 1) % SPARK_POINTS;
+        if (gap < first) return box();
+        return WidgetBox{(int16_t)(_x + first), _y, (int16_t)(gap - first + 1), _h};
+    }
+
+protected:
+    void draw(Adafruit_GFX &gfx) override {
+        gfx.startWrite();
+        for (uint8_t i = 0; i < SPARK_POINTS; i++) column(gfx, i);
+        gfx.endWrite();
+        _drawnHead = _head;
+        _chartDrawn = true;
+    }
+
+    void update(Adafruit_GFX &gfx) override {
+        if (!_chartDrawn) {
+            draw(gfx);
+            return;
+        }
+        gfx.startWrite();
+        uint8_t i = _drawnHead;
+        do {
+            i = (i + 1) % SPARK_POINTS;
+            column(gfx, i);
+        } while (i != (_head + 1) % SPARK_POINTS);
+        gfx.endWrite();
+        _drawnHead = _head;
+    }
+
+private:
+    int16_t _x, _y, _h;
+    uint16_t _color, _bg;
+    int16_t _step, _minSpan;
+    int16_t _ring[SPARK_POINTS];
+    uint32_t _newest;
+    uint8_t _head;          // Ячейка новейшей точки
+    uint8_t _drawnHead;     // _head на момент отрисовки
+    int16_t _lo, _hi;       // Шкала на экране
+    bool _chartDrawn;       // График на экране цел
+
+    // Ячейка кольца для точки i ряда (0 - самая старая)
+    uint8_t slot(uint8_t i) const { return (_head + 1 + i) % SPARK_POINTS; }
+
+    // Новый ряд - это прежний, сдвинутый на k точек
+    bool follows(const SparkSeries &s, uint32_t k) const {
+        for (uint8_t i = 0; i + k < SPARK_POINTS; i++) {
+            if (s.values[i] != _ring[slot(i + k)]) return false;
+        }
+        return true;
+    }
+
+    void scale(int16_t &lo, int16_t &hi) const {
+        int32_t a = INT16_MAX, b = INT16_MIN;
+        for (uint8_t i = 0; i < SPARK_POINTS; i++) {
+            if (_ring[i] == SPARK_EMPTY) continue;
+            a = min(a, (int32_t)_ring[i]);
+            b = max(b, (int32_t)_ring[i]);
+        }
+        if (a > b) a = b = 0;
+        a = a >= 0 ? a / _step * _step : -((-a + _step - 1) / _step * _step);
+        b = b >= 0 ? (b + _step - 1) / _step * _step : -(-b / _step * _step);
+        while (b - a < _minSpan) {
+            b += _step;
+            if (b - a < _minSpan) a -= _step;
+        }
+        lo = a;
+        hi = b;
+    }
+
+    int16_t row(int16_t v) const { return _y + _h - 1 - (int32_t)(v - _lo) * (_h - 1) / (_hi - _lo); }
+
+    // Столбец - отрезок от предыдущей точки до своей, выше и ниже - фон.
+    // Разрыв (ячейка после новейшей) и пустые точки - только фон
+    void column(Adafruit_GFX &gfx, uint8_t i) {
+        int16_t x = _x + i;
+        int16_t v = _ring[i], prev = _ring[(i + SPARK_POINTS - 1) % SPARK_POINTS];
+        if (i == (_head + 1) % SPARK_POINTS || v == SPARK_EMPTY) {
+            gfx.writeFastVLine(x, _y, _h, _bg);
+            return;
+        }
+        int16_t a = row(v), b = prev == SPARK_EMPTY ? a : row(prev);
+        int16_t y1 = min(a, b), y2 = max(a, b);
+        if (y1 > _y) gfx.writeFastVLine(x, _y, y1 - _y, _bg);
+        gfx.writeFastVLine(x, y1, y2 - y1 + 1, _color);
+        if (y2 < _y + _h - 1) gfx.writeFastVLine(x, y2 + 1, _y + _h - 1 - y2, _bg);
+    }
+};
+
+#endif
@@ -0,0 +1,44 @@
+// trig_q14.h - sin/cos целых градусов в фиксированной точке Q14 (1.0 = 16384)
+// Таблица четверти периода посчитана заранее и лежит во флеше: без sinf()
+// и без ленивой инициализации, которую делили бы задачи на разных ядрах.
+// Пользователи: векторы направлений ветра (wind_engine.h) и стрелка компаса.
+#ifndef TRIG_Q14_H
+#define TRIG_Q14_H
+
+#include <Arduino.h>
+
+#define TRIG_Q14_ONE        16384
+#define TRIG_Q14_SHIFT      14
+
+// round(sin(i°) * 16384), i = 0..90
+const int16_t TRIG_Q14_QUARTER[91] = {
+        0,   286,   572,   857,  1143,  1428,  1713,  1997,  2280,  2563,
+     2845,  3126,  3406,  3686,  3964,  4240,  4516,  4790,  5063,  5334,
+     5604,  5872,  6138,  6402,  6664,  6924,  7182,  7438,  7692,  7943,
+     8192,  8438,  8682,  8923,  9162,  9397,  9630,  9860, 10087, 10311,
+    10531, 10749, 10963, 11174, 11381, 11585, 11786, 11982, 12176, 12365,
+    12551, 12733, 12911, 13085, 13255, 13421, 13583, 13741, 13894, 14044,
+    14189, 14330, 14466, 14598, 14726, 14849, 14968, 15082, 15191, 15296,
+    15396, 15491, 15582, 15668, 15749, 15826, 15897, 15964, 16026, 16083,
+    16135, 16182, 16225, 16262, 16294, 16322, 16344, 16362, 16374, 16382,
+    16384
+};
+
+class TrigQ14 {
+public:
+    // deg - целые градусы 0..359
+    static int16_t sinDeg(uint16_t deg) {
+        if (deg < 90) return TRIG_Q14_QUARTER[deg];
+        if (deg < 180) return TRIG_Q14_QUARTER[180 - deg];
+        if (deg < 270) return -TRIG_Q14_QUARTER[deg - 180];
+        return -TRIG_Q14_QUARTER[360 - deg];
+    }
+    static int16_t cosDeg(uint16_t deg) { return sinDeg((deg + 90) % 360); }
+
+    // round(len * v / 16384) без float
+    static int16_t scale(int16_t len, int16_t v) {
+        return (int16_t)(((int32_t)len * v + TRIG_Q14_ONE / 2) >> TRIG_Q14_SHIFT);
+    }
+};
+
+#endif
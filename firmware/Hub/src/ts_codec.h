@@ -0,0 +1,159 @@
+// ts_codec.h - Сжатие временных рядов (в духе Gorilla)
+// Блок кодируется независимо от соседних: первая запись - как есть
+// (32 бита времени, 32 бита значения), дальше по битам:
+//   время    - разность разностей (delta-of-delta) в zigzag:
+//              '0' | '10'+7 | '110'+9 | '1110'+12 | '1111'+32 бит
+//   значение - разность целых в фиксированной точке (x TS_CODEC_SCALE) в zigzag:
+//              '0' | '10'+6 | '110'+10 | '1110'+16 | '1111'+32 бит
+// Записи раз в минуту с медленно меняющимся значением занимают 1-2 байта.
+#ifndef TS_CODEC_H
+#define TS_CODEC_H
+
+#include <Arduino.h>
+
+#define TS_CODEC_SCALE      100     // Разрешение значения - 0.01
+#define TS_CODEC_MAX_BITS   72      // Худший случай на запись: 4+32 + 4+32
+
+inline uint32_t tsZigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+inline int32_t tsUnzigzag(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+inline int32_t tsToFixed(float v) { return (int32_t)lroundf(v * TS_CODEC_SCALE); }
+inline float tsFromFixed(int32_t v) { return (float)v / TS_CODEC_SCALE; }
+
+class TsEncoder {
+public:
+    void begin(uint8_t *buf, uint16_t cap) {
+        _buf = buf;
+        _cap = cap;
+        _bits = 0;
+        _count = 0;
+        memset(buf, 0, cap);
+    }
+
+    // false - в блоке нет места под запись худшего размера; блок нужно закрыть
+    bool append(uint32_t t, float v) {
+        if (_bits + TS_CODEC_MAX_BITS > (uint32_t)_cap * 8) return false;
+        int32_t value = tsToFixed(v);
+        if (_count == 0) {
+            put(t, 32);
+            put((uint32_t)value, 32);
+            _delta = 0;
+        } else {
+            int32_t delta = (int32_t)(t - _t);
+            uint32_t dod = tsZigzag(delta - _delta);
+            if (dod == 0) put(0, 1);
+            else if (dod < (1u << 7)) { put(0x2, 2); put(dod, 7); }
+            else if (dod < (1u << 9)) { put(0x6, 3); put(dod, 9); }
+            else if (dod < (1u << 12)) { put(0xE, 4); put(dod, 12); }
+            else { put(0xF, 4); put(dod, 32); }
+            _delta = delta;
+
+            uint32_t dv = tsZigzag(value - _value);
+            if (dv == 0) put(0, 1);
+            else if (dv < (1u << 6)) { put(0x2, 2); put(dv, 6); }
+            else if (dv < (1u << 10)) { put(0x6, 3); put(dv, 10); }
+            else if (dv < (1u << 16)) { put(0xE, 4); put(dv, 16); }
+            else { put(0xF, 4); put(dv, 32); }
+        }
+        _t = t;
+        _value = value;
+        _count++;
+        return true;
+    }
+
+    uint16_t count() const { return _count; }
+    uint16_t bytes() const { return (_bits + 7) / 8; }
+
+private:
+    uint8_t *_buf;
+    uint16_t _cap;
+    uint32_t _bits;
+    uint16_t _count;
+    uint32_t _t;
+    int32_t _delta;
+    int32_t _value;
+
+    void put(uint32_t v, uint8_t n) {
+        while (n > 0) {
+            n--;
+            if ((v >> n) & 1) _buf[_bits >> 3] |= 0x80 >> (_bits & 7);
+            _bits++;
+        }
+    }
+};
+
+// Потоковый декодер: отдаёт записи блока по одной, без промежуточного массива
+class TsDecoder {
+public:
+    void begin(const uint8_t *buf, uint16_t len, uint16_t count) {
+        _buf = buf;
+        _len = len;
+        _bits = 0;
+        _left = count;
+        _first = true;
+        _t = 0;
+        _delta = 0;
+        _value = 0;
+    }
+
+    bool next(uint32_t &t, float &v) {
+        if (_left == 0) return false;
+        if (_first) {
+            _t = get(32);
+            _value = (int32_t)get(32);
+            _delta = 0;
+            _first = false;
+        } else {
+            uint32_t dod;
+            if (get(1) == 0) dod = 0;
+            else if (get(1) == 0) dod = get(7);
+            else if (get(1) == 0) dod = get(9);
+            else if (get(1) == 0) dod = get(12);
+            else dod = get(32);
+            _delta += tsUnzigzag(dod);
+            _t += _delta;
+
+            uint32_t dv;
+            if (get(1) == 0) dv = 0;
+            else if (get(1) == 0) dv = get(6);
+            else if (get(1) == 0) dv = get(10);
+            else if (get(1) == 0) dv = get(16);
+            else dv = get(32);
+            _value += tsUnzigzag(dv);
+        }
+        if (_bits > (uint32_t)_len * 8) {   // Блок короче, чем обещает счётчик
+            _left = 0;
+            return false;
+        }
+        _left--;
+        t = _t;
+        v = tsFromFixed(_value);
+        return true;
+    }
+
+    uint16_t left() const { return _left; }
+
+private:
+    const uint8_t *_buf;
+    uint16_t _len;
+    uint32_t _bits;
+    uint16_t _left;
+    bool _first;
+    uint32_t _t;
+    int32_t _delta;
+    int32_t _value;
+
+    uint32_t get(uint8_t n) {
+        uint32_t v = 0;
+        while (n > 0) {
+            n--;
+            uint32_t byte = _bits >> 3;
+            uint8_t bit = byte < _len ? (_buf[byte] >> (7 - (_bits & 7))) & 1 : 0;
+            v = (v << 1) | bit;
+            _bits++;
+        }
+        return v;
+    }
+};
+
+#endif
@@ -0,0 +1,412 @@
+// ts_store.h - Хранилище временных рядов на SD
+// Один файл на ряд (узел, величина) и сутки: /ts/<ряд>/YYYYMMDD.bin.
+// Файл создаётся сразу полного размера (заголовок + место под все записи суток),
+// поэтому занимает непрерывную цепочку кластеров и не фрагментирует FAT.
+//
+// Блок 0 - заголовок с разреженным индексом: номер первой записи каждого
+// 15-минутного интервала. Дальше - записи фиксированного размера по времени;
+// свободное место заполнено нулями (t == 0 - записи нет).
+//
+// Закрытые сутки сжимаются в /ts/<ряд>/YYYYMMDD.tsc (см. ts_codec.h): заголовок
+// с индексом блоков, дальше независимые блоки до 512 байт с CRC32 каждый.
+//
+// Агрегаты по часам и суткам (число, сумма, мин, макс, последнее) лежат в
+// файлах с прямой адресацией: hYYYYMM.bin - слот на каждый час месяца,
+// dYYYY.bin - слот на каждые сутки года. Пустой слот - count == 0.
+//
+// Все функции работают с уже открытым File и вызываются только из задачи SD.
+#ifndef TS_STORE_H
+#define TS_STORE_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <rom/crc.h>
+#include "ts_codec.h"
+
+#define TS_MAGIC            0x31445354  // "TSD1"
+#define TS_VERSION          1
+#define TS_BLOCK_SIZE       512
+#define TS_SLOT_SECONDS     900         // Шаг разреженного индекса - 15 минут
+#define TS_SLOTS_PER_DAY    (86400 / TS_SLOT_SECONDS)
+#define TS_RECORDS_PER_DAY  1440        // Не чаще одной записи в минуту
+#define TS_NO_RECORD        0xFFFF
+
+// Величины, которые хранятся в рядах
+enum TsMetric : uint8_t {
+    TS_TEMP = 0,
+    TS_HUM,
+    TS_PRESS,
+    TS_TEMP_OUT,        // Уличная температура теплицы
+    TS_METRIC_COUNT
+};
+
+struct TsRecord {
+    uint32_t t;         // unixtime RTC
+    float value;
+};
+
+struct TsHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t metric;
+    uint16_t node;
+    uint32_t dayStart;
+    uint16_t recordSize;
+    uint16_t capacity;
+    uint16_t slotFirst[TS_SLOTS_PER_DAY];   // TS_NO_RECORD - в интервале нет записей
+    uint8_t reserved[TS_BLOCK_SIZE - 16 - 2 * TS_SLOTS_PER_DAY];
+};
+
+static_assert(sizeof(TsRecord) == 8, "TsRecord must be 8 bytes");
+static_assert(sizeof(TsHeader) == TS_BLOCK_SIZE, "TsHeader must fill one block");
+static_assert(TS_BLOCK_SIZE % sizeof(TsRecord) == 0, "records must not cross blocks");
+
+#define TS_RECORDS_PER_BLOCK (TS_BLOCK_SIZE / sizeof(TsRecord))
+#define TS_FILE_SIZE         (TS_BLOCK_SIZE + TS_RECORDS_PER_DAY * sizeof(TsRecord))
+
+// Состояние открытого ряда, которое задача SD держит в RAM между записями
+struct TsCursor {
+    uint32_t dayStart;
+    uint16_t count;     // Записей в файле
+    uint16_t lastSlot;  // Интервал последней записи, TS_NO_RECORD - пусто
+};
+
+inline uint32_t tsRecordOffset(uint16_t index) {
+    return TS_BLOCK_SIZE + (uint32_t)index * sizeof(TsRecord);
+}
+
+inline uint16_t tsSlotOf(uint32_t dayStart, uint32_t t) {
+    uint32_t slot = (t - dayStart) / TS_SLOT_SECONDS;
+    return slot < TS_SLOTS_PER_DAY ? slot : TS_SLOTS_PER_DAY - 1;
+}
+
+inline bool tsReadRecord(File &file, uint16_t index, TsRecord &rec) {
+    return file.seek(tsRecordOffset(index)) &&
+           file.read((uint8_t *)&rec, sizeof(rec)) == sizeof(rec);
+}
+
+// Пишет заголовок и заполняет файл нулями до полного размера блоками
+inline bool tsCreateDay(File &file, uint16_t node, uint8_t metric, uint32_t dayStart) {
+    TsHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = TS_MAGIC;
+    hdr.version = TS_VERSION;
+    hdr.metric = metric;
+    hdr.node = node;
+    hdr.dayStart = dayStart;
+    hdr.recordSize = sizeof(TsRecord);
+    hdr.capacity = TS_RECORDS_PER_DAY;
+    memset(hdr.slotFirst, 0xFF, sizeof(hdr.slotFirst));
+    if (file.write((const uint8_t *)&hdr, sizeof(hdr)) != sizeof(hdr)) return false;
+
+    uint8_t zero[TS_BLOCK_SIZE];
+    memset(zero, 0, sizeof(zero));
+    for (uint32_t left = TS_FILE_SIZE - TS_BLOCK_SIZE; left > 0; ) {
+        uint32_t n = left < TS_BLOCK_SIZE ? left : TS_BLOCK_SIZE;
+        if (file.write(zero, n) != n) return false;
+        left -= n;
+    }
+    file.flush();
+    return true;
+}
+
+inline bool tsReadHeader(File &file, TsHeader &hdr) {
+    if (!file.seek(0) || file.read((uint8_t *)&hdr, sizeof(hdr)) != sizeof(hdr)) return false;
+    return hdr.magic == TS_MAGIC && hdr.version == TS_VERSION &&
+           hdr.recordSize == sizeof(TsRecord) && hdr.capacity <= TS_RECORDS_PER_DAY;
+}
+
+// Число записей: двоичный поиск первой пустой (t == 0) начиная с последнего
+// непустого интервала индекса
+inline uint16_t tsCountRecords(File &file, const TsHeader &hdr, uint16_t *lastSlot) {
+    uint16_t lo = 0;
+    *lastSlot = TS_NO_RECORD;
+    for (int s = TS_SLOTS_PER_DAY - 1; s >= 0; s--) {
+        if (hdr.slotFirst[s] != TS_NO_RECORD) {
+            lo = hdr.slotFirst[s];
+            *lastSlot = s;
+            break;
+        }
+    }
+    uint16_t hi = hdr.capacity;
+    TsRecord rec;
+    while (lo < hi) {
+        uint16_t mid = lo + (hi - lo) / 2;
+        if (!tsReadRecord(file, mid, rec)) return mid;
+        if (rec.t != 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Первая запись с временем >= t: индекс сужает поиск до одного интервала,
+// внутри - двоичный поиск
+inline uint16_t tsLowerBound(File &file, const TsHeader &hdr, uint16_t count, uint32_t t) {
+    if (t <= hdr.dayStart) return 0;
+    uint16_t slot = tsSlotOf(hdr.dayStart, t);
+
+    uint16_t lo = 0;
+    for (int s = slot; s >= 0; s--) {
+        if (hdr.slotFirst[s] != TS_NO_RECORD) { lo = hdr.slotFirst[s]; break; }
+    }
+    uint16_t hi = count;
+    for (int s = slot + 1; s < TS_SLOTS_PER_DAY; s++) {
+        if (hdr.slotFirst[s] != TS_NO_RECORD) { hi = hdr.slotFirst[s]; break; }
+    }
+    if (hi > count) hi = count;
+
+    TsRecord rec;
+    while (lo < hi) {
+        uint16_t mid = lo + (hi - lo) / 2;
+        if (!tsReadRecord(file, mid, rec)) return count;
+        if (rec.t < t) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Дописывает запись; первая запись нового интервала попадает в индекс заголовка
+inline bool tsAppend(File &file, TsCursor &cur, const TsRecord &rec) {
+    if (cur.count >= TS_RECORDS_PER_DAY || rec.t < cur.dayStart) return false;
+    uint16_t slot = tsSlotOf(cur.dayStart, rec.t);
+    if (cur.lastSlot != TS_NO_RECORD && slot < cur.lastSlot) return false;   // Время пошло назад
+
+    if (!file.seek(tsRecordOffset(cur.count)) ||
+        file.write((const uint8_t *)&rec, sizeof(rec)) != sizeof(rec)) {
+        return false;
+    }
+    if (slot != cur.lastSlot) {
+        uint32_t offset = offsetof(TsHeader, slotFirst) + slot * sizeof(uint16_t);
+        if (!file.seek(offset) || file.write((const uint8_t *)&cur.count, sizeof(uint16_t)) != sizeof(uint16_t)) {
+            return false;
+        }
+        cur.lastSlot = slot;
+    }
+    cur.count++;
+    return true;
+}
+
+// Чтение подряд до конца блока: не больше TS_RECORDS_PER_BLOCK записей
+inline uint16_t tsReadBlock(File &file, uint16_t index, uint16_t count, TsRecord *out) {
+    if (index >= count) return 0;
+    uint16_t n = TS_RECORDS_PER_BLOCK - index % TS_RECORDS_PER_BLOCK;
+    if (n > count - index) n = count - index;
+    if (!file.seek(tsRecordOffset(index))) return 0;
+    return file.read((uint8_t *)out, n * sizeof(TsRecord)) / sizeof(TsRecord);
+}
+
+// ========== АГРЕГАТЫ ==========
+#define TS_ROLLUP_MAGIC     0x31525354  // "TSR1"
+#define TS_ROLLUP_VERSION   1
+
+enum TsRollupLevel : uint8_t {
+    TS_ROLLUP_HOUR = 0,
+    TS_ROLLUP_DAY,
+    TS_ROLLUP_LEVELS
+};
+
+struct TsRollup {
+    uint32_t start;     // Начало интервала, unixtime
+    uint16_t count;     // Показаний в интервале, 0 - пусто
+    uint16_t reserved;
+    float sum;
+    float min;
+    float max;
+    float last;
+};
+
+struct TsRollupHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t level;
+    uint16_t node;
+    uint32_t periodStart;   // Начало месяца (часы) или года (сутки)
+    uint16_t slots;
+    uint8_t metric;
+    uint8_t reserved;
+};
+
+static_assert(sizeof(TsRollup) == 24, "TsRollup must be 24 bytes");
+static_assert(sizeof(TsRollupHeader) == 16, "TsRollupHeader must be 16 bytes");
+
+#define TS_ROLLUPS_PER_READ (TS_BLOCK_SIZE / sizeof(TsRollup))
+
+inline void tsRollupAdd(TsRollup &r, float value) {
+    if (r.count == 0) {
+        r.sum = 0;
+        r.min = value;
+        r.max = value;
+    }
+    r.count++;
+    r.sum += value;
+    if (value < r.min) r.min = value;
+    if (value > r.max) r.max = value;
+    r.last = value;
+}
+
+// src - более поздний интервал: его last становится последним
+inline void tsRollupMerge(TsRollup &dst, const TsRollup &src) {
+    if (src.count == 0) return;
+    if (dst.count == 0) {
+        uint32_t start = dst.start;
+        dst = src;
+        dst.start = start;
+        return;
+    }
+    dst.count += src.count;
+    dst.sum += src.sum;
+    if (src.min < dst.min) dst.min = src.min;
+    if (src.max > dst.max) dst.max = src.max;
+    dst.last = src.last;
+}
+
+inline uint32_t tsRollupOffset(uint16_t slot) {
+    return sizeof(TsRollupHeader) + (uint32_t)slot * sizeof(TsRollup);
+}
+
+// Заголовок и нули под все слоты периода - файл сразу полного размера
+inline bool tsRollupCreate(File &file, const TsRollupHeader &hdr) {
+    if (file.write((const uint8_t *)&hdr, sizeof(hdr)) != sizeof(hdr)) return false;
+    uint8_t zero[TS_BLOCK_SIZE];
+    memset(zero, 0, sizeof(zero));
+    for (uint32_t left = (uint32_t)hdr.slots * sizeof(TsRollup); left > 0; ) {
+        uint32_t n = left < TS_BLOCK_SIZE ? left : TS_BLOCK_SIZE;
+        if (file.write(zero, n) != n) return false;
+        left -= n;
+    }
+    file.flush();
+    return true;
+}
+
+inline bool tsRollupReadHeader(File &file, TsRollupHeader &hdr) {
+    if (!file.seek(0) || file.read((uint8_t *)&hdr, sizeof(hdr)) != sizeof(hdr)) return false;
+    return hdr.magic == TS_ROLLUP_MAGIC && hdr.version == TS_ROLLUP_VERSION;
+}
+
+inline bool tsRollupWrite(File &file, uint16_t slot, const TsRollup &r) {
+    return file.seek(tsRollupOffset(slot)) &&
+           file.write((const uint8_t *)&r, sizeof(r)) == sizeof(r);
+}
+
+// Слоты [slot, end), не больше TS_ROLLUPS_PER_READ за раз
+inline uint16_t tsRollupRead(File &file, uint16_t slot, uint16_t end, TsRollup *out) {
+    if (slot >= end) return 0;
+    uint16_t n = end - slot;
+    if (n > TS_ROLLUPS_PER_READ) n = TS_ROLLUPS_PER_READ;
+    if (!file.seek(tsRollupOffset(slot))) return 0;
+    return file.read((uint8_t *)out, n * sizeof(TsRollup)) / sizeof(TsRollup);
+}
+
+// ========== СЖАТЫЕ СУТКИ ==========
+#define TSC_MAGIC           0x31435354  // "TSC1"
+#define TSC_VERSION         1
+#define TSC_MAX_BLOCKS      32
+
+struct TscBlock {
+    uint32_t firstT;    // Время первой записи блока
+    uint32_t offset;
+    uint16_t length;
+    uint16_t count;
+    uint32_t crc;       // CRC32 данных блока
+};
+
+// Заголовок пишется последним, после всех блоков: файл без верного
+// заголовка считается недописанным
+struct TscHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t metric;
+    uint16_t node;
+    uint32_t dayStart;
+    uint16_t count;
+    uint16_t blocks;
+    TscBlock index[TSC_MAX_BLOCKS];
+};
+
+// Худший блок - TS_CODEC_MAX_BITS на каждую запись; сутки всё равно влезают в индекс
+static_assert(TS_RECORDS_PER_DAY / ((TS_BLOCK_SIZE * 8 - TS_CODEC_MAX_BITS) / TS_CODEC_MAX_BITS + 1) + 1
+              <= TSC_MAX_BLOCKS, "TSC_MAX_BLOCKS too small for worst case");
+
+#define TSC_DATA_OFFSET     sizeof(TscHeader)
+
+inline bool tscReadHeader(File &file, TscHeader &hdr) {
+    if (!file.seek(0) || file.read((uint8_t *)&hdr, sizeof(hdr)) != sizeof(hdr)) return false;
+    return hdr.magic == TSC_MAGIC && hdr.version == TSC_VERSION && hdr.blocks <= TSC_MAX_BLOCKS;
+}
+
+// Блок, в котором лежит первая запись с временем >= t
+inline uint8_t tscFindBlock(const TscHeader &hdr, uint32_t t) {
+    uint8_t lo = 0, hi = hdr.blocks;
+    while (lo < hi) {
+        uint8_t mid = lo + (hi - lo) / 2;
+        if (hdr.index[mid].firstT <= t) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo > 0 ? lo - 1 : 0;
+}
+
+// Читает блок в buf (TS_BLOCK_SIZE байт) и готовит декодер; false - блок испорчен
+inline bool tscReadBlock(File &file, const TscBlock &blk, uint8_t *buf, TsDecoder &dec) {
+    if (blk.length > TS_BLOCK_SIZE || !file.seek(blk.offset) ||
+        file.read(buf, blk.length) != blk.length || crc32_le(0, buf, blk.length) != blk.crc) {
+        return false;
+    }
+    dec.begin(buf, blk.length, blk.count);
+    return true;
+}
+
+// Дописывает накопленный блок кодера в out и заносит его в индекс
+inline bool tscFlushBlock(File &out, TscHeader &hdr, TsEncoder &enc, uint8_t *buf,
+                          uint32_t firstT, uint32_t &offset) {
+    if (hdr.blocks >= TSC_MAX_BLOCKS) return false;
+    TscBlock &blk = hdr.index[hdr.blocks++];
+    blk.firstT = firstT;
+    blk.offset = offset;
+    blk.length = enc.bytes();
+    blk.count = enc.count();
+    blk.crc = crc32_le(0, buf, blk.length);
+    if (out.write(buf, blk.length) != blk.length) return false;
+    offset += blk.length;
+    hdr.count += blk.count;
+    enc.begin(buf, TS_BLOCK_SIZE);
+    return true;
+}
+
+// Сжимает файл суток in в out. Память - три блока на стеке, без кучи
+inline bool tscCompact(File &in, const TsHeader &src, uint16_t count, File &out) {
+    TscHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    if (out.write((const uint8_t *)&hdr, sizeof(hdr)) != sizeof(hdr)) return false;
+
+    TsRecord recs[TS_RECORDS_PER_BLOCK];
+    uint8_t buf[TS_BLOCK_SIZE];
+    TsEncoder enc;
+    enc.begin(buf, sizeof(buf));
+    uint32_t offset = TSC_DATA_OFFSET;
+    uint32_t firstT = 0;
+
+    for (uint16_t pos = 0; pos < count; ) {
+        uint16_t n = tsReadBlock(in, pos, count, recs);
+        if (n == 0) return false;
+        for (uint16_t i = 0; i < n; i++) {
+            if (enc.count() == 0) firstT = recs[i].t;
+            if (enc.append(recs[i].t, recs[i].value)) continue;
+            if (!tscFlushBlock(out, hdr, enc, buf, firstT, offset)) return false;
+            firstT = recs[i].t;
+            enc.append(recs[i].t, recs[i].value);
+        }
+        pos += n;
+    }
+    if (enc.count() > 0 && !tscFlushBlock(out, hdr, enc, buf, firstT, offset)) return false;
+
+    hdr.magic = TSC_MAGIC;
+    hdr.version = TSC_VERSION;
+    hdr.metric = src.metric;
+    hdr.node = src.node;
+    hdr.dayStart = src.dayStart;
+    if (!out.seek(0) || out.write((const uint8_t *)&hdr, sizeof(hdr)) != sizeof(hdr)) return false;
+    out.flush();
+    return hdr.count == count;
+}
+
+#endif
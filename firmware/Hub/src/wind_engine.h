@@ -0,0 +1,191 @@
+// wind_engine.h - Скользящая статистика направления ветра
+// Показания флюгера раскладываются по корзинам WIND_BUCKET_MS. Корзина хранит
+// сумму единичных векторов (sin/cos из целочисленной таблицы, Q14) и разброс
+// направлений внутри себя - отклонения от первого показания корзины, поэтому
+// переход через 0°/360° ничего не ломает.
+//
+// Для каждого окна (1 и 10 минут) ведутся суммы векторов закрытых корзин и
+// монотонная очередь номеров корзин по убыванию разброса: голова очереди -
+// самый широкий порыв в окне. Закрытие корзины - O(1) амортизированно.
+#ifndef WIND_ENGINE_H
+#define WIND_ENGINE_H
+
+#include <Arduino.h>
+#include "trig_q14.h"
+
+#define WIND_BUCKET_MS      5000
+#define WIND_Q14            TRIG_Q14_ONE
+#define WIND_WINDOW_COUNT   2
+#define WIND_MAX_BUCKETS    120     // Самое длинное окно - 10 минут
+
+const uint16_t WIND_WINDOW_BUCKETS[WIND_WINDOW_COUNT] = {
+    60000 / WIND_BUCKET_MS,         // 1 минута
+    600000 / WIND_BUCKET_MS         // 10 минут
+};
+
+enum WindWindow : uint8_t {
+    WIND_1MIN = 0,
+    WIND_10MIN
+};
+
+struct WindBucket {
+    uint32_t seq;           // Номер корзины: ms / WIND_BUCKET_MS
+    int32_t sumSin;
+    int32_t sumCos;
+    uint16_t count;
+    int16_t ref;            // Первое показание, десятые доли градуса
+    int16_t lo;             // Разброс: отклонения от ref, десятые доли
+    int16_t hi;
+
+    uint16_t width() const { return count ? hi - lo : 0; }
+};
+
+struct WindStats {
+    uint32_t samples;
+    float direction;        // Средний вектор, градусы 0..360
+    float deviation;        // Круговое СКО, градусы
+    float gustStart;        // Самый широкий разброс корзины в окне
+    float gustEnd;
+    float gustWidth;
+};
+
+class WindEngine {
+public:
+    void begin() {
+        memset(_ring, 0, sizeof(_ring));
+        _open = WindBucket{0, 0, 0, 0, 0, 0, 0};
+        _openSeq = 0;
+        _started = false;
+        _samples = 0;
+        clearWindows();
+    }
+
+    void add(uint32_t ms, float angle) {
+        advance(ms);
+        int16_t a = (int16_t)lroundf(fmodf(fmodf(angle, 360.0f) + 360.0f, 360.0f) * 10) % 3600;
+        uint16_t deg = ((a + 5) / 10) % 360;
+        if (_open.count == 0) {
+            _open.ref = a;
+            _open.lo = 0;
+            _open.hi = 0;
+        }
+        int16_t off = (a - _open.ref + 5400) % 3600 - 1800;
+        if (off < _open.lo) _open.lo = off;
+        if (off > _open.hi) _open.hi = off;
+        _open.sumSin += TrigQ14::sinDeg(deg);
+        _open.sumCos += TrigQ14::cosDeg(deg);
+        _open.count++;
+        _samples++;
+    }
+
+    // Закрывает корзины по времени, даже если показаний нет
+    void advance(uint32_t ms) {
+        uint32_t seq = ms / WIND_BUCKET_MS;
+        if (!_started) {
+            _started = true;
+            _openSeq = seq;
+            return;
+        }
+        if (seq <= _openSeq) return;
+        if (seq - _openSeq > WIND_MAX_BUCKETS) {    // Долгий перерыв: все окна пусты
+            clearWindows();
+            _open = WindBucket{0, 0, 0, 0, 0, 0, 0};
+            _openSeq = seq;
+            return;
+        }
+        while (_openSeq < seq) {
+            close();
+            _openSeq++;
+        }
+    }
+
+    bool stats(uint8_t window, WindStats &out) const {
+        const Window &w = _windows[window];
+        if (w.count == 0) return false;
+        out.samples = w.count;
+        float s = (float)w.sumSin;
+        float c = (float)w.sumCos;
+        out.direction = atan2f(s, c) * 180.0f / (float)M_PI;
+        if (out.direction < 0) out.direction += 360.0f;
+        float r = sqrtf(s * s + c * c) / ((float)w.count * WIND_Q14);
+        out.deviation = r < 1.0f ? sqrtf(-2.0f * logf(r > 1e-6f ? r : 1e-6f)) * 180.0f / (float)M_PI : 0;
+
+        out.gustStart = out.gustEnd = out.gustWidth = 0;
+        if (w.dequeLen > 0) {
+            const WindBucket &b = bucket(w.deque[w.dequeHead]);
+            out.gustStart = wrap(b.ref + b.lo);
+            out.gustEnd = wrap(b.ref + b.hi);
+            out.gustWidth = b.width() / 10.0f;
+        }
+        return true;
+    }
+
+    uint32_t samples() const { return _samples; }
+
+private:
+    struct Window {
+        int32_t sumSin;
+        int32_t sumCos;
+        uint32_t count;
+        uint8_t dequeHead;
+        uint8_t dequeLen;
+        uint32_t deque[WIND_MAX_BUCKETS];   // Номера корзин, разброс по убыванию
+    };
+
+    WindBucket _ring[WIND_MAX_BUCKETS + 1];    // Закрытые корзины по номеру
+    WindBucket _open;
+    uint32_t _openSeq;
+    bool _started;
+    uint32_t _samples;
+    Window _windows[WIND_WINDOW_COUNT];
+
+    void clearWindows() {
+        for (uint8_t w = 0; w < WIND_WINDOW_COUNT; w++) {
+            _windows[w].sumSin = 0;
+            _windows[w].sumCos = 0;
+            _windows[w].count = 0;
+            _windows[w].dequeHead = 0;
+            _windows[w].dequeLen = 0;
+        }
+    }
+
+    static float wrap(int32_t tenths) { return ((tenths % 3600 + 3600) % 3600) / 10.0f; }
+
+    const WindBucket &bucket(uint32_t seq) const { return _ring[seq % (WIND_MAX_BUCKETS + 1)]; }
+
+    void close() {
+        uint32_t seq = _openSeq;
+        for (uint8_t i = 0; i < WIND_WINDOW_COUNT; i++) {
+            Window &w = _windows[i];
+            uint16_t len = WIND_WINDOW_BUCKETS[i];
+            // Вытесняемая корзина ещё лежит в кольце: его длина больше любого окна.
+            // Номер в корзине отсекает слоты, оставшиеся от времени до перерыва.
+            if (seq >= len && bucket(seq - len).seq == seq - len) {
+                const WindBucket &old = bucket(seq - len);
+                w.sumSin -= old.sumSin;
+                w.sumCos -= old.sumCos;
+                w.count -= old.count;
+            }
+            while (w.dequeLen > 0 && w.deque[w.dequeHead] + len <= seq) {
+                w.dequeHead = (w.dequeHead + 1) % WIND_MAX_BUCKETS;
+                w.dequeLen--;
+            }
+            w.sumSin += _open.sumSin;
+            w.sumCos += _open.sumCos;
+            w.count += _open.count;
+            if (_open.count > 0) {
+                while (w.dequeLen > 0 &&
+                       bucket(w.deque[(w.dequeHead + w.dequeLen - 1) % WIND_MAX_BUCKETS]).width() <= _open.width()) {
+                    w.dequeLen--;
+                }
+                w.deque[(w.dequeHead + w.dequeLen) % WIND_MAX_BUCKETS] = seq;
+                w.dequeLen++;
+            }
+        }
+        _open.seq = seq;
+        _ring[seq % (WIND_MAX_BUCKETS + 1)] = _open;
+        _open = WindBucket{0, 0, 0, 0, 0, 0, 0};
+    }
+};
+
+#endif
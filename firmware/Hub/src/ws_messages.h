@@ -0,0 +1,235 @@
+// ws_messages.h - Сообщения состояния хаба для WebSocket
+// Построители получают данные аргументами, а не из глобальных переменных
+// прошивки: main.cpp собирает их (под своими спинлоками) и зовёт построитель,
+// бенчмарк tools/ws_bench строит те же сообщения на ПК в обоих форматах.
+// Редкие события (тревоги, смена связи) строятся на месте в main.cpp.
+#ifndef WS_MESSAGES_H
+#define WS_MESSAGES_H
+
+#include <Arduino.h>
+#include "ws_proto.h"
+#include "forecast.h"
+#include "node_stats.h"
+#include "rules.h"
+#include "wind_engine.h"
+
+#define WS_STATS_METRICS    3       // temp, hum, press - как TsMetric
+
+// Погода метеостанции (узел 102)
+struct WsWeather {
+    float pressure;
+    float humidity;
+    float trend3h;
+    float trend6h;
+    float trend12h;
+    Forecast forecast;
+    WeatherIcon icon;
+    FrostRisk frost;
+};
+
+struct WsSensor {
+    int id;
+    float temp;
+    float hum;
+    float bmpTemp;
+    float press;
+};
+
+struct WsGreenhouse {
+    float tempIn;
+    float tempOut;
+    int humIn;
+    bool relay1;
+    bool relay2;
+};
+
+// Ветер: сектор минутного окна и самый широкий порыв в нём
+struct WsWind {
+    bool magnet;
+    float direction;
+    float sector;
+    float gustStart;
+    float gustEnd;
+    float gustWidth;        // 0 - порывов ещё нет
+};
+
+struct WsCommandStats {
+    int node;
+    uint32_t ok;
+    uint32_t failed;
+    uint16_t p50;
+    uint16_t p99;
+};
+
+inline void wsForecastFields(WsWriter &w, const WsWeather &weather) {
+    char letter[2] = {forecastLetter(weather.forecast), 0};
+    w.field("forecast", forecastText(weather.forecast));
+    w.field("zambretti", letter);
+    w.field("icon", ICON_EMOJI[weather.icon]);
+    w.field("frost", FROST_TEXT[weather.frost]);
+}
+
+// weather - только для узла метеостанции, иначе nullptr
+inline void wsSensorData(WsWriter &w, const WsSensor &node, const WsWeather *weather) {
+    w.beginObject();
+    w.field("type", "sensor_data");
+    w.field("node", node.id);
+    w.beginObject("aht20");
+    w.fieldFixed("temp", node.temp, 1);
+    w.fieldFixed("hum", node.hum, 1);
+    w.endObject();
+    w.beginObject("bmp280");
+    w.fieldFixed("temp", node.bmpTemp, 1);
+    w.fieldFixed("press", node.press, 1);
+    w.endObject();
+
+    if (weather) {
+        w.beginObject("weather_data");
+        w.fieldFixed("pressure", weather->pressure, 1);
+        w.fieldFixed("humidity", weather->humidity, 0);
+        w.fieldFixed("trend3h", weather->trend3h, 1);
+        w.fieldFixed("trend6h", weather->trend6h, 1);
+        w.fieldFixed("trend12h", weather->trend12h, 1);
+        wsForecastFields(w, *weather);
+        w.endObject();
+    }
+    w.endObject();
+}
+
+// Метрики без показаний за сутки t пропускаются
+inline void wsNodeStats(WsWriter &w, int id, const RunningStats *stats, uint32_t t) {
+    static const char *names[WS_STATS_METRICS] = {"temp", "hum", "press"};
+    w.beginObject();
+    w.field("type", "node_stats");
+    w.field("node", id);
+    for (uint8_t m = 0; m < WS_STATS_METRICS; m++) {
+        if (!stats[m].current(t)) continue;
+        w.beginObject(names[m]);
+        w.field("n", (int32_t)stats[m].count);
+        w.fieldFixed("mean", stats[m].mean, 2);
+        w.fieldFixed("sd", stats[m].stddev(), 2);
+        w.fieldFixed("min", stats[m].min, 1);
+        w.field("min_t", (int32_t)stats[m].minT);
+        w.fieldFixed("max", stats[m].max, 1);
+        w.field("max_t", (int32_t)stats[m].maxT);
+        w.endObject();
+    }
+    w.endObject();
+}
+
+inline void wsGreenhouseData(WsWriter &w, const WsGreenhouse &g) {
+    w.beginObject();
+    w.field("type", "greenhouse_data");
+    w.fieldFixed("temp_in", g.tempIn, 1);
+    w.fieldFixed("temp_out", g.tempOut, 1);
+    w.field("hum_in", g.humIn);
+    w.field("relay1_state", g.relay1 ? 1 : 0);
+    w.field("relay2_state", g.relay2 ? 1 : 0);
+    w.endObject();
+}
+
+inline void wsWeatherUpdate(WsWriter &w, const WsWeather &weather) {
+    w.beginObject();
+    w.field("type", "weather_update");
+    w.fieldFixed("pressure", weather.pressure, 1);
+    w.fieldFixed("humidity", weather.humidity, 0);
+    w.fieldFixed("trend3h", weather.trend3h, 1);
+    w.fieldFixed("trend6h", weather.trend6h, 1);
+    w.fieldFixed("trend12h", weather.trend12h, 1);
+    wsForecastFields(w, weather);
+    w.endObject();
+}
+
+inline void wsWeatherForecast(WsWriter &w, int node, const WsWeather &weather) {
+    char letter[2] = {forecastLetter(weather.forecast), 0};
+    w.beginObject();
+    w.field("type", "weather_forecast");
+    w.field("node", node);
+    w.field("forecast_class", ICON_CLASS[weather.icon]);
+    w.field("forecast_text", forecastText(weather.forecast));
+    w.field("zambretti", letter);
+    w.endObject();
+}
+
+// tenMin - статистика 10-минутного окна, nullptr - окно ещё пустое
+inline void wsWindData(WsWriter &w, const WsWind &wind, const WindStats *tenMin) {
+    w.beginObject();
+    w.field("type", "wind");
+
+    if (!wind.magnet) {
+        w.fieldBool("magnet", false);
+        w.field("stability", "no_magnet");
+        w.endObject();
+        return;
+    }
+
+    float redStart = fmod(fmod(wind.direction - wind.sector / 2, 360) + 360, 360);
+    float redEnd = fmod(fmod(wind.direction + wind.sector / 2, 360) + 360, 360);
+
+    const char *stability;
+    if (wind.sector < 10) stability = "calm";
+    else if (wind.sector < 30) stability = "gusty";
+    else if (wind.sector < 60) stability = "strong";
+    else stability = "storm";
+
+    w.fieldFixed("angle_avg", wind.direction, 1);
+    w.fieldFixed("sector_width", wind.sector, 1);
+    w.fieldFixed("sector_start", redStart, 0);
+    w.fieldFixed("sector_end", redEnd, 0);
+
+    if (wind.gustWidth > 0) {
+        w.fieldFixed("history_min", wind.gustStart, 0);
+        w.fieldFixed("history_max", wind.gustEnd, 0);
+        w.fieldFixed("history_width", wind.gustWidth, 1);
+    }
+
+    if (tenMin) {
+        w.fieldFixed("angle_avg_10m", tenMin->direction, 1);
+        w.fieldFixed("sector_width_10m", min(2.0f * tenMin->deviation, 360.0f), 1);
+        w.fieldFixed("gust_min_10m", tenMin->gustStart, 0);
+        w.fieldFixed("gust_max_10m", tenMin->gustEnd, 0);
+        w.fieldFixed("gust_width_10m", tenMin->gustWidth, 1);
+    }
+
+    w.fieldBool("magnet", wind.magnet);
+    w.field("stability", stability);
+    w.endObject();
+}
+
+inline void wsCommandStats(WsWriter &w, const WsCommandStats *nodes, uint8_t count) {
+    w.beginObject();
+    w.field("type", "command_stats");
+    w.beginObject("nodes");
+    for (uint8_t i = 0; i < count; i++) {
+        char key[8];
+        snprintf(key, sizeof(key), "%d", nodes[i].node);
+        w.beginObject(key);
+        w.field("ok", (int32_t)nodes[i].ok);
+        w.field("failed", (int32_t)nodes[i].failed);
+        w.field("p50_ms", nodes[i].p50);
+        w.field("p99_ms", nodes[i].p99);
+        w.endObject();
+    }
+    w.endObject();
+    w.endObject();
+}
+
+// Пороги узла и метрики: правила RULE_BELOW (lo) и RULE_ABOVE (hi)
+inline void wsLimitsUpdate(WsWriter &w, uint16_t node, const char *sensor, const RuleConfig &lo, const RuleConfig &hi) {
+    w.beginObject();
+    w.field("type", "limits_update");
+    w.field("node", node);
+    w.field("sensor", sensor);
+    w.beginObject("min");
+    w.fieldBool("enabled", lo.enabled);
+    w.fieldFixed("value", lo.threshold, 1);
+    w.endObject();
+    w.beginObject("max");
+    w.fieldBool("enabled", hi.enabled);
+    w.fieldFixed("value", hi.threshold, 1);
+    w.endObject();
+    w.fieldFixed("hysteresis", hi.enabled ? hi.hysteresis : lo.hysteresis, 1);
+    w.endObject();
+}
+
+#endif
@@ -0,0 +1,195 @@
+// ws_proto.h - Общий сериализатор сообщений хаба для WebSocket
+// Одна и та же функция-построитель сообщения выдаёт либо JSON-текст,
+// либо MessagePack (бинарный кадр). Схема сообщений (ключи, вложенность)
+// одинакова для обоих форматов.
+#ifndef WS_PROTO_H
+#define WS_PROTO_H
+
+#include <Arduino.h>
+
+// Формат, согласованный с клиентом
+enum WsFormat : uint8_t {
+    WS_FORMAT_JSON = 0,
+    WS_FORMAT_MSGPACK = 1
+};
+
+#define WS_MSG_MAX_LEN    512   // Максимальный размер одного сообщения
+#define WS_MSG_MAX_DEPTH  4     // Максимальная вложенность объектов
+#define WS_MSG_MAX_KEYS   15    // fixmap MessagePack: не более 15 ключей в объекте
+
+class WsWriter {
+public:
+    WsWriter(uint8_t* buf, size_t cap, WsFormat format)
+        : _buf(buf), _cap(cap), _len(0), _format(format), _depth(0), _overflow(false) {}
+
+    WsFormat format() const { return _format; }
+    const uint8_t* data() const { return _buf; }
+    size_t length() const { return _len; }
+    bool ok() const { return !_overflow && _depth == 0; }
+
+    // ---------- Объекты ----------
+    void beginObject() {
+        valuePrefix();
+        if (_depth >= WS_MSG_MAX_DEPTH) { _overflow = true; return; }
+        Level& lvl = _levels[_depth++];
+        lvl.count = 0;
+        lvl.headerPos = _len;
+        if (_format == WS_FORMAT_JSON) putByte('{');
+        else putByte(0x80);   // fixmap, количество ключей допишем в endObject()
+    }
+
+    void endObject() {
+        if (_depth == 0) { _overflow = true; return; }
+        Level& lvl = _levels[--_depth];
+        if (_format == WS_FORMAT_JSON) {
+            putByte('}');
+        } else if (lvl.count > WS_MSG_MAX_KEYS) {
+            _overflow = true;
+        } else if (lvl.headerPos < _cap) {
+            _buf[lvl.headerPos] = 0x80 | lvl.count;
+        }
+    }
+
+    void key(const char* k) {
+        if (_depth == 0) { _overflow = true; return; }
+        Level& lvl = _levels[_depth - 1];
+        if (_format == WS_FORMAT_JSON && lvl.count > 0) putByte(',');
+        lvl.count++;
+        putString(k);
+        if (_format == WS_FORMAT_JSON) putByte(':');
+        _afterKey = true;
+    }
+
+    // ---------- Значения ----------
+    void str(const char* v) {
+        valuePrefix();
+        putString(v ? v : "");
+    }
+
+    void num(int32_t v) {
+        valuePrefix();
+        if (_format == WS_FORMAT_JSON) {
+            char tmp[12];
+            int n = snprintf(tmp, sizeof(tmp), "%ld", (long)v);
+            putBytes((const uint8_t*)tmp, n);
+        } else if (v >= 0 && v <= 127) {
+            putByte((uint8_t)v);
+        } else if (v < 0 && v >= -32) {
+            putByte((uint8_t)(int8_t)v);
+        } else if (v >= -128 && v <= 127) {
+            putByte(0xd0); putByte((uint8_t)(int8_t)v);
+        } else if (v >= -32768 && v <= 32767) {
+            putByte(0xd1); putBE((uint32_t)(uint16_t)(int16_t)v, 2);
+        } else {
+            putByte(0xd2); putBE((uint32_t)v, 4);
+        }
+    }
+
+    // Число с фиксированным числом знаков после запятой.
+    // JSON: печатается как "754.3"; MessagePack: float32 (или целое при decimals == 0)
+    void fixed(float v, uint8_t decimals) {
+        if (!isfinite(v)) {
+            valuePrefix();
+            if (_format == WS_FORMAT_JSON) putBytes((const uint8_t*)"null", 4);
+            else putByte(0xc0);
+            return;
+        }
+        if (decimals == 0) {
+            num((int32_t)lroundf(v));
+            return;
+        }
+        valuePrefix();
+        if (_format == WS_FORMAT_JSON) {
+            char tmp[20];
+            int n = snprintf(tmp, sizeof(tmp), "%.*f", decimals, v);
+            putBytes((const uint8_t*)tmp, n);
+        } else {
+            uint32_t bits;
+            memcpy(&bits, &v, sizeof(bits));
+            putByte(0xca);
+            putBE(bits, 4);
+        }
+    }
+
+    void boolean(bool v) {
+        valuePrefix();
+        if (_format == WS_FORMAT_JSON) {
+            if (v) putBytes((const uint8_t*)"true", 4);
+            else putBytes((const uint8_t*)"false", 5);
+        } else {
+            putByte(v ? 0xc3 : 0xc2);
+        }
+    }
+
+    // ---------- Сокращения "ключ + значение" ----------
+    void field(const char* k, const char* v) { key(k); str(v); }
+    void field(const char* k, int32_t v) { key(k); num(v); }
+    void fieldBool(const char* k, bool v) { key(k); boolean(v); }
+    void fieldFixed(const char* k, float v, uint8_t decimals) { key(k); fixed(v, decimals); }
+    void beginObject(const char* k) { key(k); beginObject(); }
+
+private:
+    struct Level {
+        uint8_t count;
+        size_t headerPos;
+    };
+
+    uint8_t* _buf;
+    size_t _cap;
+    size_t _len;
+    WsFormat _format;
+    uint8_t _depth;
+    bool _overflow;
+    bool _afterKey = false;
+    Level _levels[WS_MSG_MAX_DEPTH];
+
+    // Значение внутри объекта без ключа - ошибка построителя
+    void valuePrefix() {
+        if (_depth > 0 && !_afterKey) _overflow = true;
+        _afterKey = false;
+    }
+
+    void putByte(uint8_t b) {
+        if (_len < _cap) _buf[_len++] = b;
+        else _overflow = true;
+    }
+
+    void putBytes(const uint8_t* p, size_t n) {
+        if (_len + n > _cap) { _overflow = true; return; }
+        memcpy(_buf + _len, p, n);
+        _len += n;
+    }
+
+    void putBE(uint32_t v, uint8_t bytes) {
+        for (int8_t i = bytes - 1; i >= 0; i--) putByte((uint8_t)(v >> (8 * i)));
+    }
+
+    void putString(const char* s) {
+        size_t n = strlen(s);
+        if (_format == WS_FORMAT_MSGPACK) {
+            if (n <= 31) putByte(0xa0 | n);
+            else if (n <= 0xff) { putByte(0xd9); putByte((uint8_t)n); }
+            else { putByte(0xda); putBE((uint32_t)n, 2); }
+            putBytes((const uint8_t*)s, n);
+            return;
+        }
+        // JSON: экранируем только то, что требует стандарт; UTF-8 (эмодзи) идёт как есть
+        putByte('"');
+        for (size_t i = 0; i < n; i++) {
+            uint8_t c = (uint8_t)s[i];
+            if (c == '"' || c == '\\') {
+                putByte('\\');
+                putByte(c);
+            } else if (c < 0x20) {
+                char esc[7];
+                snprintf(esc, sizeof(esc), "\\u%04x", c);
+                putBytes((const uint8_t*)esc, 6);
+            } else {
+                putByte(c);
+            }
+        }
+        putByte('"');
+    }
+};
+
+#endif
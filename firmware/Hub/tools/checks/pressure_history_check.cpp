@@ -0,0 +1,101 @@
+// pressure_history_check.cpp - Тренды PressureHistory против прямого МНК
+// Случайный ряд давления со случайным шагом между показаниями и редкими
+// перерывами на часы и сутки. После каждого показания тренды 3/6/12 ч
+// сравниваются с наклоном прямой, подогнанной заново по всем корзинам окна:
+// средние 5-минутных корзин считаются здесь отдельно, из исходных показаний.
+//
+// Запуск: make run (см. Makefile); pressure_history_check [показаний]
+#include <Arduino.h>
+#include <vector>
+#include "pressure_history.h"
+
+#define CHECK_START_T       1760000000UL
+#define CHECK_TOLERANCE     0.002f          // мм рт. ст.
+
+static uint32_t rngState = 2024;
+
+static uint32_t rnd() {
+    rngState = rngState * 1664525u + 1013904223u;
+    return rngState >> 8;
+}
+
+// Корзины эталона: номер - t / PH_FINE_SECONDS - firstIndex
+static std::vector<int64_t> sums;
+static std::vector<uint32_t> counts;
+static uint32_t firstIndex;
+
+static void refAdd(uint32_t t, float value) {
+    uint32_t i = t / PH_FINE_SECONDS - firstIndex;
+    if (i >= sums.size()) {
+        sums.resize(i + 1, 0);
+        counts.resize(i + 1, 0);
+    }
+    sums[i] += (int32_t)lroundf(value * PH_SCALE);
+    counts[i]++;
+}
+
+// Изменение за окно по закрытым корзинам до open (не включая); false - мало точек
+static bool refTrend(uint32_t open, uint16_t len, double &out) {
+    double n = 0, sx = 0, sxx = 0, sy = 0, sxy = 0;
+    for (uint16_t age = 0; age < len && age < open; age++) {
+        uint32_t i = open - 1 - age;
+        if (counts[i] == 0) continue;
+        double x = -(double)age;
+        double y = (double)(sums[i] / (int64_t)counts[i]);
+        n++;
+        sx += x;
+        sxx += x * x;
+        sy += y;
+        sxy += x * y;
+    }
+    if (n < 3 || n < len / 2) return false;
+    double den = n * sxx - sx * sx;
+    if (den == 0) return false;
+    out = (n * sxy - sx * sy) / den * len / PH_SCALE;
+    return true;
+}
+
+int main(int argc, char **argv) {
+    uint32_t total = argc > 1 ? (uint32_t)atol(argv[1]) : 200000;
+
+    static PressureHistory history;
+    history.begin();
+    firstIndex = CHECK_START_T / PH_FINE_SECONDS;
+
+    uint32_t t = CHECK_START_T;
+    float pressure = 748.0f;
+    uint32_t checks = 0;
+    float worst = 0;
+    for (uint32_t k = 0; k < total; k++) {
+        // Обычно показание раз в 10 с - 10 мин, изредка перерыв до полутора суток
+        uint32_t r = rnd() % 1000;
+        t += r < 2 ? 3600 + rnd() % 126000 : 10 + rnd() % 590;
+        pressure += ((int32_t)(rnd() % 61) - 30) / 100.0f;
+        if (pressure < 720 || pressure > 780) pressure = 748.0f;
+        float value = pressure + ((int32_t)(rnd() % 21) - 10) / 100.0f;
+
+        history.add(t, value);
+        refAdd(t, value);
+
+        uint32_t open = t / PH_FINE_SECONDS - firstIndex;
+        for (uint8_t w = 0; w < PH_TREND_COUNT; w++) {
+            float got = 0;
+            double want = 0;
+            bool hasGot = history.trend(w, got);
+            bool hasWant = refTrend(open, PressureHistory::windowBuckets(w), want);
+            if (hasGot != hasWant || (hasGot && fabs(got - want) > CHECK_TOLERANCE)) {
+                fprintf(stderr, "pressure_history: показание %u, окно %u: %s%.4f, эталон %s%.4f\n",
+                        (unsigned)k, (unsigned)w, hasGot ? "" : "нет ", got,
+                        hasWant ? "" : "нет ", want);
+                return 1;
+            }
+            if (hasGot) {
+                checks++;
+                worst = max(worst, (float)fabs(got - want));
+            }
+        }
+    }
+    printf("pressure_history: %u показаний, %u трендов сверено, макс. расхождение %.5f мм\n",
+           (unsigned)total, (unsigned)checks, worst);
+    return 0;
+}
@@ -0,0 +1,203 @@
+// rules_check.cpp - RuleEngine против прямого пересчёта по истории
+// Правила всех видов на нескольких узлах и метриках, часть выключена (на
+// узел, метрику и вид - одно правило, как в set()). Случайные показания с
+// шагом до минуты и перерывами на часы; время от времени правило
+// перенастраивается через set() + compile().
+// Эталон хранит все показания каждого правила с последнего сброса и для
+// FALL/RISE/SHIFT ищет слот, начавшийся окно назад, прямо в истории:
+// среднее его показаний (для SHIFT - первое). Состояние тревоги эталона -
+// по определению: поднимается за порогом, снимается за гистерезисом.
+// События движка должны совпасть с эталоном по правилу, знаку, значению
+// и изменению за окно.
+//
+// Запуск: make run (см. Makefile); rules_check [показаний]
+#include <Arduino.h>
+#include <vector>
+#include "rules.h"
+
+#define CHECK_START_T       1760000000UL
+#define CHECK_EVENTS_MAX    RULES_MAX
+
+struct Sample {
+    uint32_t t;
+    float v;
+};
+
+struct RefRule {
+    bool active;
+    std::vector<Sample> history;    // Показания с последнего set()
+};
+
+static uint32_t rngState = 4242;
+
+static uint32_t rnd() {
+    rngState = rngState * 1664525u + 1013904223u;
+    return rngState >> 8;
+}
+
+static const RuleConfig CONFIGS[] = {
+    {101, RM_TEMP, RULE_BELOW, 18.0f, 0.5f, 0, 1, 0},
+    {101, RM_TEMP, RULE_ABOVE, 25.0f, 0.5f, 0, 1, 0},
+    {101, RM_TEMP, RULE_RISE, 2.0f, 0.5f, 600, 1, 0},
+    {101, RM_HUM, RULE_ABOVE, 70.0f, 3.0f, 0, 0, 0},       // Выключено
+    {101, RM_HUM, RULE_BELOW, 35.0f, 2.0f, 0, 1, 0},
+    {102, RM_PRESS, RULE_FALL, 2.0f, 0.5f, 10800, 1, 0},
+    {102, RM_PRESS, RULE_RISE, 1.5f, 0.3f, 3600, 1, 0},
+    {102, RM_PRESS, RULE_BELOW, 740.0f, 1.0f, 0, 1, 0},
+    {102, RM_TEMP, RULE_FALL, 1.0f, 0.2f, 7, 1, 0},        // Слот короче секунды
+    {101, RM_WIND, RULE_SHIFT, 45.0f, 10.0f, 600, 1, 0},
+    {105, RM_WIND, RULE_SHIFT, 90.0f, 20.0f, 60, 1, 0},
+    {103, RM_TEMP, RULE_ABOVE, 30.0f, 1.0f, 0, 1, 0},      // Показаний нет
+};
+#define CHECK_RULES (sizeof(CONFIGS) / sizeof(CONFIGS[0]))
+
+// Потоки показаний: (узел, метрика), у ветра - углы по кругу
+struct Stream {
+    uint16_t node;
+    uint8_t metric;
+    float value;
+    float step;
+};
+
+static Stream STREAMS[] = {
+    {101, RM_TEMP, 21.0f, 0.3f},
+    {101, RM_HUM, 45.0f, 1.5f},
+    {102, RM_PRESS, 748.0f, 0.2f},
+    {102, RM_TEMP, 10.0f, 0.4f},
+    {101, RM_WIND, 180.0f, 9.0f},
+    {105, RM_WIND, 350.0f, 15.0f},
+    {104, RM_TEMP, 20.0f, 0.3f},                            // Правил нет
+};
+#define CHECK_STREAMS (sizeof(STREAMS) / sizeof(STREAMS[0]))
+
+static RuleConfig configs[CHECK_RULES];
+static RefRule refs[CHECK_RULES];
+
+// Значение слота, начавшегося окно назад; NAN - слота в истории нет
+static float windowAgo(const RuleConfig &cfg, const RefRule &ref, uint32_t t) {
+    uint32_t slotLen = max(cfg.windowS / RULE_RATE_SLOTS, 1);
+    uint32_t slot = t / slotLen;
+    if (slot < RULE_RATE_SLOTS) return NAN;
+    uint32_t want = slot - RULE_RATE_SLOTS;
+    size_t end = ref.history.size();
+    while (end > 0 && ref.history[end - 1].t / slotLen > want) end--;
+    size_t begin = end;
+    while (begin > 0 && ref.history[begin - 1].t / slotLen == want) begin--;
+    if (begin == end) return NAN;
+    if (cfg.kind == RULE_SHIFT) return ref.history[begin].v;
+    float sum = 0;                  // В порядке поступления, как в движке
+    for (size_t i = begin; i < end; i++) sum += ref.history[i].v;
+    return sum / (uint16_t)(end - begin);
+}
+
+// Эталонные события для показания, в порядке индексов правил
+static uint8_t reference(uint16_t node, uint8_t metric, uint32_t t, float v, RuleEvent *out) {
+    uint8_t events = 0;
+    for (uint8_t i = 0; i < CHECK_RULES; i++) {
+        const RuleConfig &cfg = configs[i];
+        if (!cfg.enabled || cfg.node != node || cfg.metric != metric) continue;
+        RefRule &ref = refs[i];
+        ref.history.push_back(Sample{t, v});
+        float delta = 0;
+        bool over, clear;       // За порогом; отошло от порога на гистерезис
+        if (cfg.kind == RULE_BELOW) {
+            over = v < cfg.threshold;
+            clear = v > cfg.threshold + cfg.hysteresis;
+        } else if (cfg.kind == RULE_ABOVE) {
+            over = v > cfg.threshold;
+            clear = v < cfg.threshold - cfg.hysteresis;
+        } else {
+            float old = windowAgo(cfg, ref, t);
+            if (isnan(old)) continue;
+            delta = v - old;
+            if (cfg.kind == RULE_SHIFT) delta = fmodf(delta + 540.0f, 360.0f) - 180.0f;
+            float change = cfg.kind == RULE_SHIFT ? fabsf(delta) : cfg.kind == RULE_FALL ? -delta : delta;
+            over = change >= cfg.threshold;
+            clear = change < cfg.threshold - cfg.hysteresis;
+        }
+        bool was = ref.active;
+        if (!ref.active && over) ref.active = true;
+        else if (ref.active && clear) ref.active = false;
+        if (ref.active != was) out[events++] = RuleEvent{i, ref.active, v, delta};
+    }
+    return events;
+}
+
+static void sortEvents(RuleEvent *e, uint8_t n) {
+    std::sort(e, e + n, [](const RuleEvent &a, const RuleEvent &b) { return a.rule < b.rule; });
+}
+
+int main(int argc, char **argv) {
+    uint32_t total = argc > 1 ? (uint32_t)atol(argv[1]) : 200000;
+
+    static RuleEngine engine;
+    engine.begin();
+    for (uint8_t i = 0; i < CHECK_RULES; i++) {
+        configs[i] = CONFIGS[i];
+        engine.set(configs[i]);
+    }
+    engine.compile();
+    if (engine.count() != CHECK_RULES) {
+        fprintf(stderr, "rules: правил %u из %u\n", engine.count(), (unsigned)CHECK_RULES);
+        return 1;
+    }
+
+    uint32_t t = CHECK_START_T;
+    uint32_t events = 0, raised = 0;
+    uint32_t kinds[RULE_KIND_COUNT] = {0};
+    for (uint32_t k = 0; k < total; k++) {
+        uint32_t r = rnd() % 1000;
+        t += r < 1 ? 3600 + rnd() % 36000 : rnd() % 60;
+
+        // Перенастройка: порог сдвигается, состояние правила сбрасывается
+        if (k % 2000 == 1999) {
+            uint8_t i = rnd() % CHECK_RULES;
+            configs[i].threshold *= 0.9f + (rnd() % 21) / 100.0f;
+            if (!engine.set(configs[i])) return 1;
+            engine.compile();
+            refs[i].active = false;
+            refs[i].history.clear();
+        }
+
+        Stream &s = STREAMS[rnd() % CHECK_STREAMS];
+        s.value += ((int32_t)(rnd() % 201) - 100) / 100.0f * s.step;
+        if (s.metric == RM_WIND) {
+            if (rnd() % 40 == 0) s.value += rnd() % 180;
+            s.value = fmodf(s.value + 360.0f, 360.0f);
+        }
+        float v = roundf(s.value * 10) / 10;
+
+        RuleEvent got[CHECK_EVENTS_MAX], want[CHECK_EVENTS_MAX];
+        uint8_t nGot = engine.evaluate(s.node, s.metric, t, v, got, CHECK_EVENTS_MAX);
+        uint8_t nWant = reference(s.node, s.metric, t, v, want);
+        sortEvents(got, nGot);
+        bool ok = nGot == nWant;
+        for (uint8_t i = 0; ok && i < nGot; i++) {
+            ok = got[i].rule == want[i].rule && got[i].raised == want[i].raised &&
+                 got[i].value == want[i].value && got[i].delta == want[i].delta;
+        }
+        if (!ok) {
+            fprintf(stderr, "rules: показание %u (узел %u, метрика %u, %.1f): событий %u, эталон %u\n",
+                    (unsigned)k, s.node, s.metric, v, nGot, nWant);
+            for (uint8_t i = 0; i < nGot; i++) {
+                fprintf(stderr, "  движок: правило %u %s, delta %.3f\n", got[i].rule,
+                        got[i].raised ? "поднято" : "снято", got[i].delta);
+            }
+            for (uint8_t i = 0; i < nWant; i++) {
+                fprintf(stderr, "  эталон: правило %u %s, delta %.3f\n", want[i].rule,
+                        want[i].raised ? "поднято" : "снято", want[i].delta);
+            }
+            return 1;
+        }
+        for (uint8_t i = 0; i < nGot; i++) {
+            events++;
+            if (got[i].raised) raised++;
+            kinds[configs[got[i].rule].kind]++;
+        }
+    }
+    printf("rules: %u показаний, %u событий (%u тревог) совпали; below %u, above %u, fall %u, "
+           "rise %u, shift %u\n", (unsigned)total, (unsigned)events, (unsigned)raised,
+           (unsigned)kinds[RULE_BELOW], (unsigned)kinds[RULE_ABOVE], (unsigned)kinds[RULE_FALL],
+           (unsigned)kinds[RULE_RISE], (unsigned)kinds[RULE_SHIFT]);
+    return 0;
+}
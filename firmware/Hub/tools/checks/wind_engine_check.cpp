@@ -0,0 +1,150 @@
+// wind_engine_check.cpp - Окна WindEngine против прямого пересчёта
+// Случайные показания флюгера: блуждание через 0°/360° со скачками, шаг от
+// десятков миллисекунд до секунд, перерывы короче и длиннее 10-минутного
+// окна, между показаниями - advance() без показаний, как из loop().
+// После каждого шага оба окна сравниваются с пересчётом по всем показаниям,
+// попавшим в закрытые корзины окна: число показаний, средний вектор,
+// круговое СКО и самый широкий порыв (при равной ширине - новейший).
+//
+// Запуск: make run (см. Makefile); wind_engine_check [показаний]
+#include <Arduino.h>
+#include <vector>
+#include "wind_engine.h"
+
+#define CHECK_DIRECTION_TOL     0.05f   // Градусы; таблица Q14 против double
+#define CHECK_RESULTANT_TOL     0.0005  // СКО сверяется через длину вектора: у
+                                        // нуля СКО слишком чувствительно к Q14
+#define CHECK_MIN_RESULTANT     0.05    // Короче - направление не определено
+
+struct Reading {
+    uint32_t seq;           // Корзина
+    int16_t tenths;         // Угол как в add(): десятые доли 0..3599
+    double s;
+    double c;
+};
+
+struct Expected {
+    uint32_t samples;
+    double resultant;       // Длина среднего вектора, 0..1
+    float direction;
+    float deviation;
+    uint16_t gustWidth;     // Десятые доли
+    float gustStart;
+    float gustEnd;
+};
+
+static uint32_t rngState = 777;
+
+static uint32_t rnd() {
+    rngState = rngState * 1664525u + 1013904223u;
+    return rngState >> 8;
+}
+
+static std::vector<Reading> readings;
+
+static Reading quantize(uint32_t ms, float angle) {
+    int16_t a = (int16_t)lroundf(fmodf(fmodf(angle, 360.0f) + 360.0f, 360.0f) * 10) % 3600;
+    uint16_t deg = ((a + 5) / 10) % 360;
+    return Reading{ms / WIND_BUCKET_MS, a, sin(deg * M_PI / 180), cos(deg * M_PI / 180)};
+}
+
+static float wrapTenths(int32_t tenths) { return ((tenths % 3600 + 3600) % 3600) / 10.0f; }
+
+// Закрытые корзины окна: номера openSeq - len .. openSeq - 1
+static Expected expected(uint32_t openSeq, uint16_t len) {
+    Expected e = {0, 0, 0, 0, 0, 0, 0};
+    uint32_t first = openSeq >= len ? openSeq - len : 0;
+    double s = 0, c = 0;
+    bool anyGust = false;
+    size_t i = readings.size();
+    while (i > 0 && readings[i - 1].seq >= first) i--;
+    while (i < readings.size() && readings[i].seq < openSeq) {
+        // Корзина целиком: разброс - отклонения от первого показания
+        uint32_t seq = readings[i].seq;
+        int16_t ref = readings[i].tenths, lo = 0, hi = 0;
+        for (; i < readings.size() && readings[i].seq == seq; i++) {
+            int16_t off = (readings[i].tenths - ref + 5400) % 3600 - 1800;
+            lo = min(lo, off);
+            hi = max(hi, off);
+            s += readings[i].s;
+            c += readings[i].c;
+            e.samples++;
+        }
+        if (!anyGust || hi - lo >= e.gustWidth) {
+            anyGust = true;
+            e.gustWidth = hi - lo;
+            e.gustStart = wrapTenths(ref + lo);
+            e.gustEnd = wrapTenths(ref + hi);
+        }
+    }
+    if (e.samples == 0) return e;
+    e.direction = atan2(s, c) * 180 / M_PI;
+    if (e.direction < 0) e.direction += 360;
+    e.resultant = sqrt(s * s + c * c) / e.samples;
+    e.deviation = e.resultant < 1 ? sqrt(-2 * log(max(e.resultant, 1e-6))) * 180 / M_PI : 0;
+    return e;
+}
+
+// Длина среднего вектора, из которой stats() получил СКО
+static double resultantOf(float deviation) {
+    double rad = deviation * M_PI / 180;
+    return exp(-rad * rad / 2);
+}
+
+static float circularDiff(float a, float b) { return fabsf(fmodf(a - b + 540.0f, 360.0f) - 180.0f); }
+
+int main(int argc, char **argv) {
+    uint32_t total = argc > 1 ? (uint32_t)atol(argv[1]) : 100000;
+
+    static WindEngine engine;
+    engine.begin();
+    uint32_t ms = 1000;
+    float angle = 350.0f;
+    uint32_t checks = 0;
+    float worstDir = 0;
+    double worstR = 0;
+
+    for (uint32_t k = 0; k < total; k++) {
+        uint32_t r = rnd() % 10000;
+        if (r < 3) ms += 600000 + rnd() % 600000;           // Дольше любого окна
+        else if (r < 20) ms += 30000 + rnd() % 300000;      // Окно 10 минут - частично
+        else ms += 50 + rnd() % 1500;
+
+        if (rnd() % 4 == 0) {
+            engine.advance(ms);                             // Шаг loop() без показания
+        } else {
+            angle += rnd() % 50 == 0 ? (float)(rnd() % 3600) / 10.0f : ((int32_t)(rnd() % 201) - 100) / 10.0f;
+            angle = fmodf(angle + 360.0f, 360.0f);
+            engine.add(ms, angle);
+            readings.push_back(quantize(ms, angle));
+        }
+
+        uint32_t openSeq = ms / WIND_BUCKET_MS;
+        for (uint8_t w = 0; w < WIND_WINDOW_COUNT; w++) {
+            Expected e = expected(openSeq, WIND_WINDOW_BUCKETS[w]);
+            WindStats st = {0, 0, 0, 0, 0, 0};
+            bool has = engine.stats(w, st);
+            const char *error = nullptr;
+            if (has != (e.samples > 0)) error = "окно пусто не там";
+            else if (!has) continue;
+            else if (st.samples != e.samples) error = "число показаний";
+            else if (st.gustWidth != e.gustWidth / 10.0f || st.gustStart != e.gustStart || st.gustEnd != e.gustEnd) error = "порыв";
+            else if (e.resultant >= CHECK_MIN_RESULTANT && circularDiff(st.direction, e.direction) > CHECK_DIRECTION_TOL) error = "направление";
+            else if (fabs(resultantOf(st.deviation) - e.resultant) > CHECK_RESULTANT_TOL) error = "СКО";
+            if (error) {
+                fprintf(stderr, "wind_engine: шаг %u, окно %u: %s - n %u/%u, dir %.2f/%.2f, dev %.2f/%.2f, "
+                        "gust %.1f..%.1f (%.1f) / %.1f..%.1f (%.1f)\n", (unsigned)k, (unsigned)w, error,
+                        (unsigned)(has ? st.samples : 0), (unsigned)e.samples, st.direction, e.direction,
+                        st.deviation, e.deviation, st.gustStart, st.gustEnd, st.gustWidth,
+                        e.gustStart, e.gustEnd, e.gustWidth / 10.0f);
+                return 1;
+            }
+            checks++;
+            if (e.resultant >= CHECK_MIN_RESULTANT) worstDir = max(worstDir, circularDiff(st.direction, e.direction));
+            worstR = max(worstR, fabs(resultantOf(st.deviation) - e.resultant));
+        }
+    }
+    printf("wind_engine: %u шагов, %u окон сверено, макс. расхождение: направление %.3f°, "
+           "длина вектора %.5f\n", (unsigned)total, (unsigned)checks, worstDir, worstR);
+    return 0;
+}
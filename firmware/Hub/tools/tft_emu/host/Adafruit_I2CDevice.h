@@ -0,0 +1,4 @@
+// Adafruit_I2CDevice.h - Заглушка Adafruit BusIO: эмулятору шина не нужна
+#ifndef TFT_EMU_I2CDEVICE_H
+#define TFT_EMU_I2CDEVICE_H
+#endif
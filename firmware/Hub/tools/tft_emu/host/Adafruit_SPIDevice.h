@@ -0,0 +1,4 @@
+// Adafruit_SPIDevice.h - Заглушка Adafruit BusIO: эмулятору шина не нужна
+#ifndef TFT_EMU_SPIDEVICE_H
+#define TFT_EMU_SPIDEVICE_H
+#endif
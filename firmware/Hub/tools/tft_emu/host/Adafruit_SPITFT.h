@@ -0,0 +1,120 @@
+// Adafruit_SPITFT.h - Панель в памяти вместо SPI-дисплея
+// Те же точки входа, что у Adafruit_SPITFT, и та же раскладка по шине:
+// drawPixel - своя транзакция и окно на пиксель, writePixel - окно на
+// пиксель внутри транзакции, прямоугольники и прямые линии - одно окно,
+// writePixels/writeColor льют поток в текущее окно. Счётчики - то, что
+// ушло бы по SPI; кадр - в fb, в координатах после setRotation().
+#ifndef TFT_EMU_SPITFT_H
+#define TFT_EMU_SPITFT_H
+
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+
+#define TFT_EMU_WINDOW_BYTES    11      // CASET 1+4, RASET 1+4, RAMWR 1
+#define TFT_EMU_PIXEL_BYTES     2       // RGB565
+
+struct TftBusStats {
+    uint32_t calls;         // Вызовов примитивов панели
+    uint32_t transactions;  // startWrite..endWrite
+    uint32_t windows;       // setAddrWindow
+    uint32_t pixels;
+
+    uint32_t bytes() const { return windows * TFT_EMU_WINDOW_BYTES + pixels * TFT_EMU_PIXEL_BYTES; }
+};
+
+class Adafruit_SPITFT : public Adafruit_GFX {
+public:
+    Adafruit_SPITFT(uint16_t w, uint16_t h) : Adafruit_GFX(w, h), bus() {
+        _fb = new uint16_t[(uint32_t)w * h]();
+        setAddrWindow(0, 0, w, h);
+        bus = TftBusStats();
+    }
+    ~Adafruit_SPITFT() { delete[] _fb; }
+
+    TftBusStats bus;
+
+    void resetBus() { bus = TftBusStats(); }
+    const uint16_t *framebuffer() const { return _fb; }
+    uint16_t pixel(int16_t x, int16_t y) const { return _fb[(uint32_t)y * _width + x]; }
+
+    void setRotation(uint8_t r) override {
+        rotation = r & 3;
+        _width = rotation & 1 ? HEIGHT : WIDTH;
+        _height = rotation & 1 ? WIDTH : HEIGHT;
+    }
+
+    void startWrite() override { bus.transactions++; }
+    void endWrite() override {}
+
+    virtual void setAddrWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+        _wx = x;
+        _wy = y;
+        _ww = w;
+        _wh = h;
+        _wpos = 0;
+        bus.windows++;
+    }
+
+    void writePixels(uint16_t *colors, uint32_t len, bool block = true, bool bigEndian = false) {
+        (void)block;
+        (void)bigEndian;
+        bus.calls++;
+        while (len--) stream(*colors++);
+    }
+    void writeColor(uint16_t color, uint32_t len) {
+        bus.calls++;
+        while (len--) stream(color);
+    }
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override {
+        if (!inside(x, y)) return;
+        startWrite();
+        writePixel(x, y, color);
+        endWrite();
+    }
+    void writePixel(int16_t x, int16_t y, uint16_t color) override {
+        if (!inside(x, y)) return;
+        setAddrWindow(x, y, 1, 1);
+        writeColor(color, 1);
+    }
+    void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override {
+        if (w < 0) { x += w + 1; w = -w; }
+        if (h < 0) { y += h + 1; h = -h; }
+        int16_t x2 = min((int16_t)(x + w), _width), y2 = min((int16_t)(y + h), _height);
+        x = max(x, (int16_t)0);
+        y = max(y, (int16_t)0);
+        if (x2 <= x || y2 <= y) return;
+        setAddrWindow(x, y, x2 - x, y2 - y);
+        writeColor(color, (uint32_t)(x2 - x) * (y2 - y));
+    }
+    void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override { writeFillRect(x, y, w, 1, color); }
+    void writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override { writeFillRect(x, y, 1, h, color); }
+
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override {
+        startWrite();
+        writeFillRect(x, y, w, h, color);
+        endWrite();
+    }
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override { fillRect(x, y, w, 1, color); }
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override { fillRect(x, y, 1, h, color); }
+
+    uint16_t color565(uint8_t r, uint8_t g, uint8_t b) { return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3); }
+
+private:
+    uint16_t *_fb;
+    uint16_t _wx = 0, _wy = 0, _ww = 0, _wh = 0;
+    uint32_t _wpos = 0;
+
+    bool inside(int16_t x, int16_t y) const { return x >= 0 && y >= 0 && x < _width && y < _height; }
+
+    // Пиксель в окно; за краем окна контроллер начинает окно сначала
+    void stream(uint16_t color) {
+        bus.pixels++;
+        if (_ww == 0 || _wh == 0) return;
+        uint32_t pos = _wpos++ % ((uint32_t)_ww * _wh);
+        int16_t x = _wx + pos % _ww, y = _wy + pos / _ww;
+        if (inside(x, y)) _fb[(uint32_t)y * _width + x] = color;
+    }
+};
+
+#endif
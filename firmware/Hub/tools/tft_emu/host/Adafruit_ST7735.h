@@ -0,0 +1,36 @@
+// Adafruit_ST7735.h - ST7735 128x160 для эмулятора: панель в памяти
+#ifndef TFT_EMU_ST7735_H
+#define TFT_EMU_ST7735_H
+
+#include "Adafruit_SPITFT.h"
+
+#define ST7735_TFTWIDTH_128     128
+#define ST7735_TFTHEIGHT_160    160
+
+#define INITR_GREENTAB          0x00
+#define INITR_REDTAB            0x01
+#define INITR_BLACKTAB          0x02
+
+#define ST77XX_BLACK            0x0000
+#define ST77XX_WHITE            0xFFFF
+#define ST77XX_RED              0xF800
+#define ST77XX_GREEN            0x07E0
+#define ST77XX_BLUE             0x001F
+#define ST77XX_CYAN             0x07FF
+#define ST77XX_MAGENTA          0xF81F
+#define ST77XX_YELLOW           0xFFE0
+#define ST77XX_ORANGE           0xFC00
+
+class Adafruit_ST7735 : public Adafruit_SPITFT {
+public:
+    Adafruit_ST7735(int8_t cs = -1, int8_t dc = -1, int8_t rst = -1)
+        : Adafruit_SPITFT(ST7735_TFTWIDTH_128, ST7735_TFTHEIGHT_160) {
+        (void)cs;
+        (void)dc;
+        (void)rst;
+    }
+
+    void initR(uint8_t options = INITR_GREENTAB) { (void)options; }
+};
+
+#endif
@@ -0,0 +1,56 @@
+// Arduino.h - Минимум Arduino для сборки страниц дисплея на ПК
+// Только то, что нужно tft_pages.h, виджетам и Adafruit_GFX.cpp; им же
+// пользуются бенчмарки и проверки в соседних каталогах tools/.
+#ifndef TFT_EMU_ARDUINO_H
+#define TFT_EMU_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+
+using std::min;
+using std::max;
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+
+#define DEC 10
+#define HEX 16
+
+#define radians(deg) ((deg) * 0.017453292519943295)
+#define degrees(rad) ((rad) * 57.29577951308232)
+
+inline unsigned long micros() {
+    using namespace std::chrono;
+    static const steady_clock::time_point start = steady_clock::now();
+    return (unsigned long)duration_cast<microseconds>(steady_clock::now() - start).count();
+}
+inline unsigned long millis() { return micros() / 1000; }
+
+// Строки из флеш-памяти на ПК - обычные строки
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+
+// Хватает для перегрузок getTextBounds(const String &) в Adafruit_GFX
+class String {
+public:
+    String(const char *s = "") : _s(s ? s : "") {}
+    const char *c_str() const { return _s; }
+    unsigned int length() const { return strlen(_s); }
+
+private:
+    const char *_s;
+};
+
+#include "Print.h"
+
+#endif
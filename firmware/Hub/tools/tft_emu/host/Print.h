@@ -0,0 +1,43 @@
+// Print.h - Вывод текста для Adafruit_GFX на ПК
+// Всё сводится к write(uint8_t), как у Arduino Print.
+#ifndef TFT_EMU_PRINT_H
+#define TFT_EMU_PRINT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+class String;
+
+class Print {
+public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buf, size_t size) {
+        size_t n = 0;
+        while (size--) n += write(*buf++);
+        return n;
+    }
+    size_t write(const char *s) { return s ? write((const uint8_t *)s, strlen(s)) : 0; }
+
+    size_t print(const char *s) { return write(s); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int v, int base = 10) { return print((long)v, base); }
+    size_t print(unsigned int v, int base = 10) { return print((unsigned long)v, base); }
+    size_t print(long v, int base = 10) { return format(base == 16 ? "%lx" : "%ld", v); }
+    size_t print(unsigned long v, int base = 10) { return format(base == 16 ? "%lx" : "%lu", v); }
+    size_t print(double v, int digits = 2) { return format("%.*f", digits, v); }
+
+    size_t println() { return write("\r\n"); }
+    template <typename T> size_t println(T v) { return print(v) + println(); }
+
+private:
+    template <typename... Args> size_t format(const char *fmt, Args... args) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), fmt, args...);
+        return write(buf);
+    }
+};
+
+#endif
@@ -0,0 +1,111 @@
+// png_writer.h - Кадр RGB565 в PNG без сторонних библиотек
+// Данные идут в zlib несжатыми блоками (deflate "stored"): PNG получается
+// крупнее, зато хватает CRC32 и Adler32. scale - увеличение пикселя.
+#ifndef PNG_WRITER_H
+#define PNG_WRITER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+class PngWriter {
+public:
+    // false - файл не записан
+    static bool write(const char *path, const uint16_t *rgb565, uint16_t w, uint16_t h, uint8_t scale) {
+        uint32_t outW = (uint32_t)w * scale, outH = (uint32_t)h * scale;
+        std::vector<uint8_t> raw;
+        raw.reserve(outH * (1 + outW * 3));
+        for (uint32_t y = 0; y < outH; y++) {
+            raw.push_back(0);                           // Фильтр строки: нет
+            const uint16_t *row = rgb565 + (y / scale) * w;
+            for (uint32_t x = 0; x < outW; x++) {
+                uint16_t c = row[x / scale];
+                raw.push_back(expand((c >> 11) & 0x1F, 5));
+                raw.push_back(expand((c >> 5) & 0x3F, 6));
+                raw.push_back(expand(c & 0x1F, 5));
+            }
+        }
+
+        std::vector<uint8_t> z;
+        z.push_back(0x78);                              // zlib: deflate, окно 32 КБ
+        z.push_back(0x01);
+        size_t pos = 0;
+        do {
+            size_t n = raw.size() - pos < 65535 ? raw.size() - pos : 65535;
+            z.push_back(pos + n == raw.size() ? 1 : 0); // BFINAL, BTYPE=00
+            z.push_back(n & 0xFF);
+            z.push_back(n >> 8);
+            z.push_back(~n & 0xFF);
+            z.push_back((~n >> 8) & 0xFF);
+            z.insert(z.end(), raw.begin() + pos, raw.begin() + pos + n);
+            pos += n;
+        } while (pos < raw.size());
+        put32(z, adler32(raw.data(), raw.size()));
+
+        std::vector<uint8_t> ihdr;
+        put32(ihdr, outW);
+        put32(ihdr, outH);
+        ihdr.push_back(8);                              // Бит на канал
+        ihdr.push_back(2);                              // RGB
+        ihdr.push_back(0);
+        ihdr.push_back(0);
+        ihdr.push_back(0);
+
+        FILE *f = fopen(path, "wb");
+        if (!f) return false;
+        static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        fwrite(signature, 1, sizeof(signature), f);
+        chunk(f, "IHDR", ihdr);
+        chunk(f, "IDAT", z);
+        chunk(f, "IEND", std::vector<uint8_t>());
+        return fclose(f) == 0;
+    }
+
+private:
+    static uint8_t expand(uint8_t v, uint8_t bits) { return (v << (8 - bits)) | (v >> (2 * bits - 8)); }
+
+    static void put32(std::vector<uint8_t> &out, uint32_t v) {
+        out.push_back(v >> 24);
+        out.push_back(v >> 16);
+        out.push_back(v >> 8);
+        out.push_back(v);
+    }
+
+    static uint32_t adler32(const uint8_t *p, size_t n) {
+        uint32_t a = 1, b = 0;
+        while (n--) {
+            a = (a + *p++) % 65521;
+            b = (b + a) % 65521;
+        }
+        return (b << 16) | a;
+    }
+
+    static uint32_t crc32(uint32_t crc, const uint8_t *p, size_t n) {
+        static uint32_t table[256];
+        if (!table[1]) {
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t c = i;
+                for (uint8_t k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                table[i] = c;
+            }
+        }
+        crc = ~crc;
+        while (n--) crc = table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    static void chunk(FILE *f, const char *type, const std::vector<uint8_t> &data) {
+        std::vector<uint8_t> head;
+        put32(head, data.size());
+        head.insert(head.end(), type, type + 4);
+        fwrite(head.data(), 1, head.size(), f);
+        if (!data.empty()) fwrite(data.data(), 1, data.size(), f);
+        uint32_t crc = crc32(0, (const uint8_t *)type, 4);
+        crc = crc32(crc, data.data(), data.size());
+        std::vector<uint8_t> tail;
+        put32(tail, crc);
+        fwrite(tail.data(), 1, tail.size(), f);
+    }
+};
+
+#endif
@@ -0,0 +1,221 @@
+// tft_emu.cpp - Страницы дисплея хаба на ПК: PNG и счётчики шины
+// HubDisplay из src/tft_pages.h рисует снимки DisplayState из фикстур в
+// панель в памяти (host/Adafruit_SPITFT.h) - тем же кодом и той же
+// Adafruit GFX, что и прошивка. Для каждой страницы и каждого режима
+// (прямо в дисплей и полосами) снимаются фазы:
+//   enter  - вход на страницу с чужой, всё размечается заново
+//   update - изменились значения страницы
+//   clock  - сменились только часы в верхнем баре
+//   wind   - повернулась только стрелка компаса
+//   spark  - в суточные графики пришла новая 30-минутная точка
+// По каждой фазе - вызовы примитивов, транзакции, окна, пиксели, байты
+// по SPI и оценка времени на шине. Кадры обоих режимов должны совпадать
+// пиксель в пиксель; если нет - код выхода 1 и PNG прямого режима рядом.
+//
+// Запуск: make run (см. Makefile); tft_emu [каталог] [масштаб PNG]
+#include <Arduino.h>
+#include <Adafruit_ST7735.h>
+#include "tft_pages.h"
+#include "png_writer.h"
+
+#ifndef TFT_EMU_SPI_HZ
+#define TFT_EMU_SPI_HZ      27000000    // Только для оценки времени на шине
+#endif
+
+#define FIXTURE_TIME        1760000000UL    // unixtime фикстур
+
+// Из library.properties (см. Makefile); пусто - собрано с заглушкой GFX
+#ifndef TFT_EMU_GFX_VERSION
+#define TFT_EMU_GFX_VERSION ""
+#endif
+
+static const char *PAGE_NAMES[PAGE_COUNT] = {"weather", "node", "greenhouse", "sd"};
+static const char *MODE_NAMES[2] = {"direct", "strip"};
+#define PHASE_COUNT         5
+
+static const char *PHASE_NAMES[PHASE_COUNT] = {"enter", "update", "clock", "wind", "spark"};
+
+// ---------- Фикстуры ----------
+
+static void fixtureStats(RunningStats &st, float base, float spread) {
+    st.reset(FIXTURE_TIME / NODE_STATS_DAY_SECONDS);
+    for (uint8_t i = 0; i < 24; i++) st.add(FIXTURE_TIME - 3600UL * (23 - i), base + spread * sinf(i * 0.26f));
+}
+
+// Сутки по 30 минут; первые часы - пусто (хаб включили не сутки назад)
+static void fixtureSpark(SparkSeries &series, float base, float spread, float shift) {
+    series.newest = FIXTURE_TIME / SPARK_SECONDS;
+    for (uint8_t i = 0; i < SPARK_POINTS; i++) {
+        float v = base + spread * sinf(i * 0.13f + shift);
+        series.values[i] = i < 6 ? SPARK_EMPTY : (int16_t)lroundf(v * SPARK_SCALE);
+    }
+}
+
+static void fixtureSparkPush(SparkSeries &series, float value) {
+    memmove(series.values, series.values + 1, (SPARK_POINTS - 1) * sizeof(series.values[0]));
+    series.values[SPARK_POINTS - 1] = (int16_t)lroundf(value * SPARK_SCALE);
+    series.newest++;
+}
+
+static void fixtureState(DisplayState &s, DisplayPage page) {
+    memset(&s, 0, sizeof(s));
+    s.page = page;
+    s.nodeIndex = 0;
+    strcpy(s.clock, "12:34");
+
+    s.temp = 21.4f;
+    s.pressure = 747.6f;
+    s.humidity = 48;
+    s.icon = ICON_PARTLY;
+    s.frost = FROST_30;
+    s.windDirection = 135;
+    s.windMagnet = true;
+    fixtureSpark(s.sparkTemp, 17.5f, 4.5f, 0);
+    fixtureSpark(s.sparkPress, 747, 2.5f, 1.5f);
+
+    s.node = NodeDisplayData{102, 19.8f, 55, 748.2f, false, true, true, 135, 3, true, false, true, 20.1f};
+    fixtureStats(s.statsTemp, 18.5f, 3.2f);
+    fixtureStats(s.statsHum, 55, 8);
+    fixtureStats(s.statsPress, 748, 2);
+    s.statsTime = FIXTURE_TIME;
+    fixtureSpark(s.nodeSparkTemp, 18.5f, 3.2f, 0.5f);
+    fixtureSpark(s.nodeSparkPress, 748, 2, 2);
+
+    s.greenhouse = GreenhouseDisplayData{26.3f, 14.7f, 71, true, false};
+
+    s.sdOk = true;
+    strcpy(s.sdType, "SDHC");
+    s.sdTotalBytes = 15931539456ULL;
+    s.sdUsedBytes = 412090368ULL;
+    s.sdWriteCount = 18342;
+    strcpy(s.sdFile, "/log_2512.csv");
+}
+
+// Типичное изменение между кадрами страницы
+static void fixtureUpdate(DisplayState &s) {
+    s.temp += 0.3f;
+    s.pressure -= 0.4f;
+    s.windDirection = 160;
+    s.node.temp += 0.2f;
+    s.node.hum += 1;
+    s.greenhouse.temp_in += 0.1f;
+    s.greenhouse.relay2 = true;
+    s.sdWriteCount += 12;
+}
+
+// ---------- Прогон ----------
+
+struct PhaseResult {
+    TftBusStats bus;
+    uint32_t widgets;
+};
+
+struct Run {
+    Adafruit_ST7735 tft;
+    HubDisplay display;
+    PhaseResult results[PAGE_COUNT][PHASE_COUNT];
+    std::vector<uint16_t> frames[PAGE_COUNT][PHASE_COUNT];
+
+    explicit Run(bool strips) : tft(), display(tft) {
+        tft.initR(INITR_GREENTAB);
+        tft.setRotation(1);
+        tft.fillScreen(ST77XX_BLACK);
+        display.sync();
+        display.setStripRender(strips);
+    }
+
+    void phase(const DisplayState &s, uint32_t flags, uint8_t phase) {
+        tft.resetBus();
+        uint32_t widgets = display.stats.widgets;
+        display.frame(s, flags);
+        results[s.page][phase] = PhaseResult{tft.bus, display.stats.widgets - widgets};
+        frames[s.page][phase].assign(tft.framebuffer(), tft.framebuffer() + tft.width() * tft.height());
+    }
+
+    // Страницы по кругу, как их листает кнопка
+    void play() {
+        for (uint8_t p = 0; p < PAGE_COUNT; p++) {
+            DisplayState s;
+            fixtureState(s, (DisplayPage)p);
+            phase(s, 0xFFFFFFFFu, 0);
+            fixtureUpdate(s);
+            phase(s, 1u << p, 1);
+            strcpy(s.clock, "12:35");
+            phase(s, 0, 2);
+            s.windDirection += 7;
+            phase(s, 1u << p, 3);
+            fixtureSparkPush(s.sparkTemp, s.temp);
+            fixtureSparkPush(s.sparkPress, s.pressure);
+            fixtureSparkPush(s.nodeSparkTemp, s.node.temp);
+            fixtureSparkPush(s.nodeSparkPress, s.node.press);
+            phase(s, 1u << p, 4);
+        }
+    }
+};
+
+static bool savePng(const char *dir, const char *name, const Run &run, uint8_t page, uint8_t phase, uint8_t scale) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s.png", dir, name);
+    bool ok = PngWriter::write(path, run.frames[page][phase].data(), run.tft.width(), run.tft.height(), scale);
+    if (!ok) fprintf(stderr, "tft_emu: не удалось записать %s\n", path);
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    const char *dir = argc > 1 ? argv[1] : "out";
+    uint8_t scale = argc > 2 ? (uint8_t)atoi(argv[2]) : 3;
+    if (scale == 0) scale = 1;
+
+    static Run direct(false), strip(true);
+    direct.play();
+    strip.play();
+    Run *runs[2] = {&direct, &strip};
+
+    char path[256];
+    snprintf(path, sizeof(path), "%s/report.txt", dir);
+    FILE *report = fopen(path, "w");
+    if (!report) {
+        fprintf(stderr, "tft_emu: не удалось записать %s\n", path);
+        return 2;
+    }
+
+    int status = 0;
+    char line[160], name[64];
+    if (TFT_EMU_GFX_VERSION[0]) {
+        snprintf(line, sizeof(line), "# Adafruit GFX Library %s\n", TFT_EMU_GFX_VERSION);
+    } else {
+        snprintf(line, sizeof(line), "# Adafruit GFX: заглушка без library.properties, числа - оценка\n");
+    }
+    fputs(line, stdout);
+    fputs(line, report);
+    snprintf(line, sizeof(line), "%-11s %-7s %-7s %7s %7s %7s %7s %8s %8s %8s\n",
+             "page", "mode", "phase", "widgets", "calls", "trans", "windows", "pixels", "bytes", "bus_us");
+    fputs(line, stdout);
+    fputs(line, report);
+    for (uint8_t p = 0; p < PAGE_COUNT; p++) {
+        for (uint8_t ph = 0; ph < PHASE_COUNT; ph++) {
+            for (uint8_t m = 0; m < 2; m++) {
+                const PhaseResult &r = runs[m]->results[p][ph];
+                uint32_t us = (uint32_t)((uint64_t)r.bus.bytes() * 8 * 1000000 / TFT_EMU_SPI_HZ);
+                snprintf(line, sizeof(line), "%-11s %-7s %-7s %7lu %7lu %7lu %7lu %8lu %8lu %8lu\n",
+                         PAGE_NAMES[p], MODE_NAMES[m], PHASE_NAMES[ph], (unsigned long)r.widgets,
+                         (unsigned long)r.bus.calls, (unsigned long)r.bus.transactions,
+                         (unsigned long)r.bus.windows, (unsigned long)r.bus.pixels,
+                         (unsigned long)r.bus.bytes(), (unsigned long)us);
+                fputs(line, stdout);
+                fputs(line, report);
+            }
+
+            snprintf(name, sizeof(name), "%s_%s", PAGE_NAMES[p], PHASE_NAMES[ph]);
+            if (!savePng(dir, name, strip, p, ph, scale)) status = 2;
+            if (direct.frames[p][ph] != strip.frames[p][ph]) {
+                fprintf(stderr, "tft_emu: %s: кадры direct и strip различаются\n", name);
+                snprintf(name, sizeof(name), "%s_%s_direct", PAGE_NAMES[p], PHASE_NAMES[ph]);
+                savePng(dir, name, direct, p, ph, scale);
+                if (status == 0) status = 1;
+            }
+        }
+    }
+    fclose(report);
+    return status;
+}
@@ -0,0 +1,175 @@
+// ts_bench.cpp - Сжатие временных рядов (ts_codec.h) на ПК
+// Генератор строит сутки минутных средних так, как их пишет хаб: шаг 60 с
+// с дрожанием RTC на секунду, суточный ход, медленный дрейф и шум датчика,
+// у части рядов - пропуски, когда узел молчит. Сутки режутся на блоки
+// TS_BLOCK_SIZE байт так же, как tscCompact(). По профилю - байт на запись
+// (в .bin - 8), время кодирования и скорость декодирования.
+// Время - на ПК: для ESP32 оно больше в разы.
+// Декодированная запись, не совпавшая с исходной, - код выхода 1.
+//
+// Запуск: make run (см. Makefile); ts_bench [суток [повторов декодирования]]
+#include <Arduino.h>
+#include <vector>
+#include "ts_codec.h"
+
+#define BENCH_BLOCK_SIZE    512             // Как TS_BLOCK_SIZE в ts_store.h
+#define BENCH_DAY_START     1760000400UL    // Полночь UTC первых суток
+
+// ---------- Генератор ----------
+
+struct Sample {
+    uint32_t t;
+    float v;
+};
+
+struct Profile {
+    const char *name;
+    float base;
+    float daily;            // Амплитуда суточного хода
+    float drift;            // Амплитуда медленного дрейфа за несколько суток
+    float noise;            // СКО шума минутного среднего
+    float step;             // Разрешение среднего (у DS18B20 - шаг датчика)
+    uint8_t gapsPerDay;     // Пропуски по 10-40 минут
+};
+
+// Величины рядов хаба: температура и влажность AHT20, давление BMP280 в мм рт. ст.,
+// уличная температура теплицы (DS18B20)
+static const Profile PROFILES[] = {
+    {"temp",       21.0f, 1.5f, 0.8f, 0.03f, 0.01f,   0},
+    {"hum",        48.0f, 8.0f, 5.0f, 0.25f, 0.01f,   0},
+    {"pressure",  748.0f, 0.6f, 6.0f, 0.04f, 0.01f,   0},
+    {"temp_out",   10.0f, 6.0f, 3.0f, 0.06f, 0.0625f, 0},
+    {"temp+gaps",  21.0f, 1.5f, 0.8f, 0.03f, 0.01f,   6},
+};
+
+static uint32_t rngState = 12345;
+
+static uint32_t rnd() {
+    rngState = rngState * 1664525u + 1013904223u;
+    return rngState >> 8;
+}
+
+static float rndUnit() { return (rnd() & 0xFFFF) / 65536.0f; }
+
+// Приближённо нормальный шум: сумма четырёх равномерных
+static float rndNoise() { return (rndUnit() + rndUnit() + rndUnit() + rndUnit() - 2.0f) * 1.73f; }
+
+static void generateDay(const Profile &p, uint32_t day, std::vector<Sample> &out) {
+    out.clear();
+    uint32_t dayStart = BENCH_DAY_START + day * 86400UL;
+    uint16_t gapStart[8], gapLen[8];
+    for (uint8_t g = 0; g < p.gapsPerDay; g++) {
+        gapStart[g] = rnd() % 1440;
+        gapLen[g] = 10 + rnd() % 31;
+    }
+    for (uint16_t m = 0; m < 1440; m++) {
+        bool gap = false;
+        for (uint8_t g = 0; g < p.gapsPerDay; g++) {
+            if (m >= gapStart[g] && m < gapStart[g] + gapLen[g]) gap = true;
+        }
+        if (gap) continue;
+
+        // Пакет уходит по millis(), метка - по RTC: изредка 59 или 61 с
+        uint32_t jitter = rnd() % 16;
+        uint32_t t = dayStart + m * 60 + (jitter == 0 ? 1 : 0);
+        float hours = day * 24.0f + m / 60.0f;
+        float v = p.base + p.daily * sinf((hours - 9.0f) * 2.0f * (float)M_PI / 24.0f) +
+                  p.drift * sinf(hours * 2.0f * (float)M_PI / 72.0f) + p.noise * rndNoise();
+        v = roundf(v / p.step) * p.step;
+        out.push_back(Sample{t, v});
+    }
+}
+
+// ---------- Блоки ----------
+
+struct Block {
+    uint8_t data[BENCH_BLOCK_SIZE];
+    uint16_t length;
+    uint16_t count;
+};
+
+static void encodeDay(const std::vector<Sample> &day, std::vector<Block> &blocks) {
+    blocks.clear();
+    blocks.push_back(Block());
+    TsEncoder enc;
+    enc.begin(blocks.back().data, BENCH_BLOCK_SIZE);
+    for (const Sample &s : day) {
+        if (enc.append(s.t, s.v)) continue;
+        blocks.back().length = enc.bytes();
+        blocks.back().count = enc.count();
+        blocks.push_back(Block());
+        enc.begin(blocks.back().data, BENCH_BLOCK_SIZE);
+        enc.append(s.t, s.v);
+    }
+    blocks.back().length = enc.bytes();
+    blocks.back().count = enc.count();
+}
+
+static bool verifyDay(const std::vector<Sample> &day, const std::vector<Block> &blocks) {
+    size_t i = 0;
+    for (const Block &b : blocks) {
+        TsDecoder dec;
+        dec.begin(b.data, b.length, b.count);
+        uint32_t t;
+        float v;
+        while (dec.next(t, v)) {
+            if (i >= day.size() || t != day[i].t || tsToFixed(v) != tsToFixed(day[i].v)) return false;
+            i++;
+        }
+    }
+    return i == day.size();
+}
+
+static volatile float sink;
+
+int main(int argc, char **argv) {
+    uint32_t days = argc > 1 ? (uint32_t)atol(argv[1]) : 7;
+    uint32_t rounds = argc > 2 ? (uint32_t)atol(argv[2]) : 20;
+    if (days == 0) days = 1;
+    if (rounds == 0) rounds = 1;
+
+    int status = 0;
+    printf("%-10s %8s %6s %8s %7s %9s %9s\n", "series", "samples", "blocks", "bytes", "B/rec",
+           "enc_ns", "dec_Mrec/s");
+    for (const Profile &p : PROFILES) {
+        std::vector<std::vector<Sample>> series(days);
+        std::vector<std::vector<Block>> encoded(days);
+        size_t samples = 0, blocks = 0, bytes = 0;
+        for (uint32_t d = 0; d < days; d++) generateDay(p, d, series[d]);
+
+        unsigned long start = micros();
+        for (uint32_t d = 0; d < days; d++) encodeDay(series[d], encoded[d]);
+        unsigned long encUs = micros() - start;
+
+        for (uint32_t d = 0; d < days; d++) {
+            samples += series[d].size();
+            blocks += encoded[d].size();
+            for (const Block &b : encoded[d]) bytes += b.length;
+            if (!verifyDay(series[d], encoded[d])) {
+                fprintf(stderr, "ts_bench: %s: сутки %u декодируются не так\n", p.name, (unsigned)d);
+                status = 1;
+            }
+        }
+
+        float acc = 0;
+        start = micros();
+        for (uint32_t r = 0; r < rounds; r++) {
+            for (uint32_t d = 0; d < days; d++) {
+                for (const Block &b : encoded[d]) {
+                    TsDecoder dec;
+                    dec.begin(b.data, b.length, b.count);
+                    uint32_t t;
+                    float v;
+                    while (dec.next(t, v)) acc += v;
+                }
+            }
+        }
+        unsigned long decUs = micros() - start;
+        sink = acc;
+
+        printf("%-10s %8zu %6zu %8zu %7.2f %9.1f %9.1f\n", p.name, samples, blocks, bytes,
+               (double)bytes / samples, encUs * 1000.0 / samples,
+               decUs > 0 ? (double)samples * rounds / decUs : 0.0);
+    }
+    return status;
+}
@@ -0,0 +1,107 @@
+// ws_bench.cpp - Размер и время кодирования сообщений WebSocket на ПК
+// Каждый тип сообщения строится настоящим построителем из ws_messages.h по
+// типичным данным в JSON и в MessagePack. По типу - байты в обоих форматах,
+// выигрыш MessagePack и время одного кодирования (среднее по повторам).
+// Время - на ПК: для ESP32 оно больше в разы, но соотношение форматов то же.
+// Построитель, переполнивший буфер или оставивший объект открытым, -
+// код выхода 1.
+//
+// Запуск: make run (см. Makefile); ws_bench [повторов]
+#include <Arduino.h>
+#include "ws_messages.h"
+
+#define BENCH_TIME          1760000000UL    // unixtime фикстур
+
+// ---------- Фикстуры ----------
+
+static const WsWeather WEATHER = {747.6f, 48, -1.2f, -2.9f, -4.1f, FC_P, ICON_RAIN, FROST_0};
+static const WsSensor SENSOR = {102, 19.8f, 55.3f, 20.1f, 748.2f};
+static const WsSensor SENSOR_PLAIN = {103, 22.4f, 41.0f, 22.9f, 747.9f};
+static const WsGreenhouse GREENHOUSE = {26.3f, 14.7f, 71, true, false};
+static const WsWind WIND = {true, 135.4f, 23.8f, 118, 149, 31.5f};
+static const WindStats WIND_10M = {120, 131.2f, 14.6f, 104, 158, 54.0f};
+static const WsCommandStats COMMANDS[4] = {
+    {102, 1840, 3, 18, 74}, {103, 922, 0, 21, 66}, {104, 15, 2, 35, 410}, {105, 0, 0, 0, 0}
+};
+static const RuleConfig LIMIT_LO = {102, RM_TEMP, RULE_BELOW, 18, 0.5f, 0, 1, 0};
+static const RuleConfig LIMIT_HI = {102, RM_TEMP, RULE_ABOVE, 25, 0.5f, 0, 0, 0};
+
+static RunningStats STATS[WS_STATS_METRICS];
+
+static void fixtureStats() {
+    const float base[WS_STATS_METRICS] = {18.5f, 55, 748};
+    const float spread[WS_STATS_METRICS] = {3.2f, 8, 2};
+    for (uint8_t m = 0; m < WS_STATS_METRICS; m++) {
+        STATS[m].reset(BENCH_TIME / NODE_STATS_DAY_SECONDS);
+        for (uint16_t i = 0; i < 720; i++) {
+            STATS[m].add(BENCH_TIME - 120UL * (719 - i), base[m] + spread[m] * sinf(i * 0.01f));
+        }
+    }
+}
+
+// ---------- Сообщения ----------
+
+typedef void (*Builder)(WsWriter &w);
+
+struct Message {
+    const char *type;
+    Builder build;
+};
+
+static const Message MESSAGES[] = {
+    {"sensor_data", [](WsWriter &w) { wsSensorData(w, SENSOR_PLAIN, nullptr); }},
+    {"sensor_data+weather", [](WsWriter &w) { wsSensorData(w, SENSOR, &WEATHER); }},
+    {"node_stats", [](WsWriter &w) { wsNodeStats(w, SENSOR.id, STATS, BENCH_TIME); }},
+    {"greenhouse_data", [](WsWriter &w) { wsGreenhouseData(w, GREENHOUSE); }},
+    {"weather_update", [](WsWriter &w) { wsWeatherUpdate(w, WEATHER); }},
+    {"weather_forecast", [](WsWriter &w) { wsWeatherForecast(w, 102, WEATHER); }},
+    {"wind", [](WsWriter &w) { wsWindData(w, WIND, &WIND_10M); }},
+    {"command_stats", [](WsWriter &w) { wsCommandStats(w, COMMANDS, 4); }},
+    {"limits_update", [](WsWriter &w) { wsLimitsUpdate(w, 102, "temp", LIMIT_LO, LIMIT_HI); }},
+};
+
+struct Result {
+    size_t bytes;
+    double ns;
+    bool ok;
+};
+
+static Result measure(const Message &msg, WsFormat format, uint32_t iterations) {
+    uint8_t buf[WS_MSG_MAX_LEN];
+    size_t bytes = 0;
+    bool ok = true;
+    unsigned long start = micros();
+    for (uint32_t i = 0; i < iterations; i++) {
+        WsWriter w(buf, sizeof(buf), format);
+        msg.build(w);
+        ok = ok && w.ok();
+        bytes = w.length();
+    }
+    unsigned long us = micros() - start;
+    return Result{bytes, us * 1000.0 / iterations, ok};
+}
+
+int main(int argc, char **argv) {
+    uint32_t iterations = argc > 1 ? (uint32_t)atol(argv[1]) : 20000;
+    if (iterations == 0) iterations = 1;
+    fixtureStats();
+
+    int status = 0;
+    size_t totalJson = 0, totalPack = 0;
+    printf("%-20s %8s %8s %6s %9s %9s\n", "type", "json_b", "mpack_b", "save", "json_ns", "mpack_ns");
+    for (const Message &msg : MESSAGES) {
+        Result json = measure(msg, WS_FORMAT_JSON, iterations);
+        Result pack = measure(msg, WS_FORMAT_MSGPACK, iterations);
+        if (!json.ok || !pack.ok) {
+            fprintf(stderr, "ws_bench: %s: построитель не уложился в WsWriter\n", msg.type);
+            status = 1;
+        }
+        totalJson += json.bytes;
+        totalPack += pack.bytes;
+        printf("%-20s %8zu %8zu %5.0f%% %9.0f %9.0f\n", msg.type, json.bytes, pack.bytes,
+               100.0 * (1.0 - (double)pack.bytes / json.bytes), json.ns, pack.ns);
+    }
+    printf("%-20s %8zu %8zu %5.0f%%\n", "total", totalJson, totalPack,
+           100.0 * (1.0 - (double)totalPack / totalJson));
+    return status;
+}
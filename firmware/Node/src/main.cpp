@@ -76,6 +76,7 @@ uint8_t hubMacAddress[] = {0x9C, 0x9C, 0x1F, 0xC7, 0x2D, 0x94};
 void onEspNowDataRecv(const uint8_t *mac_addr, const uint8_t *incomingData, int len);
 void onEspNowDataSent(const uint8_t *mac_addr, esp_now_send_status_t status);
 void sendJsonToHub(const char* json_string);
+void sendAck(const char* cmd, int cmdId);
 void readAndSendSensorData();
 void sendGpioStatus();
 bool initSensors();
@@ -453,18 +454,20 @@ void onEspNowDataRecv(const uint8_t *mac_addr, const uint8_t *incomingData, int
     const char* type = doc["type"];
     if (strcmp(type, "command") == 0) {
         const char* cmd = doc["command"];
+        int cmdId = doc["id"] | 0;   // ID команды хаба, возвращается в подтверждении
         
         if (strcmp(cmd, "LED_ON") == 0) {
             digitalWrite(LED_PIN, LOW);
-            sendJsonToHub("{\"type\":\"ack\",\"command\":\"LED_ON\"}");
+            sendAck("LED_ON", cmdId);
             sendGpioStatus();
         }
         else if (strcmp(cmd, "LED_OFF") == 0) {
             digitalWrite(LED_PIN, HIGH);
-            sendJsonToHub("{\"type\":\"ack\",\"command\":\"LED_OFF\"}");
+            sendAck("LED_OFF", cmdId);
             sendGpioStatus();
         }
         else if (strcmp(cmd, "GET_STATUS") == 0) {
+            sendAck("GET_STATUS", cmdId);
             readAndSendSensorData();
             sendGpioStatus();
             sendSecurityStatus(currentContact1, currentContact2, true);
@@ -475,6 +478,16 @@ void onEspNowDataRecv(const uint8_t *mac_addr, const uint8_t *incomingData, int
     }
 }
 
+void sendAck(const char* cmd, int cmdId) {
+    char json[80];
+    if (cmdId > 0) {
+        snprintf(json, sizeof(json), "{\"type\":\"ack\",\"command\":\"%s\",\"id\":%d}", cmd, cmdId);
+    } else {
+        snprintf(json, sizeof(json), "{\"type\":\"ack\",\"command\":\"%s\"}", cmd);
+    }
+    sendJsonToHub(json);
+}
+
 void onEspNowDataSent(const uint8_t *mac_addr, esp_now_send_status_t status) {
     // Не используется
 }
\ No newline at end of file